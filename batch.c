@@ -0,0 +1,499 @@
+#define _GNU_SOURCE
+
+#include "batch.h"
+#include "cert.h"
+#include "digest.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+
+// Variabile globale per gestire interruzioni
+extern volatile sig_atomic_t interrupted;
+
+static double elapsed_seconds(const struct timespec *begin) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - begin->tv_sec) + (double)(now.tv_nsec - begin->tv_nsec) / 1e9;
+}
+
+const char *batch_status_name(batch_status_t status) {
+    switch (status) {
+        case BATCH_READY:
+            return "ready";
+        case BATCH_REFUSED:
+            return "REFUSED";
+        case BATCH_SUCCESS:
+            return "OK";
+        case BATCH_FAILED:
+            return "FAILED";
+        case BATCH_INTERRUPTED:
+            return "INTERRUPTED";
+        case BATCH_MISMATCH:
+            return "MISMATCH";
+    }
+    return "unknown";
+}
+
+int batch_create(batch_t *batch, int capacity) {
+    batch->devices = calloc((size_t)capacity, sizeof(batch_device_t));
+    batch->count = 0;
+    batch->capacity = capacity;
+    batch->workers = 0;
+    batch->seconds = 0.0;
+    if (!batch->devices) {
+        perror("calloc");
+        return -1;
+    }
+    return 0;
+}
+
+static batch_device_t *append_device(batch_t *batch, const char *path) {
+    if (batch->count >= batch->capacity) {
+        return NULL;
+    }
+
+    batch_device_t *device = &batch->devices[batch->count++];
+    device->fd = -1;
+    snprintf(device->path, sizeof(device->path), "%s", path);
+
+    const char *name = strrchr(device->path, '/');
+    snprintf(device->label, sizeof(device->label), "%.63s", name ? name + 1 : device->path);
+    return device;
+}
+
+static int refuse(batch_device_t *device, const char *reason) {
+    snprintf(device->reason, sizeof(device->reason), "%s", reason);
+    device->status = BATCH_REFUSED;
+    return 0;
+}
+
+int batch_add_refused(batch_t *batch, const char *path, const char *reason) {
+    batch_device_t *device = append_device(batch, path);
+    if (!device) {
+        return -1;
+    }
+    log_message("Batch: %s refused: %s", path, reason);
+    return refuse(device, reason);
+}
+
+int batch_add(batch_t *batch, const char *path, const wipe_options_t *options) {
+    batch_device_t *device = append_device(batch, path);
+    if (!device) {
+        return -1;
+    }
+    device->options = *options;
+
+    // Lo stesso device due volte verrebbe scritto da due worker in parallelo
+    for (int j = 0; j < batch->count - 1; j++) {
+        if (strcmp(batch->devices[j].path, device->path) == 0) {
+            fprintf(stderr, "ERROR: %s listed more than once\n", device->path);
+            return refuse(device, "listed more than once");
+        }
+    }
+
+    if (!verify_disk(device->path)) {
+        log_message("Batch: disk verification failed: %s", device->path);
+        return refuse(device, "failed disk checks");
+    }
+
+    int fd = open_disk_raw(device->path, 0);
+    if (fd < 0) {
+        log_message("Batch: failed to open disk: %s", device->path);
+        return refuse(device, "cannot open device");
+    }
+
+    ssize_t size = get_disk_size(fd);
+    size_t aligned_size = size > 0 ? wipe_aligned_size(fd, (size_t)size, device->options.io.direct_io) : 0;
+    close(fd);
+    if (size < 0) {
+        log_message("Batch: failed to get disk size: %s", device->path);
+        return refuse(device, "cannot read device size");
+    }
+
+    device->size = (size_t)size;
+
+    int prepared = wipe_checkpoint_prepare(device->path, device->size, aligned_size, &device->options,
+                                           &device->checkpoint);
+    if (prepared < 0) {
+        log_message("Batch: unusable checkpoint for %s", device->path);
+        return refuse(device, "unusable checkpoint journal");
+    }
+
+    io_plan_build(device->path, &device->plan);
+    io_plan_apply(&device->plan, &device->options.io);
+    io_plan_log(&device->plan, &device->options.io, device->path);
+
+    device->resumed = prepared;
+    device->status = BATCH_READY;
+    return 1;
+}
+
+int batch_init(batch_t *batch, char *const *paths, int count, const wipe_options_t *options) {
+    if (batch_create(batch, count) != 0) {
+        return -1;
+    }
+
+    int ready = 0;
+    for (int i = 0; i < count; i++) {
+        ready += batch_add(batch, paths[i], options) > 0;
+    }
+
+    return ready;
+}
+
+void batch_print_plan(const batch_t *batch) {
+    size_t total = 0;
+
+    printf("\nDevices to erase:\n");
+    for (int i = 0; i < batch->count; i++) {
+        const batch_device_t *device = &batch->devices[i];
+        char size_str[64];
+
+        if (device->status != BATCH_READY) {
+            printf("  %-20s %s%s%s%s\n", device->path, batch_status_name(device->status),
+                   device->reason[0] != '\0' ? " (" : "", device->reason, device->reason[0] != '\0' ? ")" : "");
+            continue;
+        }
+
+        format_bytes(device->size, size_str, sizeof(size_str));
+        if (device->resumed) {
+            const checkpoint_t *checkpoint = &device->checkpoint;
+            printf("  %-20s %s, resuming %s pass %d/%d at %.1f%%\n", device->path, size_str, checkpoint->scheme,
+                   checkpoint->pass + 1, checkpoint->pass_count, checkpoint_percent(checkpoint));
+        } else {
+            printf("  %-20s %s\n", device->path, size_str);
+        }
+        io_plan_print(&device->plan, &device->options.io, "    ");
+        total += device->size;
+    }
+
+    char total_str[64];
+    format_bytes(total, total_str, sizeof(total_str));
+    printf("  Total: %s\n", total_str);
+}
+
+int batch_open(batch_t *batch) {
+    int opened = 0;
+
+    for (int i = 0; i < batch->count; i++) {
+        batch_device_t *device = &batch->devices[i];
+        if (device->status != BATCH_READY) {
+            continue;
+        }
+
+        printf("\n[%s]\n", device->label);
+        unmount_disk(device->path);
+
+        device->fd = open_disk_raw(device->path, device->options.io.direct_io);
+        if (device->fd < 0) {
+            fprintf(stderr, "ERROR: Cannot open %s for writing\n", device->path);
+            log_message("Batch: failed to open disk for writing: %s", device->path);
+            device->status = BATCH_FAILED;
+            continue;
+        }
+        opened++;
+    }
+
+    return opened;
+}
+
+static void *batch_worker(void *arg) {
+    batch_device_t *device = arg;
+    sigset_t mask;
+
+    // SIGINT/SIGTERM restano al thread principale, i worker osservano interrupted
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    struct timespec begin;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    device->started_at = time(NULL);
+
+    // Prima di ogni allocazione: writer, produttori e buffer ereditano CPU e memoria del nodo
+    numa_apply(&device->plan.numa, device->path);
+
+    const wipe_options_t *options = &device->options;
+    log_message("Batch: starting wipe of %s - size: %zu bytes", device->path, device->size);
+    int result = wipe_disk(device->fd, device->path, device->size, options, &device->checkpoint,
+                           &device->progress);
+    device->written = device->progress.written_bytes - device->progress.resumed_bytes;
+    device->seconds = elapsed_seconds(&begin);
+
+    close(device->fd);
+    device->fd = -1;
+
+    // Stessa riga di display: la barra riparte per la rilettura
+    digest_t *digest = NULL;
+    if (result == 0 && options->verify.mode != VERIFY_NONE) {
+        log_message("Batch: %s erased, verifying", device->path);
+        progress_restart(&device->progress, 0, "Verify");
+
+        // Il digest del certificato si calcola sui chunk della rilettura, senza un'altra passata
+        if (options->certificate_dir) {
+            digest = digest_create(device->size, 0);
+            result = digest ? 0 : -1;
+            device->progress.digest = digest;
+        }
+
+        if (result == 0) {
+            const pattern_pass_t *last = &options->scheme.passes[options->scheme.pass_count - 1];
+            result = verify_device(device->path, device->size, last, &options->io, &options->verify,
+                                   &device->progress, &device->verify);
+            verify_log(&device->verify, device->path);
+        }
+    }
+    device->finished_at = time(NULL);
+
+    if (digest && (result == 0 || result == 1)) {
+        cert_info_t info = {
+            .disk_path = device->path,
+            .size = device->size,
+            .options = options,
+            .result = result == 0 ? "success" : "mismatch",
+            .started = device->started_at,
+            .finished = device->finished_at,
+            .wipe_seconds = device->seconds,
+            .written = device->written,
+            .resumed = device->resumed,
+            .stats = &device->stats,
+            .verify = &device->verify,
+            .digest = digest,
+        };
+        if (cert_write(options->certificate_dir, &info, device->certificate, sizeof(device->certificate)) != 0) {
+            device->certificate[0] = '\0';
+            snprintf(device->reason, sizeof(device->reason), "certificate not written to %s",
+                     options->certificate_dir);
+            result = -1;
+        }
+    }
+    device->progress.digest = NULL;
+    digest_free(digest);
+
+    if (result == 0) {
+        device->status = BATCH_SUCCESS;
+        log_message("Batch: %s erased successfully", device->path);
+    } else if (result == 1) {
+        device->status = BATCH_MISMATCH;
+        log_message("Batch: verification of %s failed", device->path);
+    } else if (result == -2) {
+        device->status = BATCH_INTERRUPTED;
+        log_message("Batch: wipe of %s interrupted", device->path);
+    } else {
+        device->status = BATCH_FAILED;
+        log_message("Batch: wipe of %s failed", device->path);
+    }
+
+    __atomic_store_n(&device->finished, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// Avvia i device pronti in coda finché i worker attivi sono meno di workers; ritorna i worker attivi
+static int start_queued(batch_t *batch, int *next, int running, int workers) {
+    while (running < workers && *next < batch->count) {
+        batch_device_t *device = &batch->devices[(*next)++];
+        if (device->status != BATCH_READY) {
+            continue;
+        }
+
+        if (pthread_create(&device->thread, NULL, batch_worker, device) != 0) {
+            perror("pthread_create");
+            device->status = BATCH_FAILED;
+            close(device->fd);
+            device->fd = -1;
+            continue;
+        }
+
+        device->started = 1;
+        running++;
+    }
+
+    return running;
+}
+
+int batch_run(batch_t *batch) {
+    const progress_info_t **infos = calloc((size_t)batch->count, sizeof(*infos));
+    const char **labels = calloc((size_t)batch->count, sizeof(*labels));
+    if (!infos || !labels) {
+        perror("calloc");
+        free(infos);
+        free(labels);
+        return -1;
+    }
+
+    struct timespec begin;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    int shown = 0;
+
+    for (int i = 0; i < batch->count; i++) {
+        batch_device_t *device = &batch->devices[i];
+        if (device->status != BATCH_READY) {
+            continue;
+        }
+
+        // Ogni device ha il suo progress; il display è solo quello multi-riga.
+        // I device in coda compaiono fermi a 0 finché un worker non si libera
+        progress_init(&device->progress, device->size * (size_t)device->options.scheme.pass_count);
+        progress_set_resumed(&device->progress, checkpoint_done_bytes(&device->checkpoint));
+        device->progress.quiet = 1;
+        device->progress.stats = &device->stats;
+        if (device->options.method == WIPE_METHOD_QUICK && !device->metadata) {
+            device->metadata = calloc(1, sizeof(metadata_plan_t)); // senza, gli intervalli vanno solo nel log
+        }
+        device->progress.metadata = device->metadata;
+
+        infos[shown] = &device->progress;
+        labels[shown] = device->label;
+        shown++;
+    }
+
+    int workers = batch->workers > 0 ? batch->workers : batch->count;
+    int next = 0;
+    int running = start_queued(batch, &next, 0, workers);
+
+    printf("\n");
+    int redraw = 0;
+    while (running > 0) {
+        progress_display_batch(infos, labels, shown, redraw);
+        redraw = 1;
+
+        struct timespec delay = {0, 500 * 1000 * 1000};
+        nanosleep(&delay, NULL);
+
+        running = 0;
+        for (int i = 0; i < batch->count; i++) {
+            const batch_device_t *device = &batch->devices[i];
+            if (device->started && !__atomic_load_n(&device->finished, __ATOMIC_ACQUIRE)) {
+                running++;
+            }
+        }
+
+        // Dopo un'interruzione i device in coda non partono più
+        if (!interrupted) {
+            running = start_queued(batch, &next, running, workers);
+        }
+    }
+
+    if (shown > 0) {
+        progress_display_batch(infos, labels, shown, redraw);
+    }
+
+    for (int i = 0; i < batch->count; i++) {
+        batch_device_t *device = &batch->devices[i];
+        if (device->started) {
+            pthread_join(device->thread, NULL);
+        } else if (device->status == BATCH_READY) {
+            close(device->fd);
+            device->fd = -1;
+            device->status = BATCH_INTERRUPTED;
+            log_message("Batch: wipe of %s not started (interrupted)", device->path);
+        }
+    }
+
+    batch->seconds = elapsed_seconds(&begin);
+    free(infos);
+    free(labels);
+
+    int result = 0;
+    for (int i = 0; i < batch->count; i++) {
+        batch_status_t status = batch->devices[i].status;
+        if (status == BATCH_FAILED || status == BATCH_REFUSED || status == BATCH_MISMATCH) {
+            result = -1;
+        } else if (status == BATCH_INTERRUPTED && result == 0) {
+            result = -2;
+        }
+    }
+
+    return result;
+}
+
+void batch_report(const batch_t *batch) {
+    size_t total_bytes = 0;
+    int succeeded = 0;
+
+    printf("\nBatch results:\n");
+    printf("  %-20s %-12s %12s %10s %12s\n", "Device", "Result", "Written", "Time", "Speed");
+
+    for (int i = 0; i < batch->count; i++) {
+        const batch_device_t *device = &batch->devices[i];
+        char written_str[64], time_str[64];
+        size_t written = device->status == BATCH_REFUSED ? 0 : device->written;
+        double speed = device->seconds > 0 ? (double)written / device->seconds / (1024.0 * 1024.0) : 0.0;
+
+        format_bytes(written, written_str, sizeof(written_str));
+        format_time((time_t)device->seconds, time_str, sizeof(time_str));
+        printf("  %-20s %-12s %12s %10s %8.2f MB/s\n",
+               device->path, batch_status_name(device->status), written_str, time_str, speed);
+
+        log_message("Batch result: %s %s - %zu bytes in %.1fs (%.2f MB/s)",
+                    device->path, batch_status_name(device->status), written, device->seconds, speed);
+
+        if (device->reason[0] != '\0') {
+            printf("  %-20s %s\n", "", device->reason);
+        }
+
+        if (device->stats.latency.total > 0) {
+            char summary[128];
+            printf("  %-20s %s\n", "", io_stats_summary(&device->stats, summary, sizeof(summary)));
+        }
+
+        if (device->metadata && device->status == BATCH_SUCCESS) {
+            const metadata_plan_t *plan = device->metadata;
+            printf("  %-20s cleared %d range(s), partition table %s, %d partition(s):\n", "", plan->count,
+                   plan->table, plan->partitions);
+            for (int r = 0; r < plan->count; r++) {
+                printf("  %-20s   [%zu, %zu) %s\n", "", plan->ranges[r].offset,
+                       plan->ranges[r].offset + plan->ranges[r].length, plan->ranges[r].label);
+            }
+        }
+
+        if (device->verify.bytes_read > 0) {
+            char verified_str[64], mismatched_str[64];
+            double verify_speed = device->verify.seconds > 0
+                ? (double)device->verify.bytes_read / device->verify.seconds / (1024.0 * 1024.0) : 0.0;
+
+            format_bytes(device->verify.bytes_read, verified_str, sizeof(verified_str));
+            format_bytes(device->verify.mismatched_bytes, mismatched_str, sizeof(mismatched_str));
+            printf("  %-20s verified %s at %.2f MB/s, %s mismatching in %zu range(s)\n", "",
+                   verified_str, verify_speed, mismatched_str, device->verify.range_count);
+        }
+
+        if (device->certificate[0] != '\0') {
+            printf("  %-20s certificate %s\n", "", device->certificate);
+        }
+
+        total_bytes += written;
+        if (device->status == BATCH_SUCCESS) {
+            succeeded++;
+        }
+    }
+
+    char total_str[64], time_str[64];
+    format_bytes(total_bytes, total_str, sizeof(total_str));
+    format_time((time_t)batch->seconds, time_str, sizeof(time_str));
+    double aggregate = batch->seconds > 0 ? (double)total_bytes / batch->seconds / (1024.0 * 1024.0) : 0.0;
+
+    printf("\n  %d of %d devices erased, %s in %s (aggregate %.2f MB/s)\n",
+           succeeded, batch->count, total_str, time_str, aggregate);
+
+    char rss_str[64];
+    printf("  Peak memory (RSS): %s\n", format_bytes(peak_rss(), rss_str, sizeof(rss_str)));
+}
+
+void batch_free(batch_t *batch) {
+    for (int i = 0; i < batch->count; i++) {
+        if (batch->devices[i].fd >= 0) {
+            close(batch->devices[i].fd);
+        }
+        free(batch->devices[i].metadata);
+    }
+    free(batch->devices);
+    batch->devices = NULL;
+    batch->count = 0;
+}
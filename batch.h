@@ -0,0 +1,77 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <stddef.h>
+#include "disk_ops.h"
+#include "io_plan.h"
+#include "metadata.h"
+#include "progress.h"
+#include "verify.h"
+
+// Stato di un device nel wipe multi-disco
+typedef enum {
+    BATCH_READY = 0,   // superato il preflight, in attesa del wipe
+    BATCH_REFUSED,     // escluso dal preflight (non valido, disco di sistema, non apribile)
+    BATCH_SUCCESS,
+    BATCH_FAILED,
+    BATCH_INTERRUPTED,
+    BATCH_MISMATCH     // cancellato, ma la verifica ha trovato differenze
+} batch_status_t;
+
+typedef struct {
+    char path[256];
+    char label[64];
+    char reason[128];          // motivo dell'esclusione (BATCH_REFUSED)
+    int fd;
+    size_t size;
+    batch_status_t status;
+    progress_info_t progress;  // wipe, poi verifica
+    size_t written;            // byte scritti dal wipe
+    verify_result_t verify;
+    pthread_t thread;
+    double seconds; // durata del wipe, esclusa la verifica
+    int started;  // worker creato
+    int finished; // impostato dal worker al termine, letto dal thread di display
+    wipe_options_t options;   // copia per device: un wipe ripreso usa schema e seed del suo journal
+    checkpoint_t checkpoint;
+    io_plan_t plan;           // chunk e queue depth dai limiti della coda, già applicati a options.io
+    int resumed;              // riprende da un checkpoint
+    io_stats_t stats;         // latenze e stalli del wipe
+    metadata_plan_t *metadata; // intervalli cancellati dal metodo quick (NULL con gli altri metodi)
+    time_t started_at;        // inizio del wipe e fine della verifica, per il certificato
+    time_t finished_at;
+    char certificate[PATH_MAX]; // certificato scritto, vuoto se non richiesto o non scritto
+} batch_device_t;
+
+typedef struct {
+    batch_device_t *devices;
+    int count;
+    int capacity;
+    int workers;    // device cancellati contemporaneamente, 0 = tutti
+    double seconds; // durata complessiva del wipe concorrente
+} batch_t;
+
+const char *batch_status_name(batch_status_t status);
+int batch_create(batch_t *batch, int capacity);
+// Verifica il device, ne legge la dimensione e ne prepara il journal con le sue opzioni.
+// Ritorna 1 se è utilizzabile, 0 se è stato escluso (motivo in reason), -1 se il batch è pieno.
+int batch_add(batch_t *batch, const char *path, const wipe_options_t *options);
+// Registra un device escluso prima del preflight, es. un seriale non trovato
+int batch_add_refused(batch_t *batch, const char *path, const char *reason);
+// Crea il batch e vi aggiunge tutti i device con le stesse opzioni; ritorna quanti sono utilizzabili
+int batch_init(batch_t *batch, char *const *paths, int count, const wipe_options_t *options);
+void batch_print_plan(const batch_t *batch);
+// Smonta e apre in scrittura i device pronti; ritorna quanti sono stati aperti
+int batch_open(batch_t *batch);
+// Esegue i wipe in parallelo con display multi-riga, al più workers alla volta
+// (i successivi partono man mano che i primi terminano).
+// Ritorna 0 se tutti i device sono stati cancellati (e verificati), -2 se interrotto,
+// -1 se qualche device è fallito o non ha superato la verifica.
+int batch_run(batch_t *batch);
+void batch_report(const batch_t *batch);
+void batch_free(batch_t *batch);
+
+#endif // BATCH_H
@@ -0,0 +1,489 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include "disk_ops.h"
+#include "utils.h"
+
+// Benchmark dei motori di cancellazione: ogni combinazione di motore, chunk, queue depth e pattern
+// passa da wipe_disk() su un file regolare, un loop device o un null_blk, così le regressioni
+// del percorso reale (pipeline, stripe, fsync finale) si vedono nei numeri
+
+#define BENCH_DEFAULT_SIZE (1024ULL * 1024 * 1024)
+#define BENCH_MAX_VALUES 16
+#define BENCH_MAX_CASES 512
+#define BENCH_GENERATOR_BUFFER (4 * 1024 * 1024)
+
+volatile sig_atomic_t interrupted = 0;
+
+static void signal_handler(int sig) {
+    (void)sig;
+    interrupted = 1;
+}
+
+typedef struct {
+    io_engine_t engines[2];
+    int engine_count;
+    size_t chunks[BENCH_MAX_VALUES];
+    int chunk_count;
+    unsigned int depths[BENCH_MAX_VALUES];
+    int depth_count;
+    char patterns[BENCH_MAX_VALUES][32];
+    int pattern_count;
+    size_t size;
+    int direct_io;
+    int force;
+    const char *json_path;
+} bench_options_t;
+
+typedef struct {
+    const char *engine;   // "generator" per la sola generazione del pattern in memoria
+    char pattern[32];
+    size_t chunk_size;
+    unsigned int queue_depth; // 0 se non applicabile
+    double seconds;
+    double mbps;
+    double iops;
+    double cpu_percent;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t requests;
+} bench_result_t;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Tempo di CPU (utente + sistema) di tutti i thread del processo
+static double cpu_seconds(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (double)usage.ru_utime.tv_sec + (double)usage.ru_utime.tv_usec / 1e6 +
+           (double)usage.ru_stime.tv_sec + (double)usage.ru_stime.tv_usec / 1e6;
+}
+
+static void print_usage(const char *program_name) {
+    printf("Usage: %s [OPTIONS] TARGET\n\n", program_name);
+    printf("Measure the erase engines against TARGET: a regular file (created if missing),\n");
+    printf("a loop device or a null_blk device. Every case overwrites the first SIZE bytes.\n\n");
+    printf("Options:\n");
+    printf("  -s, --size=SIZE           Bytes written per case, K/M/G suffixes (default: 1G)\n");
+    printf("  -e, --engines=LIST        Engines to measure (default: sync,io_uring)\n");
+    printf("  -c, --chunk-sizes=LIST    Chunk sizes (default: 128K,1M,4M)\n");
+    printf("  -q, --queue-depths=LIST   io_uring queue depths (default: 4,16,64)\n");
+    printf("  -p, --patterns=LIST       Patterns or schemes of one pass (default: zero,random)\n");
+    printf("  -d, --direct              Use O_DIRECT\n");
+    printf("  -j, --json=FILE           Also write the results as JSON (- for stdout)\n");
+    printf("      --force               Allow a block device as TARGET (its data is destroyed)\n");
+    printf("  -h, --help                Show this help message\n");
+}
+
+// Separa una lista "a,b,c" chiamando parse_item per ogni elemento
+static int parse_list(const char *text, int (*parse_item)(const char *item, void *out, int index), void *out,
+                      int *count) {
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "%s", text);
+
+    *count = 0;
+    for (char *save = NULL, *item = strtok_r(buffer, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        if (*count >= BENCH_MAX_VALUES || parse_item(item, out, *count) != 0) {
+            return -1;
+        }
+        (*count)++;
+    }
+
+    return *count > 0 ? 0 : -1;
+}
+
+static int parse_engine(const char *item, void *out, int index) {
+    return index < 2 ? io_engine_from_name(item, &((io_engine_t *)out)[index]) : -1;
+}
+
+static int parse_chunk(const char *item, void *out, int index) {
+    size_t *chunks = out;
+    if (parse_size(item, IO_MIN_CHUNK_SIZE, IO_MAX_CHUNK_SIZE, &chunks[index]) != 0 ||
+        chunks[index] % IO_MIN_CHUNK_SIZE != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static int parse_depth(const char *item, void *out, int index) {
+    char *end;
+    unsigned long depth = strtoul(item, &end, 10);
+    if (*end != '\0' || depth < 1 || depth > IO_MAX_QUEUE_DEPTH) {
+        return -1;
+    }
+    ((unsigned int *)out)[index] = (unsigned int)depth;
+    return 0;
+}
+
+static int parse_pattern(const char *item, void *out, int index) {
+    wipe_scheme_t scheme;
+    if (scheme_from_name(item, &scheme) != 0 || scheme.pass_count != 1) {
+        return -1;
+    }
+    snprintf(((char (*)[32])out)[index], 32, "%s", item);
+    return 0;
+}
+
+static int parse_options(int argc, char *argv[], bench_options_t *options) {
+    enum { OPT_FORCE = 256 };
+    static const struct option long_options[] = {
+        {"size", required_argument, NULL, 's'},
+        {"engines", required_argument, NULL, 'e'},
+        {"chunk-sizes", required_argument, NULL, 'c'},
+        {"queue-depths", required_argument, NULL, 'q'},
+        {"patterns", required_argument, NULL, 'p'},
+        {"direct", no_argument, NULL, 'd'},
+        {"json", required_argument, NULL, 'j'},
+        {"force", no_argument, NULL, OPT_FORCE},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+
+    memset(options, 0, sizeof(*options));
+    options->size = BENCH_DEFAULT_SIZE;
+    parse_list("sync,io_uring", parse_engine, options->engines, &options->engine_count);
+    parse_list("128K,1M,4M", parse_chunk, options->chunks, &options->chunk_count);
+    parse_list("4,16,64", parse_depth, options->depths, &options->depth_count);
+    parse_list("zero,random", parse_pattern, options->patterns, &options->pattern_count);
+
+    while ((opt = getopt_long(argc, argv, "s:e:c:q:p:dj:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                if (parse_size(optarg, IO_MIN_CHUNK_SIZE, (size_t)-1, &options->size) != 0) {
+                    fprintf(stderr, "ERROR: Invalid size '%s'\n", optarg);
+                    return -1;
+                }
+                break;
+            case 'e':
+                if (parse_list(optarg, parse_engine, options->engines, &options->engine_count) != 0) {
+                    fprintf(stderr, "ERROR: Invalid engine list '%s' (use sync, io_uring)\n", optarg);
+                    return -1;
+                }
+                break;
+            case 'c':
+                if (parse_list(optarg, parse_chunk, options->chunks, &options->chunk_count) != 0) {
+                    fprintf(stderr, "ERROR: Chunk sizes must be multiples of 4K between 4K and 64M\n");
+                    return -1;
+                }
+                break;
+            case 'q':
+                if (parse_list(optarg, parse_depth, options->depths, &options->depth_count) != 0) {
+                    fprintf(stderr, "ERROR: Queue depths must be between 1 and %d\n", IO_MAX_QUEUE_DEPTH);
+                    return -1;
+                }
+                break;
+            case 'p':
+                if (parse_list(optarg, parse_pattern, options->patterns, &options->pattern_count) != 0) {
+                    fprintf(stderr, "ERROR: Invalid pattern list '%s' (single-pass schemes only)\n", optarg);
+                    return -1;
+                }
+                break;
+            case 'd':
+                options->direct_io = 1;
+                break;
+            case 'j':
+                options->json_path = optarg;
+                break;
+            case OPT_FORCE:
+                options->force = 1;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                exit(0);
+            default:
+                print_usage(argv[0]);
+                return -1;
+        }
+    }
+
+    if (optind != argc - 1) {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Apre il target; un file regolare viene creato ed esteso fino a size
+static int open_target(const char *path, const bench_options_t *options, size_t *size) {
+    struct stat st;
+    int is_block = stat(path, &st) == 0 && S_ISBLK(st.st_mode);
+
+    if (is_block && !options->force) {
+        fprintf(stderr, "ERROR: %s is a block device, its contents will be destroyed. Use --force\n", path);
+        return -1;
+    }
+    if (is_block && is_system_disk(path)) {
+        fprintf(stderr, "ERROR: %s appears to be a system disk\n", path);
+        return -1;
+    }
+
+    int flags = O_WRONLY | (is_block ? 0 : O_CREAT);
+    if (options->direct_io) {
+        flags |= O_DIRECT;
+    }
+
+    int fd = open(path, flags, 0600);
+    if (fd < 0) {
+        perror("open");
+        return -1;
+    }
+
+    *size = options->size - options->size % IO_MIN_CHUNK_SIZE;
+    if (is_block) {
+        ssize_t device_size = get_disk_size(fd);
+        if (device_size < 0) {
+            close(fd);
+            return -1;
+        }
+        if ((size_t)device_size < *size) {
+            *size = (size_t)device_size - (size_t)device_size % IO_MIN_CHUNK_SIZE;
+        }
+    } else if (fstat(fd, &st) == 0 && (size_t)st.st_size < *size && ftruncate(fd, (off_t)*size) != 0) {
+        perror("ftruncate");
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// Solo generazione del pattern in memoria: il limite superiore di ogni motore
+static int bench_generator(const char *pattern, size_t size, bench_result_t *result) {
+    wipe_scheme_t scheme;
+    void *buffer;
+
+    scheme_from_name(pattern, &scheme);
+    scheme_set_seed(&scheme, 0x5EED);
+    if (posix_memalign(&buffer, IO_MIN_CHUNK_SIZE, BENCH_GENERATOR_BUFFER) != 0) {
+        perror("posix_memalign");
+        return -1;
+    }
+
+    double cpu_start = cpu_seconds();
+    double start = now_seconds();
+    for (size_t offset = 0; offset < size && !interrupted; offset += BENCH_GENERATOR_BUFFER) {
+        size_t length = size - offset < BENCH_GENERATOR_BUFFER ? size - offset : BENCH_GENERATOR_BUFFER;
+        pattern_fill(&scheme.passes[0], offset, buffer, length);
+    }
+    double elapsed = now_seconds() - start;
+    double cpu = cpu_seconds() - cpu_start;
+    free(buffer);
+
+    memset(result, 0, sizeof(*result));
+    result->engine = "generator";
+    snprintf(result->pattern, sizeof(result->pattern), "%s", pattern);
+    result->chunk_size = BENCH_GENERATOR_BUFFER;
+    result->seconds = elapsed;
+    result->mbps = elapsed > 0 ? (double)size / elapsed / (1024.0 * 1024.0) : 0.0;
+    result->cpu_percent = elapsed > 0 ? cpu / elapsed * 100.0 : 0.0;
+    return interrupted ? -2 : 0;
+}
+
+// Una passata completa di wipe_disk, fsync finale compreso
+static int bench_engine(int fd, const char *path, size_t size, const bench_options_t *options, io_engine_t engine,
+                        size_t chunk_size, unsigned int queue_depth, const char *pattern, bench_result_t *result) {
+    static io_stats_t stats;
+    wipe_options_t wipe;
+    checkpoint_t checkpoint;
+    progress_info_t progress;
+
+    memset(&wipe, 0, sizeof(wipe));
+    scheme_from_name(pattern, &wipe.scheme);
+    scheme_set_seed(&wipe.scheme, 0x5EED);
+    wipe.method = WIPE_METHOD_OVERWRITE;
+    io_config_default(&wipe.io);
+    wipe.io.engine = engine;
+    wipe.io.direct_io = options->direct_io;
+    wipe.io.chunk_size = chunk_size;
+    wipe.io.threads = 1;
+    wipe.io.tune = 0;
+    wipe.io.probe = 0;
+    if (engine == IO_ENGINE_URING) {
+        wipe.io.queue_depth = queue_depth;
+        if (wipe.io.batch_size > queue_depth) {
+            wipe.io.batch_size = queue_depth;
+        }
+    }
+
+    // Nessun journal: il benchmark non deve leggere né rimuovere quello di un wipe reale
+    if (checkpoint_init(&checkpoint, path, size, wipe.method, &wipe.scheme, 0x5EED, 0) != 0) {
+        return -1;
+    }
+    checkpoint.path[0] = '\0';
+
+    progress_init(&progress, size);
+    progress.quiet = 1;
+    progress.stats = &stats;
+
+    double cpu_start = cpu_seconds();
+    double start = now_seconds();
+    int status = wipe_disk(fd, path, size, &wipe, &checkpoint, &progress);
+    double elapsed = now_seconds() - start;
+    double cpu = cpu_seconds() - cpu_start;
+
+    memset(result, 0, sizeof(*result));
+    result->engine = io_engine_name(engine);
+    snprintf(result->pattern, sizeof(result->pattern), "%s", pattern);
+    result->chunk_size = chunk_size;
+    result->queue_depth = engine == IO_ENGINE_URING ? queue_depth : 0;
+    result->seconds = elapsed;
+    result->requests = stats.latency.total;
+    if (elapsed > 0) {
+        result->mbps = (double)progress.written_bytes / elapsed / (1024.0 * 1024.0);
+        result->iops = (double)stats.latency.total / elapsed;
+        result->cpu_percent = cpu / elapsed * 100.0;
+    }
+    result->p50_ns = latency_percentile(&stats.latency, 50.0);
+    result->p99_ns = latency_percentile(&stats.latency, 99.0);
+
+    return status;
+}
+
+static void print_header(void) {
+    printf("%-10s %-8s %8s %6s %10s %10s %7s %10s %10s\n", "Engine", "Pattern", "Chunk", "Depth", "MB/s", "IOPS",
+           "CPU%", "p50 us", "p99 us");
+}
+
+static void print_result(const bench_result_t *result) {
+    char chunk_str[32], depth_str[16];
+
+    format_bytes(result->chunk_size, chunk_str, sizeof(chunk_str));
+    if (result->queue_depth > 0) {
+        snprintf(depth_str, sizeof(depth_str), "%u", result->queue_depth);
+    } else {
+        snprintf(depth_str, sizeof(depth_str), "-");
+    }
+
+    printf("%-10s %-8s %8s %6s %10.1f", result->engine, result->pattern, chunk_str, depth_str, result->mbps);
+    if (result->requests > 0) {
+        printf(" %10.0f %7.1f %10.1f %10.1f\n", result->iops, result->cpu_percent, result->p50_ns / 1000.0,
+               result->p99_ns / 1000.0);
+    } else {
+        printf(" %10s %7.1f %10s %10s\n", "-", result->cpu_percent, "-", "-");
+    }
+    fflush(stdout);
+}
+
+static int write_json(const char *json_path, const char *target, size_t size, int direct_io,
+                      const bench_result_t *results, int count) {
+    FILE *out = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+    if (!out) {
+        perror("fopen");
+        return -1;
+    }
+
+    fprintf(out, "{\n  \"target\": ");
+    json_write_string(out, target);
+    fprintf(out, ",\n  \"bytes_per_case\": %zu,\n  \"direct_io\": %s,\n  \"results\": [\n", size,
+            direct_io ? "true" : "false");
+    for (int i = 0; i < count; i++) {
+        const bench_result_t *r = &results[i];
+        fprintf(out, "    {\"engine\": ");
+        json_write_string(out, r->engine);
+        fprintf(out, ", \"pattern\": ");
+        json_write_string(out, r->pattern);
+        fprintf(out, ", \"chunk_size\": %zu, ", r->chunk_size);
+        if (r->queue_depth > 0) {
+            fprintf(out, "\"queue_depth\": %u, ", r->queue_depth);
+        } else {
+            fprintf(out, "\"queue_depth\": null, ");
+        }
+        fprintf(out, "\"seconds\": %.3f, \"mbps\": %.1f, \"cpu_percent\": %.1f, ", r->seconds, r->mbps,
+                r->cpu_percent);
+        if (r->requests > 0) {
+            fprintf(out, "\"requests\": %llu, \"iops\": %.0f, \"p50_us\": %.1f, \"p99_us\": %.1f}",
+                    (unsigned long long)r->requests, r->iops, r->p50_ns / 1000.0, r->p99_ns / 1000.0);
+        } else {
+            fprintf(out, "\"requests\": null, \"iops\": null, \"p50_us\": null, \"p99_us\": null}");
+        }
+        fprintf(out, "%s\n", i + 1 < count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    bench_options_t options;
+    static bench_result_t results[BENCH_MAX_CASES];
+    int count = 0;
+    int status = 0;
+    size_t size;
+
+    if (parse_options(argc, argv, &options) != 0) {
+        return 1;
+    }
+
+    const char *target = argv[optind];
+    int fd = open_target(target, &options, &size);
+    if (fd < 0) {
+        return 1;
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    char size_str[32];
+    format_bytes(size, size_str, sizeof(size_str));
+    printf("Target: %s, %s per case%s\n\n", target, size_str, options.direct_io ? ", O_DIRECT" : "");
+    log_message("Benchmark started on %s (%zu bytes per case)", target, size);
+    print_header();
+
+    for (int p = 0; p < options.pattern_count && status == 0; p++) {
+        status = bench_generator(options.patterns[p], size, &results[count]);
+        if (status == 0) {
+            print_result(&results[count++]);
+        }
+
+        for (int e = 0; e < options.engine_count && status == 0; e++) {
+            io_engine_t engine = options.engines[e];
+            // Il motore sincrono ha una sola richiesta in volo: la queue depth non si applica
+            int depth_count = engine == IO_ENGINE_URING ? options.depth_count : 1;
+
+            for (int c = 0; c < options.chunk_count && status == 0; c++) {
+                for (int d = 0; d < depth_count && status == 0 && count < BENCH_MAX_CASES; d++) {
+                    status = bench_engine(fd, target, size, &options, engine, options.chunks[c], options.depths[d],
+                                          options.patterns[p], &results[count]);
+                    if (status == 0) {
+                        print_result(&results[count++]);
+                    }
+                }
+            }
+        }
+    }
+
+    close(fd);
+
+    if (status == -2) {
+        printf("\nBenchmark interrupted.\n");
+    } else if (status != 0) {
+        fprintf(stderr, "\nERROR: Benchmark case failed\n");
+    }
+
+    if (options.json_path && count > 0 && write_json(options.json_path, target, size, options.direct_io, results,
+                                                     count) != 0) {
+        status = -1;
+    }
+
+    log_message("Benchmark finished on %s: %d case(s)", target, count);
+    return status == 0 ? 0 : 1;
+}
@@ -0,0 +1,519 @@
+#include "blake3.h"
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define BLAKE3_X86 1
+#endif
+
+#define FLAG_CHUNK_START 0x01
+#define FLAG_CHUNK_END   0x02
+#define FLAG_PARENT      0x04
+#define FLAG_ROOT        0x08
+
+static const uint32_t IV[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+};
+
+// Ordine delle parole del messaggio in ciascuno dei 7 round (permutazione applicata ripetutamente)
+static const uint8_t MSG_SCHEDULE[7][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+    {3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1},
+    {10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+    {12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4},
+    {9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+    {11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13},
+};
+
+static inline uint32_t rotr32(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+static inline uint32_t load32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void store32(uint8_t *p, uint32_t w) {
+    p[0] = (uint8_t)w;
+    p[1] = (uint8_t)(w >> 8);
+    p[2] = (uint8_t)(w >> 16);
+    p[3] = (uint8_t)(w >> 24);
+}
+
+#define G(a, b, c, d, x, y)              \
+    do {                                 \
+        s[a] = s[a] + s[b] + (x);        \
+        s[d] = rotr32(s[d] ^ s[a], 16);  \
+        s[c] = s[c] + s[d];              \
+        s[b] = rotr32(s[b] ^ s[c], 12);  \
+        s[a] = s[a] + s[b] + (y);        \
+        s[d] = rotr32(s[d] ^ s[a], 8);   \
+        s[c] = s[c] + s[d];              \
+        s[b] = rotr32(s[b] ^ s[c], 7);   \
+    } while (0)
+
+// Funzione di compressione: i primi 8 word di s sono il nuovo chaining value
+static void compress(const uint32_t cv[8], const uint8_t block[BLAKE3_BLOCK_LEN], uint8_t block_len,
+                     uint64_t counter, uint8_t flags, uint32_t s[16]) {
+    uint32_t m[16];
+    for (int i = 0; i < 16; i++) {
+        m[i] = load32(block + 4 * i);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        s[i] = cv[i];
+    }
+    s[8] = IV[0];
+    s[9] = IV[1];
+    s[10] = IV[2];
+    s[11] = IV[3];
+    s[12] = (uint32_t)counter;
+    s[13] = (uint32_t)(counter >> 32);
+    s[14] = block_len;
+    s[15] = flags;
+
+    for (int r = 0; r < 7; r++) {
+        const uint8_t *k = MSG_SCHEDULE[r];
+        G(0, 4, 8, 12, m[k[0]], m[k[1]]);
+        G(1, 5, 9, 13, m[k[2]], m[k[3]]);
+        G(2, 6, 10, 14, m[k[4]], m[k[5]]);
+        G(3, 7, 11, 15, m[k[6]], m[k[7]]);
+        G(0, 5, 10, 15, m[k[8]], m[k[9]]);
+        G(1, 6, 11, 12, m[k[10]], m[k[11]]);
+        G(2, 7, 8, 13, m[k[12]], m[k[13]]);
+        G(3, 4, 9, 14, m[k[14]], m[k[15]]);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        s[i] ^= s[i + 8];
+        s[i + 8] ^= cv[i];
+    }
+}
+
+static void compress_in_place(uint32_t cv[8], const uint8_t block[BLAKE3_BLOCK_LEN], uint8_t block_len,
+                              uint64_t counter, uint8_t flags) {
+    uint32_t s[16];
+    compress(cv, block, block_len, counter, flags, s);
+    memcpy(cv, s, 8 * sizeof(uint32_t));
+}
+
+static void cv_to_bytes(const uint32_t cv[8], uint8_t out[BLAKE3_OUT_LEN]) {
+    for (int i = 0; i < 8; i++) {
+        store32(out + 4 * i, cv[i]);
+    }
+}
+
+// Chaining value di count chunk interi consecutivi, nessuno dei quali è la radice.
+// I kernel vettoriali comprimono un chunk per corsia (layout verticale, come prng.c).
+typedef void (*hash_chunks_fn)(const uint8_t *input, size_t count, uint64_t counter, uint8_t *out);
+
+static void hash_chunks_scalar(const uint8_t *input, size_t count, uint64_t counter, uint8_t *out) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t cv[8];
+        memcpy(cv, IV, sizeof(cv));
+        for (int b = 0; b < BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN; b++) {
+            uint8_t flags = (b == 0 ? FLAG_CHUNK_START : 0) |
+                            (b == BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN - 1 ? FLAG_CHUNK_END : 0);
+            compress_in_place(cv, input + b * BLAKE3_BLOCK_LEN, BLAKE3_BLOCK_LEN, counter + i, flags);
+        }
+        cv_to_bytes(cv, out + i * BLAKE3_OUT_LEN);
+        input += BLAKE3_CHUNK_LEN;
+    }
+}
+
+#ifdef BLAKE3_X86
+
+// Sette round sui 16 vettori di stato v con le parole del messaggio m
+#define VEC_ROUNDS(G)                                                  \
+    for (int r = 0; r < 7; r++) {                                      \
+        const uint8_t *k = MSG_SCHEDULE[r];                            \
+        G(v[0], v[4], v[8], v[12], m[k[0]], m[k[1]]);                  \
+        G(v[1], v[5], v[9], v[13], m[k[2]], m[k[3]]);                  \
+        G(v[2], v[6], v[10], v[14], m[k[4]], m[k[5]]);                 \
+        G(v[3], v[7], v[11], v[15], m[k[6]], m[k[7]]);                 \
+        G(v[0], v[5], v[10], v[15], m[k[8]], m[k[9]]);                 \
+        G(v[1], v[6], v[11], v[12], m[k[10]], m[k[11]]);               \
+        G(v[2], v[7], v[8], v[13], m[k[12]], m[k[13]]);                \
+        G(v[3], v[4], v[9], v[14], m[k[14]], m[k[15]]);                \
+    }
+
+// SSE2: 4 chunk in parallelo; senza pshufb la rotazione di 16 usa gli shuffle a 16 bit
+#define SSE_ROTR(x, n) _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - (n)))
+#define SSE_ROTR16(x) _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xB1), 0xB1)
+#define SSE_G(a, b, c, d, x, y) \
+    do { \
+        a = _mm_add_epi32(_mm_add_epi32(a, b), x); d = SSE_ROTR16(_mm_xor_si128(d, a)); \
+        c = _mm_add_epi32(c, d); b = SSE_ROTR(_mm_xor_si128(b, c), 12); \
+        a = _mm_add_epi32(_mm_add_epi32(a, b), y); d = SSE_ROTR(_mm_xor_si128(d, a), 8); \
+        c = _mm_add_epi32(c, d); b = SSE_ROTR(_mm_xor_si128(b, c), 7); \
+    } while (0)
+
+// Trasposizione 4x4 di parole da 32 bit
+#define SSE_TRANSPOSE(r0, r1, r2, r3, o0, o1, o2, o3) \
+    do { \
+        __m128i t0 = _mm_unpacklo_epi32(r0, r1), t1 = _mm_unpacklo_epi32(r2, r3); \
+        __m128i t2 = _mm_unpackhi_epi32(r0, r1), t3 = _mm_unpackhi_epi32(r2, r3); \
+        o0 = _mm_unpacklo_epi64(t0, t1); o1 = _mm_unpackhi_epi64(t0, t1); \
+        o2 = _mm_unpacklo_epi64(t2, t3); o3 = _mm_unpackhi_epi64(t2, t3); \
+    } while (0)
+
+static void hash_chunks_sse2(const uint8_t *input, size_t count, uint64_t counter, uint8_t *out) {
+    while (count >= 4) {
+        __m128i h[8], v[16], m[16];
+        uint32_t lo[4], hi[4];
+
+        for (int i = 0; i < 4; i++) {
+            lo[i] = (uint32_t)(counter + (uint64_t)i);
+            hi[i] = (uint32_t)((counter + (uint64_t)i) >> 32);
+        }
+        for (int i = 0; i < 8; i++) {
+            h[i] = _mm_set1_epi32((int)IV[i]);
+        }
+
+        for (int b = 0; b < BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN; b++) {
+            const uint8_t *block = input + b * BLAKE3_BLOCK_LEN;
+            uint8_t flags = (b == 0 ? FLAG_CHUNK_START : 0) |
+                            (b == BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN - 1 ? FLAG_CHUNK_END : 0);
+
+            // Parola i del blocco b di ogni chunk nella corsia del chunk
+            for (int q = 0; q < 4; q++) {
+                __m128i r0 = _mm_loadu_si128((const __m128i *)(block + 0 * BLAKE3_CHUNK_LEN + 16 * q));
+                __m128i r1 = _mm_loadu_si128((const __m128i *)(block + 1 * BLAKE3_CHUNK_LEN + 16 * q));
+                __m128i r2 = _mm_loadu_si128((const __m128i *)(block + 2 * BLAKE3_CHUNK_LEN + 16 * q));
+                __m128i r3 = _mm_loadu_si128((const __m128i *)(block + 3 * BLAKE3_CHUNK_LEN + 16 * q));
+                SSE_TRANSPOSE(r0, r1, r2, r3, m[4 * q], m[4 * q + 1], m[4 * q + 2], m[4 * q + 3]);
+            }
+
+            for (int i = 0; i < 8; i++) {
+                v[i] = h[i];
+            }
+            for (int i = 0; i < 4; i++) {
+                v[8 + i] = _mm_set1_epi32((int)IV[i]);
+            }
+            v[12] = _mm_loadu_si128((const __m128i *)lo);
+            v[13] = _mm_loadu_si128((const __m128i *)hi);
+            v[14] = _mm_set1_epi32(BLAKE3_BLOCK_LEN);
+            v[15] = _mm_set1_epi32(flags);
+
+            VEC_ROUNDS(SSE_G)
+
+            for (int i = 0; i < 8; i++) {
+                h[i] = _mm_xor_si128(v[i], v[i + 8]);
+            }
+        }
+
+        // Da verticale a un chaining value da 32 byte per chunk
+        __m128i o[8];
+        SSE_TRANSPOSE(h[0], h[1], h[2], h[3], o[0], o[2], o[4], o[6]);
+        SSE_TRANSPOSE(h[4], h[5], h[6], h[7], o[1], o[3], o[5], o[7]);
+        for (int i = 0; i < 8; i++) {
+            _mm_storeu_si128((__m128i *)(out + 16 * i), o[i]);
+        }
+
+        input += 4 * BLAKE3_CHUNK_LEN;
+        counter += 4;
+        count -= 4;
+        out += 4 * BLAKE3_OUT_LEN;
+    }
+
+    hash_chunks_scalar(input, count, counter, out);
+}
+
+// AVX2: 8 chunk in parallelo, rotazioni di 16 e 8 con lo shuffle a byte
+#define AVX_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+#define AVX_G(a, b, c, d, x, y) \
+    do { \
+        a = _mm256_add_epi32(_mm256_add_epi32(a, b), x); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot16); \
+        c = _mm256_add_epi32(c, d); b = AVX_ROTR(_mm256_xor_si256(b, c), 12); \
+        a = _mm256_add_epi32(_mm256_add_epi32(a, b), y); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot8); \
+        c = _mm256_add_epi32(c, d); b = AVX_ROTR(_mm256_xor_si256(b, c), 7); \
+    } while (0)
+
+// Trasposizione 8x8 di parole da 32 bit
+__attribute__((target("avx2")))
+static void avx2_transpose(__m256i r[8]) {
+    __m256i t[8], u[8];
+
+    for (int i = 0; i < 4; i++) {
+        t[2 * i] = _mm256_unpacklo_epi32(r[2 * i], r[2 * i + 1]);
+        t[2 * i + 1] = _mm256_unpackhi_epi32(r[2 * i], r[2 * i + 1]);
+    }
+    for (int i = 0; i < 2; i++) {
+        u[4 * i] = _mm256_unpacklo_epi64(t[4 * i], t[4 * i + 2]);
+        u[4 * i + 1] = _mm256_unpackhi_epi64(t[4 * i], t[4 * i + 2]);
+        u[4 * i + 2] = _mm256_unpacklo_epi64(t[4 * i + 1], t[4 * i + 3]);
+        u[4 * i + 3] = _mm256_unpackhi_epi64(t[4 * i + 1], t[4 * i + 3]);
+    }
+    for (int i = 0; i < 4; i++) {
+        r[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+        r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+    }
+}
+
+__attribute__((target("avx2")))
+static void hash_chunks_avx2(const uint8_t *input, size_t count, uint64_t counter, uint8_t *out) {
+    const __m256i rot16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                           2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m256i rot8 = _mm256_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12,
+                                          1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+
+    while (count >= 8) {
+        __m256i h[8], v[16], m[16];
+        uint32_t lo[8], hi[8];
+
+        for (int i = 0; i < 8; i++) {
+            lo[i] = (uint32_t)(counter + (uint64_t)i);
+            hi[i] = (uint32_t)((counter + (uint64_t)i) >> 32);
+        }
+        for (int i = 0; i < 8; i++) {
+            h[i] = _mm256_set1_epi32((int)IV[i]);
+        }
+
+        for (int b = 0; b < BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN; b++) {
+            const uint8_t *block = input + b * BLAKE3_BLOCK_LEN;
+            uint8_t flags = (b == 0 ? FLAG_CHUNK_START : 0) |
+                            (b == BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN - 1 ? FLAG_CHUNK_END : 0);
+
+            for (int half = 0; half < 2; half++) {
+                for (int j = 0; j < 8; j++) {
+                    m[8 * half + j] = _mm256_loadu_si256((const __m256i *)(block + j * BLAKE3_CHUNK_LEN + 32 * half));
+                }
+                avx2_transpose(&m[8 * half]);
+            }
+
+            for (int i = 0; i < 8; i++) {
+                v[i] = h[i];
+            }
+            for (int i = 0; i < 4; i++) {
+                v[8 + i] = _mm256_set1_epi32((int)IV[i]);
+            }
+            v[12] = _mm256_loadu_si256((const __m256i *)lo);
+            v[13] = _mm256_loadu_si256((const __m256i *)hi);
+            v[14] = _mm256_set1_epi32(BLAKE3_BLOCK_LEN);
+            v[15] = _mm256_set1_epi32(flags);
+
+            VEC_ROUNDS(AVX_G)
+
+            for (int i = 0; i < 8; i++) {
+                h[i] = _mm256_xor_si256(v[i], v[i + 8]);
+            }
+        }
+
+        avx2_transpose(h);
+        for (int i = 0; i < 8; i++) {
+            _mm256_storeu_si256((__m256i *)(out + 32 * i), h[i]);
+        }
+
+        input += 8 * BLAKE3_CHUNK_LEN;
+        counter += 8;
+        count -= 8;
+        out += 8 * BLAKE3_OUT_LEN;
+    }
+
+    hash_chunks_sse2(input, count, counter, out);
+}
+
+#endif // BLAKE3_X86
+
+static hash_chunks_fn active_fn = hash_chunks_scalar;
+static const char *active_name = "scalar";
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+
+static void detect_kernel(void) {
+#ifdef BLAKE3_X86
+    if (__builtin_cpu_supports("avx2")) {
+        active_fn = hash_chunks_avx2;
+        active_name = "avx2";
+    } else if (__builtin_cpu_supports("sse2")) {
+        active_fn = hash_chunks_sse2;
+        active_name = "sse2";
+    }
+#endif
+}
+
+const char *blake3_kernel_name(void) {
+    pthread_once(&kernel_once, detect_kernel);
+    return active_name;
+}
+
+// Nodo ancora da comprimere: la compressione dipende dal fatto che sia o no la radice
+typedef struct {
+    uint32_t cv[8];
+    uint8_t block[BLAKE3_BLOCK_LEN];
+    uint8_t block_len;
+    uint64_t counter;
+    uint8_t flags;
+} output_t;
+
+static void output_chaining_value(const output_t *output, uint8_t out[BLAKE3_OUT_LEN]) {
+    uint32_t cv[8];
+    memcpy(cv, output->cv, sizeof(cv));
+    compress_in_place(cv, output->block, output->block_len, output->counter, output->flags);
+    cv_to_bytes(cv, out);
+}
+
+static void parent_output(const uint8_t left[BLAKE3_OUT_LEN], const uint8_t right[BLAKE3_OUT_LEN], output_t *output) {
+    memcpy(output->cv, IV, sizeof(IV));
+    memcpy(output->block, left, BLAKE3_OUT_LEN);
+    memcpy(output->block + BLAKE3_OUT_LEN, right, BLAKE3_OUT_LEN);
+    output->block_len = BLAKE3_BLOCK_LEN;
+    output->counter = 0;
+    output->flags = FLAG_PARENT;
+}
+
+static size_t chunk_length(const blake3_hasher_t *hasher) {
+    return (size_t)hasher->blocks_compressed * BLAKE3_BLOCK_LEN + hasher->buf_len;
+}
+
+static uint8_t chunk_start_flag(const blake3_hasher_t *hasher) {
+    return hasher->blocks_compressed == 0 ? FLAG_CHUNK_START : 0;
+}
+
+// Aggiunge al chunk corrente al più i byte che gli mancano
+static void chunk_update(blake3_hasher_t *hasher, const uint8_t *input, size_t length) {
+    if (hasher->buf_len > 0) {
+        size_t take = BLAKE3_BLOCK_LEN - hasher->buf_len;
+        if (take > length) {
+            take = length;
+        }
+        memcpy(hasher->buf + hasher->buf_len, input, take);
+        hasher->buf_len += (uint8_t)take;
+        input += take;
+        length -= take;
+        // Il blocco si comprime solo se ne segue un altro: l'ultimo richiede CHUNK_END
+        if (length > 0) {
+            compress_in_place(hasher->cv, hasher->buf, BLAKE3_BLOCK_LEN, hasher->chunk_counter,
+                              chunk_start_flag(hasher));
+            hasher->blocks_compressed++;
+            hasher->buf_len = 0;
+        }
+    }
+
+    while (length > BLAKE3_BLOCK_LEN) {
+        compress_in_place(hasher->cv, input, BLAKE3_BLOCK_LEN, hasher->chunk_counter, chunk_start_flag(hasher));
+        hasher->blocks_compressed++;
+        input += BLAKE3_BLOCK_LEN;
+        length -= BLAKE3_BLOCK_LEN;
+    }
+
+    if (length > 0) {
+        memcpy(hasher->buf + hasher->buf_len, input, length);
+        hasher->buf_len += (uint8_t)length;
+    }
+}
+
+static void chunk_output(const blake3_hasher_t *hasher, output_t *output) {
+    memcpy(output->cv, hasher->cv, sizeof(hasher->cv));
+    memset(output->block, 0, sizeof(output->block));
+    memcpy(output->block, hasher->buf, hasher->buf_len);
+    output->block_len = hasher->buf_len;
+    output->counter = hasher->chunk_counter;
+    output->flags = chunk_start_flag(hasher) | FLAG_CHUNK_END;
+}
+
+// Un chunk completo entra nello stack: i sottoalberi di pari dimensione si fondono subito
+static void push_chunk_cv(blake3_hasher_t *hasher, uint8_t cv[BLAKE3_OUT_LEN], uint64_t total_chunks) {
+    while ((total_chunks & 1) == 0) {
+        output_t parent;
+        hasher->cv_stack_len--;
+        parent_output(hasher->cv_stack + (size_t)hasher->cv_stack_len * BLAKE3_OUT_LEN, cv, &parent);
+        output_chaining_value(&parent, cv);
+        total_chunks >>= 1;
+    }
+    memcpy(hasher->cv_stack + (size_t)hasher->cv_stack_len * BLAKE3_OUT_LEN, cv, BLAKE3_OUT_LEN);
+    hasher->cv_stack_len++;
+}
+
+void blake3_init(blake3_hasher_t *hasher) {
+    memcpy(hasher->cv, IV, sizeof(IV));
+    hasher->chunk_counter = 0;
+    memset(hasher->buf, 0, sizeof(hasher->buf));
+    hasher->buf_len = 0;
+    hasher->blocks_compressed = 0;
+    hasher->cv_stack_len = 0;
+}
+
+void blake3_update(blake3_hasher_t *hasher, const void *data, size_t length) {
+    const uint8_t *input = data;
+
+    pthread_once(&kernel_once, detect_kernel);
+
+    while (length > 0) {
+        // Chunk interi seguiti da altri byte: nessuno può essere la radice, si comprimono insieme
+        if (chunk_length(hasher) == 0 && length > BLAKE3_CHUNK_LEN) {
+            uint8_t cvs[BLAKE3_BATCH_CHUNKS * BLAKE3_OUT_LEN];
+            size_t count = (length - 1) / BLAKE3_CHUNK_LEN;
+            if (count > BLAKE3_BATCH_CHUNKS) {
+                count = BLAKE3_BATCH_CHUNKS;
+            }
+
+            active_fn(input, count, hasher->chunk_counter, cvs);
+            for (size_t i = 0; i < count; i++) {
+                push_chunk_cv(hasher, cvs + i * BLAKE3_OUT_LEN, hasher->chunk_counter + i + 1);
+            }
+            hasher->chunk_counter += count;
+            input += count * BLAKE3_CHUNK_LEN;
+            length -= count * BLAKE3_CHUNK_LEN;
+            continue;
+        }
+
+        // Chunk pieno e altri byte in arrivo: non può essere la radice, va nello stack
+        if (chunk_length(hasher) == BLAKE3_CHUNK_LEN) {
+            output_t output;
+            uint8_t cv[BLAKE3_OUT_LEN];
+            chunk_output(hasher, &output);
+            output_chaining_value(&output, cv);
+            uint64_t total_chunks = hasher->chunk_counter + 1;
+            push_chunk_cv(hasher, cv, total_chunks);
+
+            memcpy(hasher->cv, IV, sizeof(IV));
+            hasher->chunk_counter = total_chunks;
+            hasher->buf_len = 0;
+            hasher->blocks_compressed = 0;
+        }
+
+        size_t take = BLAKE3_CHUNK_LEN - chunk_length(hasher);
+        if (take > length) {
+            take = length;
+        }
+        chunk_update(hasher, input, take);
+        input += take;
+        length -= take;
+    }
+}
+
+void blake3_final(const blake3_hasher_t *hasher, uint8_t out[BLAKE3_OUT_LEN]) {
+    output_t output;
+    chunk_output(hasher, &output);
+
+    // Si risale lo stack da destra: ogni livello diventa il figlio destro del precedente
+    for (int i = hasher->cv_stack_len - 1; i >= 0; i--) {
+        uint8_t cv[BLAKE3_OUT_LEN];
+        output_chaining_value(&output, cv);
+        parent_output(hasher->cv_stack + (size_t)i * BLAKE3_OUT_LEN, cv, &output);
+    }
+
+    uint32_t s[16];
+    compress(output.cv, output.block, output.block_len, output.counter, output.flags | FLAG_ROOT, s);
+    cv_to_bytes(s, out);
+}
+
+void blake3_hash(const void *data, size_t length, uint8_t out[BLAKE3_OUT_LEN]) {
+    blake3_hasher_t hasher;
+    blake3_init(&hasher);
+    blake3_update(&hasher, data, length);
+    blake3_final(&hasher, out);
+}
+
+char *blake3_hex(const uint8_t digest[BLAKE3_OUT_LEN], char *hex) {
+    static const char digits[] = "0123456789abcdef";
+
+    for (int i = 0; i < BLAKE3_OUT_LEN; i++) {
+        hex[2 * i] = digits[digest[i] >> 4];
+        hex[2 * i + 1] = digits[digest[i] & 0x0f];
+    }
+    hex[2 * BLAKE3_OUT_LEN] = '\0';
+    return hex;
+}
@@ -0,0 +1,35 @@
+#ifndef BLAKE3_H
+#define BLAKE3_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// BLAKE3 (hash da 32 byte, senza chiave). I chunk da 1 KiB di un input lungo si comprimono insieme,
+// uno per corsia, con kernel AVX2/SSE2 scelti a runtime (scalare altrove); i thread sono in digest.h.
+#define BLAKE3_OUT_LEN 32
+#define BLAKE3_BLOCK_LEN 64
+#define BLAKE3_CHUNK_LEN 1024
+#define BLAKE3_MAX_DEPTH 54 // chunk fino a 2^64 byte
+#define BLAKE3_BATCH_CHUNKS 16 // chunk consegnati insieme al kernel vettoriale
+
+typedef struct {
+    uint32_t cv[8];
+    uint64_t chunk_counter;
+    uint8_t buf[BLAKE3_BLOCK_LEN];
+    uint8_t buf_len;
+    uint8_t blocks_compressed;
+    uint8_t cv_stack_len;
+    uint8_t cv_stack[BLAKE3_MAX_DEPTH * BLAKE3_OUT_LEN]; // chaining value dei sottoalberi completi a sinistra
+} blake3_hasher_t;
+
+void blake3_init(blake3_hasher_t *hasher);
+void blake3_update(blake3_hasher_t *hasher, const void *data, size_t length);
+void blake3_final(const blake3_hasher_t *hasher, uint8_t out[BLAKE3_OUT_LEN]);
+// Hash di un buffer in una sola chiamata
+void blake3_hash(const void *data, size_t length, uint8_t out[BLAKE3_OUT_LEN]);
+// Kernel usato per i chunk: "avx2", "sse2" o "scalar"
+const char *blake3_kernel_name(void);
+// Digest in esadecimale minuscolo, hex deve contenere 2 * BLAKE3_OUT_LEN + 1 byte
+char *blake3_hex(const uint8_t digest[BLAKE3_OUT_LEN], char *hex);
+
+#endif // BLAKE3_H
@@ -0,0 +1,161 @@
+#define _GNU_SOURCE
+
+#include "cert.h"
+#include "blake3.h"
+#include "sysfs.h"
+#include "utils.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static void write_identity(FILE *out, const char *disk_path) {
+    char model[128], serial[128], wwn[128];
+
+    if (sysfs_read_string(disk_path, "device/model", model, sizeof(model)) != 0) {
+        model[0] = '\0';
+    }
+    if (sysfs_read_string(disk_path, "device/serial", serial, sizeof(serial)) != 0) {
+        serial[0] = '\0';
+    }
+    if (sysfs_read_string(disk_path, "wwid", wwn, sizeof(wwn)) != 0 &&
+        sysfs_read_string(disk_path, "device/wwid", wwn, sizeof(wwn)) != 0) {
+        wwn[0] = '\0';
+    }
+
+    fprintf(out, "  \"device\": {\"path\": ");
+    json_write_string(out, disk_path);
+    fprintf(out, ", \"model\": ");
+    json_write_string(out, model);
+    fprintf(out, ", \"serial\": ");
+    json_write_string(out, serial);
+    fprintf(out, ", \"wwn\": ");
+    json_write_string(out, wwn);
+}
+
+static void write_digest(FILE *out, const digest_t *digest) {
+    char hex[DIGEST_HEX_SIZE];
+    size_t count;
+    const digest_region_t *regions = digest_regions(digest, &count);
+
+    fprintf(out, "  \"digest\": {\"algorithm\": \"BLAKE3\", \"leaf_size\": %d, \"region_size\": %llu,\n",
+            DIGEST_LEAF_SIZE, (unsigned long long)DIGEST_REGION_SIZE);
+    fprintf(out, "    \"construction\": \"leaf = BLAKE3(leaf bytes), region = BLAKE3(leaf digests), "
+            "root = BLAKE3(region digests)\",\n");
+    fprintf(out, "    \"bytes\": %zu, \"root\": \"%s\",\n    \"regions\": [", digest_bytes(digest),
+            blake3_hex(digest_root(digest), hex));
+    for (size_t i = 0; i < count; i++) {
+        fprintf(out, "%s\n      {\"offset\": %zu, \"length\": %zu, \"digest\": \"%s\"}", i > 0 ? "," : "",
+                regions[i].offset, regions[i].length, blake3_hex(regions[i].digest, hex));
+    }
+    fprintf(out, "\n    ]}\n");
+}
+
+static int write_certificate(FILE *out, const cert_info_t *info) {
+    const wipe_options_t *options = info->options;
+    const verify_result_t *verify = info->verify;
+    char host[256];
+
+    if (gethostname(host, sizeof(host)) != 0) {
+        snprintf(host, sizeof(host), "unknown");
+    }
+    host[sizeof(host) - 1] = '\0';
+
+    fprintf(out, "{\n  \"tool\": \"disk_eraser\", \"version\": \"%s\", \"host\": ", VERSION);
+    json_write_string(out, host);
+    fprintf(out, ",\n");
+    write_identity(out, info->disk_path);
+    fprintf(out, ", \"size\": %zu},\n", info->size);
+
+    fprintf(out, "  \"erase\": {\"method\": \"%s\", \"scheme\": \"%s\", \"passes\": [",
+            wipe_method_name(options->method), options->scheme.name);
+    for (int i = 0; i < options->scheme.pass_count; i++) {
+        char pattern[16];
+        fprintf(out, "%s\"%s\"", i > 0 ? ", " : "",
+                pattern_describe(&options->scheme.passes[i], pattern, sizeof(pattern)));
+    }
+    fprintf(out, "], \"seed\": \"0x%016llx\", \"resumed\": %s,\n", (unsigned long long)options->seed,
+            info->resumed ? "true" : "false");
+    fprintf(out, "    \"bytes_written\": %zu, \"seconds\": %.3f", info->written, info->wipe_seconds);
+    if (info->stats) {
+        const io_stats_t *stats = info->stats;
+        uint64_t shown = stats->bad_count < IO_STATS_MAX_BAD_RANGES ? stats->bad_count : IO_STATS_MAX_BAD_RANGES;
+        fprintf(out, ", \"unwritable_bytes\": %llu, \"unwritable_ranges\": [", (unsigned long long)stats->bad_bytes);
+        for (uint64_t i = 0; i < shown; i++) {
+            fprintf(out, "%s{\"offset\": %zu, \"length\": %zu}", i > 0 ? ", " : "", stats->bad_ranges[i].offset,
+                    stats->bad_ranges[i].length);
+        }
+        fprintf(out, "]");
+    }
+    fprintf(out, "},\n");
+
+    fprintf(out, "  \"started\": ");
+    json_write_time(out, info->started);
+    fprintf(out, ", \"finished\": ");
+    json_write_time(out, info->finished);
+    fprintf(out, ",\n  \"result\": \"%s\",\n", info->result);
+
+    fprintf(out, "  \"verify\": {\"mode\": \"%s\", \"bytes_read\": %zu, \"mismatched_bytes\": %zu, \"ranges\": [",
+            verify_mode_name(options->verify.mode), verify->bytes_read, verify->mismatched_bytes);
+    for (int i = 0; i < verify->stored; i++) {
+        fprintf(out, "%s{\"offset\": %zu, \"length\": %zu}", i > 0 ? ", " : "", verify->ranges[i].offset,
+                verify->ranges[i].length);
+    }
+    fprintf(out, "], \"range_count\": %zu, \"seconds\": %.3f},\n", verify->range_count, verify->seconds);
+
+    write_digest(out, info->digest);
+    fprintf(out, "}\n");
+
+    return ferror(out) ? -1 : 0;
+}
+
+int cert_write(const char *dir, const cert_info_t *info, char *path, size_t path_size) {
+    char name[64], stamp[32], tmp_path[PATH_MAX + 8];
+    struct tm tm;
+
+    if (digest_finish(info->digest) != 0) {
+        fprintf(stderr, "ERROR: Digest of %s is incomplete, no certificate written\n", info->disk_path);
+        return -1;
+    }
+
+    if (sysfs_device_name(info->disk_path, name, sizeof(name)) != 0) {
+        const char *base = strrchr(info->disk_path, '/');
+        snprintf(name, sizeof(name), "%s", base ? base + 1 : info->disk_path);
+    }
+    gmtime_r(&info->finished, &tm);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+
+    if (snprintf(path, path_size, "%s/disk_eraser.%s.%s" CERT_SUFFIX, dir, name, stamp) >= (int)path_size) {
+        fprintf(stderr, "ERROR: Certificate path too long in %s\n", dir);
+        return -1;
+    }
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *out = fopen(tmp_path, "w");
+    if (!out) {
+        perror("fopen(certificate)");
+        return -1;
+    }
+
+    // Come i risultati del job: il certificato è sempre completo o assente
+    if (write_certificate(out, info) != 0 || fflush(out) != 0 || fsync(fileno(out)) != 0) {
+        perror("write(certificate)");
+        fclose(out);
+        unlink(tmp_path);
+        return -1;
+    }
+    fclose(out);
+
+    if (rename(tmp_path, path) != 0) {
+        perror("rename(certificate)");
+        unlink(tmp_path);
+        return -1;
+    }
+
+    char hex[DIGEST_HEX_SIZE];
+    double hashed = digest_seconds(info->digest);
+    log_message("Certificate: %s written to %s, BLAKE3 root %s, %zu bytes hashed on %u thread(s) in %.1fs "
+                "(%s kernel)", info->disk_path, path, blake3_hex(digest_root(info->digest), hex),
+                digest_bytes(info->digest), digest_threads(info->digest), hashed, blake3_kernel_name());
+    return 0;
+}
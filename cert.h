@@ -0,0 +1,35 @@
+#ifndef CERT_H
+#define CERT_H
+
+#include <stddef.h>
+#include <time.h>
+#include "digest.h"
+#include "disk_ops.h"
+#include "io_stats.h"
+#include "verify.h"
+
+// Certificato di cancellazione: JSON con identità del device, metodo, passate, tempi, esito della
+// verifica completa e digest per regione del contenuto riletto (digest.h), scritto in modo atomico
+// come DIR/disk_eraser.<device>.<YYYYmmdd-HHMMSS>.cert.json
+#define CERT_SUFFIX ".cert.json"
+
+typedef struct {
+    const char *disk_path;
+    size_t size;
+    const wipe_options_t *options;
+    const char *result;             // "success" o "mismatch"
+    time_t started;                 // inizio del wipe e fine della verifica (UTC nel certificato)
+    time_t finished;
+    double wipe_seconds;
+    size_t written;                 // byte scritti dal wipe
+    int resumed;                    // ripreso da un checkpoint
+    const io_stats_t *stats;        // range non scrivibili, NULL se non misurati
+    const verify_result_t *verify;
+    digest_t *digest;               // alimentato dalla verifica completa, la radice la calcola cert_write
+} cert_info_t;
+
+// Completa il digest e scrive il certificato in dir; il percorso finale va in path.
+// Ritorna 0, oppure -1 se il digest non copre tutto il device o la scrittura fallisce.
+int cert_write(const char *dir, const cert_info_t *info, char *path, size_t path_size);
+
+#endif // CERT_H
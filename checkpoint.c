@@ -0,0 +1,364 @@
+#define _GNU_SOURCE
+
+#include "checkpoint.h"
+#include "sysfs.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+
+#define CHECKPOINT_VERSION 1
+
+// Nome del journal nella directory corrente, accanto a disk_erase.log
+static void journal_path(const char *disk_path, char *path, size_t path_size) {
+    char name[NAME_MAX + 1];
+
+    if (sysfs_device_name(disk_path, name, sizeof(name)) != 0) {
+        const char *base = strrchr(disk_path, '/');
+        snprintf(name, sizeof(name), "%s", base ? base + 1 : disk_path);
+    }
+
+    snprintf(path, path_size, "disk_eraser.%s.journal", name);
+}
+
+// Identità stabile del device: il nome in /dev può cambiare tra un riavvio e l'altro
+static void device_identity(const char *disk_path, char *identity, size_t identity_size) {
+    static const char *const attrs[] = {"wwid", "device/wwid", "device/serial", "loop/backing_file"};
+    char value[200];
+    char attr[64];
+    unsigned long long start;
+
+    // Le partizioni ereditano l'identità del disco, distinta dal settore di inizio
+    int partition = sysfs_read_u64(disk_path, "partition", &start) == 0;
+
+    snprintf(identity, identity_size, "unknown");
+
+    for (size_t i = 0; i < sizeof(attrs) / sizeof(attrs[0]); i++) {
+        snprintf(attr, sizeof(attr), "%s%s", partition ? "../" : "", attrs[i]);
+        if (sysfs_read_string(disk_path, attr, value, sizeof(value)) != 0) {
+            continue;
+        }
+
+        if (partition && sysfs_read_u64(disk_path, "start", &start) == 0) {
+            snprintf(identity, identity_size, "%s=%s@%llu", attrs[i], value, start);
+        } else {
+            snprintf(identity, identity_size, "%s=%s", attrs[i], value);
+        }
+        return;
+    }
+}
+
+int checkpoint_init(checkpoint_t *checkpoint, const char *disk_path, size_t disk_size, wipe_method_t method,
+                    const wipe_scheme_t *scheme, uint64_t seed, unsigned int interval) {
+    memset(checkpoint, 0, sizeof(*checkpoint));
+    journal_path(disk_path, checkpoint->path, sizeof(checkpoint->path));
+    snprintf(checkpoint->device, sizeof(checkpoint->device), "%s", disk_path);
+    device_identity(disk_path, checkpoint->identity, sizeof(checkpoint->identity));
+    checkpoint->disk_size = disk_size;
+    checkpoint->method = method;
+    snprintf(checkpoint->scheme, sizeof(checkpoint->scheme), "%s", scheme->name);
+    checkpoint->seed = seed;
+    checkpoint->pass_count = scheme->pass_count;
+
+    size_t used = 0;
+    for (int i = 0; i < scheme->pass_count; i++) {
+        char pattern_str[16];
+        pattern_describe(&scheme->passes[i], pattern_str, sizeof(pattern_str));
+        used += (size_t)snprintf(checkpoint->passes + used, sizeof(checkpoint->passes) - used, "%s%s",
+                                 i > 0 ? "," : "", pattern_str);
+    }
+
+    checkpoint->interval = interval;
+    checkpoint->fd = -1;
+    return 0;
+}
+
+int checkpoint_load(checkpoint_t *checkpoint, const char *disk_path) {
+    char path[PATH_MAX];
+    char line[512];
+
+    journal_path(disk_path, path, sizeof(path));
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return errno == ENOENT ? 1 : -1;
+    }
+
+    memset(checkpoint, 0, sizeof(*checkpoint));
+    snprintf(checkpoint->path, sizeof(checkpoint->path), "%s", path);
+    checkpoint->fd = -1;
+
+    int version = 0;
+    int stripes = 0;
+    int valid = 1;
+
+    while (valid && fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\n")] = '\0';
+
+        char *value = strchr(line, '=');
+        if (!value) {
+            continue;
+        }
+        *value++ = '\0';
+
+        if (strcmp(line, "version") == 0) {
+            version = atoi(value);
+        } else if (strcmp(line, "device") == 0) {
+            snprintf(checkpoint->device, sizeof(checkpoint->device), "%s", value);
+        } else if (strcmp(line, "identity") == 0) {
+            snprintf(checkpoint->identity, sizeof(checkpoint->identity), "%s", value);
+        } else if (strcmp(line, "size") == 0) {
+            checkpoint->disk_size = (size_t)strtoull(value, NULL, 10);
+        } else if (strcmp(line, "method") == 0) {
+            valid = wipe_method_from_name(value, &checkpoint->method) == 0;
+        } else if (strcmp(line, "scheme") == 0) {
+            snprintf(checkpoint->scheme, sizeof(checkpoint->scheme), "%s", value);
+        } else if (strcmp(line, "passes") == 0) {
+            snprintf(checkpoint->passes, sizeof(checkpoint->passes), "%s", value);
+        } else if (strcmp(line, "seed") == 0) {
+            checkpoint->seed = strtoull(value, NULL, 0);
+        } else if (strcmp(line, "pass") == 0) {
+            checkpoint->pass = atoi(value);
+        } else if (strcmp(line, "pass_count") == 0) {
+            checkpoint->pass_count = atoi(value);
+        } else if (strcmp(line, "stripes") == 0) {
+            checkpoint->stripe_count = atoi(value);
+        } else if (strcmp(line, "stripe") == 0) {
+            checkpoint_stripe_t *stripe = &checkpoint->stripes[stripes];
+            unsigned long long start, end, done;
+
+            valid = stripes < CHECKPOINT_MAX_STRIPES &&
+                    sscanf(value, "%llu %llu %llu", &start, &end, &done) == 3 &&
+                    start <= done && done <= end;
+            if (valid) {
+                stripe->start = (size_t)start;
+                stripe->end = (size_t)end;
+                stripe->done = (size_t)done;
+                stripes++;
+            }
+        }
+    }
+
+    fclose(fp);
+
+    if (!valid || version != CHECKPOINT_VERSION || stripes != checkpoint->stripe_count ||
+        checkpoint->pass_count <= 0 || checkpoint->pass < 0 || checkpoint->pass >= checkpoint->pass_count ||
+        checkpoint->disk_size == 0) {
+        fprintf(stderr, "ERROR: Checkpoint journal %s is corrupted\n", path);
+        return -1;
+    }
+
+    // Gli stripe devono coprire il device senza buchi: un intervallo mancante non verrebbe mai scritto
+    for (int i = 0; i < checkpoint->stripe_count; i++) {
+        size_t expected = i > 0 ? checkpoint->stripes[i - 1].end : 0;
+        if (checkpoint->stripes[i].start != expected) {
+            fprintf(stderr, "ERROR: Checkpoint journal %s is corrupted: stripe %d starts at %zu, expected %zu\n",
+                    path, i + 1, checkpoint->stripes[i].start, expected);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int checkpoint_matches(const checkpoint_t *checkpoint, const char *disk_path, size_t disk_size,
+                       size_t aligned_size) {
+    char identity[256];
+
+    device_identity(disk_path, identity, sizeof(identity));
+
+    if (strcmp(identity, checkpoint->identity) != 0) {
+        fprintf(stderr, "ERROR: %s is not the device of the checkpoint (found %s, expected %s)\n",
+                disk_path, identity, checkpoint->identity);
+        return 0;
+    }
+
+    if (disk_size != checkpoint->disk_size) {
+        fprintf(stderr, "ERROR: Size of %s changed since the checkpoint (%zu bytes, expected %zu)\n",
+                disk_path, disk_size, checkpoint->disk_size);
+        return 0;
+    }
+
+    // Stripe contigui da 0 (checkpoint_load): l'ultimo deve finire dove finirà la passata
+    if (checkpoint->stripe_count > 0 && checkpoint->stripes[checkpoint->stripe_count - 1].end != aligned_size) {
+        fprintf(stderr, "ERROR: Checkpoint stripes of %s end at %zu bytes, expected %zu (--direct changed?)\n",
+                disk_path, checkpoint->stripes[checkpoint->stripe_count - 1].end, aligned_size);
+        return 0;
+    }
+
+    return 1;
+}
+
+size_t checkpoint_done_bytes(const checkpoint_t *checkpoint) {
+    size_t done = checkpoint->disk_size * (size_t)checkpoint->pass;
+
+    for (int i = 0; i < checkpoint->stripe_count; i++) {
+        done += checkpoint->stripes[i].done - checkpoint->stripes[i].start;
+    }
+
+    return done;
+}
+
+double checkpoint_percent(const checkpoint_t *checkpoint) {
+    double total = (double)checkpoint->disk_size * (double)checkpoint->pass_count;
+    return total > 0 ? 100.0 * (double)checkpoint_done_bytes(checkpoint) / total : 0.0;
+}
+
+static int write_journal(const checkpoint_t *checkpoint, const size_t *done) {
+    char tmp_path[PATH_MAX + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", checkpoint->path);
+
+    FILE *fp = fopen(tmp_path, "w");
+    if (!fp) {
+        perror("fopen(checkpoint)");
+        return -1;
+    }
+
+    fprintf(fp, "version=%d\n", CHECKPOINT_VERSION);
+    fprintf(fp, "device=%s\n", checkpoint->device);
+    fprintf(fp, "identity=%s\n", checkpoint->identity);
+    fprintf(fp, "size=%zu\n", checkpoint->disk_size);
+    fprintf(fp, "method=%s\n", wipe_method_name(checkpoint->method));
+    fprintf(fp, "scheme=%s\n", checkpoint->scheme);
+    fprintf(fp, "passes=%s\n", checkpoint->passes);
+    fprintf(fp, "seed=0x%016llx\n", (unsigned long long)checkpoint->seed);
+    fprintf(fp, "pass=%d\n", checkpoint->pass);
+    fprintf(fp, "pass_count=%d\n", checkpoint->pass_count);
+    fprintf(fp, "stripes=%d\n", checkpoint->stripe_count);
+    for (int i = 0; i < checkpoint->stripe_count; i++) {
+        const checkpoint_stripe_t *stripe = &checkpoint->stripes[i];
+        fprintf(fp, "stripe=%zu %zu %zu\n", stripe->start, stripe->end, done ? done[i] : stripe->done);
+    }
+
+    // Il rename sostituisce il journal precedente solo quando il nuovo è completo su disco
+    int result = 0;
+    if (fflush(fp) != 0 || fsync(fileno(fp)) < 0) {
+        perror("fsync(checkpoint)");
+        result = -1;
+    }
+    if (fclose(fp) != 0) {
+        result = -1;
+    }
+    if (result == 0 && rename(tmp_path, checkpoint->path) < 0) {
+        perror("rename(checkpoint)");
+        result = -1;
+    }
+
+    if (result != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+
+    // Rendere durevole anche la voce di directory
+    int dir_fd = open(".", O_RDONLY | O_DIRECTORY);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+
+    return 0;
+}
+
+int checkpoint_save(checkpoint_t *checkpoint) {
+    if (checkpoint->interval == 0) {
+        return 0;
+    }
+    return write_journal(checkpoint, NULL);
+}
+
+void checkpoint_remove(const checkpoint_t *checkpoint) {
+    if (checkpoint->path[0] != '\0' && unlink(checkpoint->path) == 0) {
+        log_message("Checkpoint journal %s removed", checkpoint->path);
+    }
+}
+
+// I prefissi vanno letti prima del flush: solo ciò che era già scritto è sicuramente durevole
+static int checkpoint_flush(checkpoint_t *checkpoint) {
+    size_t done[CHECKPOINT_MAX_STRIPES];
+
+    for (int i = 0; i < checkpoint->stripe_count; i++) {
+        done[i] = __atomic_load_n(&checkpoint->stripes[i].done, __ATOMIC_ACQUIRE);
+    }
+
+    if (fsync(checkpoint->fd) < 0 || write_journal(checkpoint, done) != 0) {
+        log_message("Checkpoint of %s failed", checkpoint->device);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void *checkpoint_thread(void *arg) {
+    checkpoint_t *checkpoint = arg;
+    sigset_t mask;
+
+    // SIGINT/SIGTERM restano al thread principale
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    pthread_mutex_lock(&checkpoint->lock);
+    while (checkpoint->running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += checkpoint->interval;
+
+        int wait = 0;
+        while (checkpoint->running && wait != ETIMEDOUT) {
+            wait = pthread_cond_timedwait(&checkpoint->wakeup, &checkpoint->lock, &deadline);
+        }
+        if (!checkpoint->running) {
+            break;
+        }
+
+        pthread_mutex_unlock(&checkpoint->lock);
+        checkpoint_flush(checkpoint);
+        pthread_mutex_lock(&checkpoint->lock);
+    }
+    pthread_mutex_unlock(&checkpoint->lock);
+
+    return NULL;
+}
+
+int checkpoint_start(checkpoint_t *checkpoint, int fd) {
+    checkpoint->fd = fd;
+    if (checkpoint->interval == 0) {
+        return 0;
+    }
+
+    pthread_mutex_init(&checkpoint->lock, NULL);
+    pthread_cond_init(&checkpoint->wakeup, NULL);
+    checkpoint->running = 1;
+
+    if (pthread_create(&checkpoint->thread, NULL, checkpoint_thread, checkpoint) != 0) {
+        perror("pthread_create");
+        checkpoint->running = 0;
+        pthread_cond_destroy(&checkpoint->wakeup);
+        pthread_mutex_destroy(&checkpoint->lock);
+        return -1;
+    }
+
+    return 0;
+}
+
+int checkpoint_stop(checkpoint_t *checkpoint) {
+    if (checkpoint->interval == 0 || !checkpoint->running) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&checkpoint->lock);
+    checkpoint->running = 0;
+    pthread_cond_signal(&checkpoint->wakeup);
+    pthread_mutex_unlock(&checkpoint->lock);
+
+    pthread_join(checkpoint->thread, NULL);
+    pthread_cond_destroy(&checkpoint->wakeup);
+    pthread_mutex_destroy(&checkpoint->lock);
+
+    return checkpoint_flush(checkpoint);
+}
@@ -0,0 +1,72 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <limits.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "offload.h"
+#include "pattern.h"
+#include "progress.h"
+
+#define CHECKPOINT_DEFAULT_INTERVAL 30 // secondi tra due checkpoint durante il wipe
+#define CHECKPOINT_MAX_STRIPES PROGRESS_MAX_THREADS
+
+// Stripe della passata in corso: [start, done) è scritto, [done, end) resta da scrivere
+typedef struct {
+    size_t start;
+    size_t end;
+    size_t done; // aggiornato dai writer in modo atomico, durevole solo dopo il flush del checkpoint
+} checkpoint_stripe_t;
+
+// Journal di un wipe in corso, salvato accanto al log come disk_eraser.<dev>.journal.
+// Basta a riprendere dopo SIGINT, crash o mancanza di corrente: identità e dimensione
+// del device, metodo, schema e seed, passata corrente e prefisso durevole di ogni stripe.
+typedef struct {
+    char path[PATH_MAX];  // file del journal (vuoto: nessun file, es. disk_eraser_bench)
+    char device[256];
+    char identity[256];   // WWN/serial dal sysfs ("unknown" se non disponibile)
+    size_t disk_size;
+    wipe_method_t method;
+    char scheme[64];      // nome mostrato all'utente
+    char passes[PATTERN_MAX_PASSES * 8]; // passate come lista (random,0x00,...), da cui si ricostruisce lo schema
+    uint64_t seed;
+    int pass;             // passata in corso (0-based)
+    int pass_count;
+    int stripe_count;     // 0 finché la passata non è stata suddivisa
+    checkpoint_stripe_t stripes[CHECKPOINT_MAX_STRIPES];
+
+    // Salvataggio periodico durante il wipe
+    unsigned int interval; // secondi, 0 disabilita il journal
+    int fd;
+    int running;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+} checkpoint_t;
+
+// Prepara un journal nuovo (passata 0, nessuno stripe) per il device
+int checkpoint_init(checkpoint_t *checkpoint, const char *disk_path, size_t disk_size, wipe_method_t method,
+                    const wipe_scheme_t *scheme, uint64_t seed, unsigned int interval);
+// Legge il journal del device; ritorna 0 se presente, 1 se non esiste, -1 se illeggibile
+// (anche se gli stripe non sono contigui a partire da 0)
+int checkpoint_load(checkpoint_t *checkpoint, const char *disk_path);
+// Vero se il journal appartiene a questo device (identità e dimensione) e i suoi stripe coprono
+// [0, aligned_size), la parte scritta a stripe; altrimenti stampa il motivo
+int checkpoint_matches(const checkpoint_t *checkpoint, const char *disk_path, size_t disk_size,
+                       size_t aligned_size);
+// Byte già cancellati: passate complete più i prefissi scritti degli stripe
+size_t checkpoint_done_bytes(const checkpoint_t *checkpoint);
+// Percentuale del wipe completo (tutte le passate) già cancellata
+double checkpoint_percent(const checkpoint_t *checkpoint);
+
+// Scrittura atomica (file temporaneo, fsync, rename); no-op con interval 0
+int checkpoint_save(checkpoint_t *checkpoint);
+void checkpoint_remove(const checkpoint_t *checkpoint);
+
+// Thread che ogni interval secondi fa il flush del device e poi salva i prefissi letti prima del flush.
+// checkpoint_stop esegue l'ultimo flush e salvataggio.
+int checkpoint_start(checkpoint_t *checkpoint, int fd);
+int checkpoint_stop(checkpoint_t *checkpoint);
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,329 @@
+#define _GNU_SOURCE
+
+#include "digest.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LEAVES_PER_REGION (DIGEST_REGION_SIZE / DIGEST_LEAF_SIZE)
+
+struct digest {
+    size_t size;
+    size_t region_count;
+    digest_region_t *regions;
+    uint8_t **leaves;     // digest delle foglie per regione, allocati al primo chunk e liberati a regione completa
+    size_t *pending;      // foglie mancanti per regione
+    size_t done_regions;
+
+    uint8_t *tail;        // ultima foglia quando è più corta di DIGEST_LEAF_SIZE, raccolta da più chunk
+    size_t tail_offset;
+    size_t tail_length;
+    size_t tail_filled;
+
+    size_t bytes;
+    uint64_t ns;
+    uint8_t root[BLAKE3_OUT_LEN];
+
+    // Thread che calcolano le foglie di un chunk insieme al chiamante
+    pthread_t threads[DIGEST_MAX_THREADS];
+    unsigned int thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    uint64_t generation;  // incrementata a ogni chunk distribuito
+    unsigned int active;  // thread non ancora tornati in attesa
+    int stop;
+
+    // Chunk corrente: foglie [job_first, job_first + job_count)
+    const uint8_t *job_buffer;
+    size_t job_first;
+    size_t job_count;
+    size_t job_next;      // prossima foglia da prendere, atomico
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static size_t region_length(const digest_t *digest, size_t region) {
+    size_t start = region * DIGEST_REGION_SIZE;
+    return digest->size - start < DIGEST_REGION_SIZE ? digest->size - start : DIGEST_REGION_SIZE;
+}
+
+static size_t region_leaves(const digest_t *digest, size_t region) {
+    return (region_length(digest, region) + DIGEST_LEAF_SIZE - 1) / DIGEST_LEAF_SIZE;
+}
+
+static uint8_t *leaf_slot(digest_t *digest, size_t leaf) {
+    return digest->leaves[leaf / LEAVES_PER_REGION] + (leaf % LEAVES_PER_REGION) * BLAKE3_OUT_LEN;
+}
+
+static void hash_leaves(digest_t *digest) {
+    for (;;) {
+        size_t i = __atomic_fetch_add(&digest->job_next, 1, __ATOMIC_RELAXED);
+        if (i >= digest->job_count) {
+            break;
+        }
+        blake3_hash(digest->job_buffer + i * DIGEST_LEAF_SIZE, DIGEST_LEAF_SIZE,
+                    leaf_slot(digest, digest->job_first + i));
+    }
+}
+
+static void *digest_worker(void *arg) {
+    digest_t *digest = arg;
+    uint64_t seen = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&digest->lock);
+        while (!digest->stop && digest->generation == seen) {
+            pthread_cond_wait(&digest->start, &digest->lock);
+        }
+        if (digest->stop) {
+            pthread_mutex_unlock(&digest->lock);
+            break;
+        }
+        seen = digest->generation;
+        pthread_mutex_unlock(&digest->lock);
+
+        hash_leaves(digest);
+
+        pthread_mutex_lock(&digest->lock);
+        if (--digest->active == 0) {
+            pthread_cond_signal(&digest->done);
+        }
+        pthread_mutex_unlock(&digest->lock);
+    }
+
+    return NULL;
+}
+
+digest_t *digest_create(size_t size, unsigned int threads) {
+    digest_t *digest = calloc(1, sizeof(*digest));
+    if (!digest) {
+        perror("calloc");
+        return NULL;
+    }
+    pthread_mutex_init(&digest->lock, NULL);
+    pthread_cond_init(&digest->start, NULL);
+    pthread_cond_init(&digest->done, NULL);
+
+    digest->size = size;
+    digest->region_count = (size + DIGEST_REGION_SIZE - 1) / DIGEST_REGION_SIZE;
+    digest->regions = calloc(digest->region_count + 1, sizeof(digest_region_t));
+    digest->leaves = calloc(digest->region_count + 1, sizeof(uint8_t *));
+    digest->pending = calloc(digest->region_count + 1, sizeof(size_t));
+    if (!digest->regions || !digest->leaves || !digest->pending) {
+        perror("calloc");
+        digest_free(digest);
+        return NULL;
+    }
+
+    for (size_t r = 0; r < digest->region_count; r++) {
+        digest->regions[r].offset = r * DIGEST_REGION_SIZE;
+        digest->regions[r].length = region_length(digest, r);
+        digest->pending[r] = region_leaves(digest, r);
+    }
+
+    if (size % DIGEST_LEAF_SIZE != 0) {
+        digest->tail_offset = size - size % DIGEST_LEAF_SIZE;
+        digest->tail_length = size % DIGEST_LEAF_SIZE;
+        digest->tail = malloc(DIGEST_LEAF_SIZE);
+        if (!digest->tail) {
+            perror("malloc");
+            digest_free(digest);
+            return NULL;
+        }
+    } else {
+        digest->tail_offset = size;
+    }
+
+    // Il chiamante è uno dei thread: se ne avviano threads - 1
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (unsigned int)online : 1;
+    }
+    if (threads > DIGEST_MAX_THREADS) {
+        threads = DIGEST_MAX_THREADS;
+    }
+    for (unsigned int i = 0; i + 1 < threads; i++) {
+        if (pthread_create(&digest->threads[i], NULL, digest_worker, digest) != 0) {
+            break; // si procede con i thread già avviati
+        }
+        digest->thread_count++;
+    }
+
+    return digest;
+}
+
+// Foglia completata: a regione completa se ne calcola il digest e si liberano le foglie
+static void leaf_done(digest_t *digest, size_t leaf) {
+    size_t region = leaf / LEAVES_PER_REGION;
+
+    if (--digest->pending[region] == 0) {
+        blake3_hash(digest->leaves[region], region_leaves(digest, region) * BLAKE3_OUT_LEN,
+                    digest->regions[region].digest);
+        free(digest->leaves[region]);
+        digest->leaves[region] = NULL;
+        digest->done_regions++;
+    }
+}
+
+static int ensure_region(digest_t *digest, size_t region) {
+    if (!digest->leaves[region]) {
+        digest->leaves[region] = malloc(region_leaves(digest, region) * BLAKE3_OUT_LEN);
+        if (!digest->leaves[region]) {
+            perror("malloc");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int digest_update(digest_t *digest, size_t offset, const void *buffer, size_t length) {
+    const uint8_t *data = buffer;
+    uint64_t begin = now_ns();
+
+    if (offset + length > digest->size) {
+        fprintf(stderr, "digest: range [%zu, %zu) beyond the end of the device\n", offset, offset + length);
+        return -1;
+    }
+
+    // La parte nell'ultima foglia corta si accumula finché non è completa
+    if (offset + length > digest->tail_offset) {
+        size_t from = offset > digest->tail_offset ? offset : digest->tail_offset;
+        size_t count = offset + length - from;
+
+        memcpy(digest->tail + (from - digest->tail_offset), data + (from - offset), count);
+        digest->tail_filled += count;
+        length -= count;
+
+        if (digest->tail_filled == digest->tail_length) {
+            size_t leaf = digest->tail_offset / DIGEST_LEAF_SIZE;
+            if (ensure_region(digest, leaf / LEAVES_PER_REGION) != 0) {
+                return -1;
+            }
+            blake3_hash(digest->tail, digest->tail_length, leaf_slot(digest, leaf));
+            leaf_done(digest, leaf);
+        }
+        digest->bytes += count;
+    }
+
+    if (length > 0 && (offset % DIGEST_LEAF_SIZE != 0 || length % DIGEST_LEAF_SIZE != 0)) {
+        fprintf(stderr, "digest: range [%zu, %zu) is not aligned to the leaf size\n", offset, offset + length);
+        return -1;
+    }
+
+    size_t first = offset / DIGEST_LEAF_SIZE;
+    size_t count = length / DIGEST_LEAF_SIZE;
+    if (count == 0) {
+        digest->ns += now_ns() - begin;
+        return 0;
+    }
+
+    for (size_t region = first / LEAVES_PER_REGION; region <= (first + count - 1) / LEAVES_PER_REGION; region++) {
+        if (ensure_region(digest, region) != 0) {
+            return -1;
+        }
+    }
+
+    digest->job_buffer = data;
+    digest->job_first = first;
+    digest->job_count = count;
+    digest->job_next = 0;
+
+    if (count > 1 && digest->thread_count > 0) {
+        pthread_mutex_lock(&digest->lock);
+        digest->active = digest->thread_count;
+        digest->generation++;
+        pthread_cond_broadcast(&digest->start);
+        pthread_mutex_unlock(&digest->lock);
+
+        hash_leaves(digest);
+
+        pthread_mutex_lock(&digest->lock);
+        while (digest->active > 0) {
+            pthread_cond_wait(&digest->done, &digest->lock);
+        }
+        pthread_mutex_unlock(&digest->lock);
+    } else {
+        hash_leaves(digest);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        leaf_done(digest, first + i);
+    }
+
+    digest->bytes += length;
+    digest->ns += now_ns() - begin;
+    return 0;
+}
+
+int digest_finish(digest_t *digest) {
+    if (digest->done_regions != digest->region_count) {
+        return -1;
+    }
+
+    blake3_hasher_t hasher;
+    blake3_init(&hasher);
+    for (size_t r = 0; r < digest->region_count; r++) {
+        blake3_update(&hasher, digest->regions[r].digest, BLAKE3_OUT_LEN);
+    }
+    blake3_final(&hasher, digest->root);
+    return 0;
+}
+
+const uint8_t *digest_root(const digest_t *digest) {
+    return digest->root;
+}
+
+const digest_region_t *digest_regions(const digest_t *digest, size_t *count) {
+    *count = digest->region_count;
+    return digest->regions;
+}
+
+size_t digest_bytes(const digest_t *digest) {
+    return digest->bytes;
+}
+
+double digest_seconds(const digest_t *digest) {
+    return (double)digest->ns / 1e9;
+}
+
+unsigned int digest_threads(const digest_t *digest) {
+    return digest->thread_count + 1;
+}
+
+void digest_free(digest_t *digest) {
+    if (!digest) {
+        return;
+    }
+
+    if (digest->thread_count > 0) {
+        pthread_mutex_lock(&digest->lock);
+        digest->stop = 1;
+        pthread_cond_broadcast(&digest->start);
+        pthread_mutex_unlock(&digest->lock);
+        for (unsigned int i = 0; i < digest->thread_count; i++) {
+            pthread_join(digest->threads[i], NULL);
+        }
+    }
+    pthread_mutex_destroy(&digest->lock);
+    pthread_cond_destroy(&digest->start);
+    pthread_cond_destroy(&digest->done);
+
+    if (digest->leaves) {
+        for (size_t r = 0; r < digest->region_count; r++) {
+            free(digest->leaves[r]);
+        }
+    }
+    free(digest->leaves);
+    free(digest->regions);
+    free(digest->pending);
+    free(digest->tail);
+    free(digest);
+}
@@ -0,0 +1,42 @@
+#ifndef DIGEST_H
+#define DIGEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "blake3.h"
+
+// Digest del contenuto riletto dalla verifica completa, calcolato mentre i chunk vengono confrontati:
+//   foglia   BLAKE3 di DIGEST_LEAF_SIZE byte (l'ultima può essere più corta)
+//   regione  BLAKE3 dei digest delle sue foglie concatenati, una ogni DIGEST_REGION_SIZE byte
+//   radice   BLAKE3 dei digest delle regioni concatenati
+// Le foglie di un chunk si calcolano in parallelo su più thread; il chiamante partecipa.
+#define DIGEST_LEAF_SIZE (64 * 1024)
+#define DIGEST_REGION_SIZE (1024ULL * 1024 * 1024)
+#define DIGEST_MAX_THREADS 16
+#define DIGEST_HEX_SIZE (BLAKE3_OUT_LEN * 2 + 1)
+
+typedef struct digest digest_t;
+
+// Regione completata, con il suo digest
+typedef struct {
+    size_t offset;
+    size_t length;
+    uint8_t digest[BLAKE3_OUT_LEN];
+} digest_region_t;
+
+// Albero per un device di size byte; threads = 0 sceglie dai core disponibili. NULL su errore
+digest_t *digest_create(size_t size, unsigned int threads);
+// Aggiunge [offset, offset + length) in qualsiasi ordine (un solo thread chiamante alla volta).
+// offset e length devono essere multipli di DIGEST_LEAF_SIZE, salvo la parte che cade nell'ultima foglia.
+// Ritorna 0 o -1.
+int digest_update(digest_t *digest, size_t offset, const void *buffer, size_t length);
+// Calcola la radice; ritorna -1 se una parte del device non è stata aggiunta
+int digest_finish(digest_t *digest);
+const uint8_t *digest_root(const digest_t *digest);
+const digest_region_t *digest_regions(const digest_t *digest, size_t *count);
+size_t digest_bytes(const digest_t *digest);
+double digest_seconds(const digest_t *digest); // tempo speso a calcolare (non concorrente alla rilettura)
+unsigned int digest_threads(const digest_t *digest);
+void digest_free(digest_t *digest);
+
+#endif // DIGEST_H
@@ -1,7 +1,11 @@
-#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
 
 #include "disk_ops.h"
+#include "inventory.h"
+#include "metadata.h"
+#include "rcw.h"
 #include "utils.h"
+#include "zoned.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,6 +16,8 @@
 #include <sys/stat.h>
 #include <signal.h>
 #include <limits.h>
+#include <pthread.h>
+#include <time.h>
 
 #ifdef __APPLE__
 #include <sys/disk.h>
@@ -41,19 +47,10 @@ int list_disks(void) {
 
     pclose(fp);
 #elif __linux__
-    // Linux: use lsblk
-    FILE *fp = popen("lsblk -d -o NAME,SIZE,TYPE,MOUNTPOINT", "r");
-    if (!fp) {
-        perror("popen");
+    // Linux: inventario da /sys/block, senza lanciare lsblk
+    if (inventory_list() != 0) {
         return -1;
     }
-
-    char line[512];
-    while (fgets(line, sizeof(line), fp)) {
-        printf("  %s", line);
-    }
-
-    pclose(fp);
 #else
     fprintf(stderr, "Unsupported operating system\n");
     return -1;
@@ -62,7 +59,32 @@ int list_disks(void) {
     return 0;
 }
 
+#ifdef __linux__
+// Uso del disco o di una sua partizione, anche attraverso LVM/md/dm:
+// 2 se di sistema (root, boot, swap), 1 se sotto un altro device attivo, 0 se libero, -1 in caso di errore
+static int disk_usage(const char *disk_path, char *reason, size_t reason_size) {
+    mount_table_t table;
+    disk_info_t info;
+
+    if (mount_table_load(&table) != 0) {
+        return -1;
+    }
+    int found = inventory_disk(disk_path, &table, &info);
+    mount_table_free(&table);
+    if (found != 0) {
+        return -1;
+    }
+
+    snprintf(reason, reason_size, "%s", info.usage_detail);
+    if (info.usage & DISK_USE_SYSTEM) {
+        return 2;
+    }
+    return (info.usage & DISK_USE_STACKED) ? 1 : 0;
+}
+#endif
+
 int is_system_disk(const char *disk_path) {
+#ifdef __APPLE__
     // Estrarre il numero del disco
     const char *disk_name = strrchr(disk_path, '/');
     if (!disk_name) {
@@ -76,7 +98,6 @@ int is_system_disk(const char *disk_path) {
         disk_name++;
     }
 
-#ifdef __APPLE__
     // macOS: use diskutil to check if it's a system disk
     char cmd[256];
     snprintf(cmd, sizeof(cmd), "diskutil info %s | grep -i 'System Disk\\|boot'", disk_name);
@@ -99,27 +120,12 @@ int is_system_disk(const char *disk_path) {
     pclose(fp);
     return is_system;
 #elif __linux__
-    // Linux: check if disk is mounted as root or contains root partition
-    char cmd[512];
-    snprintf(cmd, sizeof(cmd), "mount | grep -E '^/dev/%s[0-9]* on / ' || lsblk -no MOUNTPOINT /dev/%s | grep -E '^/$'",
-             disk_name, disk_name);
-
-    FILE *fp = popen(cmd, "r");
-    if (!fp) {
-        return -1;
-    }
-
-    char line[256];
-    int is_system = 0;
-
-    if (fgets(line, sizeof(line), fp)) {
-        // If we got any output, it means the disk contains root partition
-        is_system = 1;
-    }
-
-    pclose(fp);
-    return is_system;
+    // Linux: root, /boot o swap su una qualsiasi partizione, anche dentro LVM o md
+    char reason[160];
+    int usage = disk_usage(disk_path, reason, sizeof(reason));
+    return usage < 0 ? -1 : usage == 2;
 #else
+    (void)disk_path;
     return -1;
 #endif
 }
@@ -138,16 +144,37 @@ int verify_disk(const char *disk_path) {
         return 0;
     }
 
+#ifdef __linux__
+    // Verificare che non sia il disco di sistema né parte di un volume attivo
+    char reason[160];
+    int usage = disk_usage(disk_path, reason, sizeof(reason));
+    if (usage == 2) {
+        fprintf(stderr, "ERROR: Cannot erase system disk! (%s)\n", reason);
+        return 0;
+    }
+    if (usage == 1) {
+        fprintf(stderr, "ERROR: %s is in use (%s), deactivate it first\n", disk_path, reason);
+        return 0;
+    }
+    if (usage < 0) {
+        fprintf(stderr, "ERROR: Cannot determine whether %s is in use\n", disk_path);
+        return 0;
+    }
+#else
     // Verificare che non sia il disco di sistema
     if (is_system_disk(disk_path)) {
         fprintf(stderr, "ERROR: Cannot erase system disk!\n");
         return 0;
     }
+#endif
 
     return 1;
 }
 
 int unmount_disk(const char *disk_path) {
+    printf("Unmounting disk...\n");
+
+#ifdef __APPLE__
     // Estrarre il nome del disco
     const char *disk_name = strrchr(disk_path, '/');
     if (!disk_name) {
@@ -161,16 +188,12 @@ int unmount_disk(const char *disk_path) {
         disk_name++;
     }
 
-    printf("Unmounting disk...\n");
-
-#ifdef __APPLE__
     char cmd[256];
     snprintf(cmd, sizeof(cmd), "diskutil unmountDisk /dev/%s", disk_name);
     int ret = system(cmd);
 #elif __linux__
-    char cmd[256];
-    snprintf(cmd, sizeof(cmd), "umount /dev/%s* 2>/dev/null || true", disk_name);
-    int ret = system(cmd);
+    // umount2() su ogni filesystem del disco e delle sue partizioni
+    int ret = inventory_unmount(disk_path);
 #else
     int ret = -1;
 #endif
@@ -182,13 +205,12 @@ int unmount_disk(const char *disk_path) {
     return 0; // Non è critico se fallisce
 }
 
-int open_disk_raw(const char *disk_path) {
-    char raw_path[PATH_MAX];
-
+// Path del device a caratteri (macOS) o del block device (Linux)
+static int raw_device_path(const char *disk_path, char *raw_path, size_t path_size) {
 #ifdef __APPLE__
     // macOS: use raw device (/dev/rdiskX) for better performance
     if (strstr(disk_path, "/dev/rdisk")) {
-        strncpy(raw_path, disk_path, sizeof(raw_path) - 1);
+        snprintf(raw_path, path_size, "%s", disk_path);
     } else {
         const char *disk_name = strrchr(disk_path, '/');
         if (!disk_name) {
@@ -199,27 +221,80 @@ int open_disk_raw(const char *disk_path) {
 
         // Se non inizia già con 'r', aggiungerlo
         if (disk_name[0] == 'r') {
-            snprintf(raw_path, sizeof(raw_path), "/dev/%s", disk_name);
+            snprintf(raw_path, path_size, "/dev/%s", disk_name);
         } else {
-            snprintf(raw_path, sizeof(raw_path), "/dev/r%s", disk_name);
+            snprintf(raw_path, path_size, "/dev/r%s", disk_name);
         }
     }
 #elif __linux__
     // Linux: just use the device path directly (no separate raw device)
-    strncpy(raw_path, disk_path, sizeof(raw_path) - 1);
-    raw_path[sizeof(raw_path) - 1] = '\0';
+    snprintf(raw_path, path_size, "%s", disk_path);
 #else
     return -1;
 #endif
 
+    return 0;
+}
+
+int open_disk_raw(const char *disk_path, int direct_io) {
+    char raw_path[PATH_MAX];
+
+    if (raw_device_path(disk_path, raw_path, sizeof(raw_path)) != 0) {
+        return -1;
+    }
+
     printf("Opening raw device: %s\n", raw_path);
 
-    int fd = open(raw_path, O_WRONLY | O_SYNC);
+    // Con direct I/O niente O_SYNC: le scritture bypassano la page cache e si fa un solo flush alla fine
+    int flags = O_WRONLY | O_SYNC;
+#ifdef __linux__
+    if (direct_io) {
+        flags = O_WRONLY | O_DIRECT;
+    }
+#endif
+
+    int fd = open(raw_path, flags);
+    if (fd < 0) {
+        perror("open");
+        return -1;
+    }
+
+#ifdef __APPLE__
+    // macOS non ha O_DIRECT: F_NOCACHE disabilita la cache UBC per questo descrittore
+    if (direct_io && fcntl(fd, F_NOCACHE, 1) < 0) {
+        perror("fcntl(F_NOCACHE)");
+    }
+#endif
+
+    return fd;
+}
+
+int open_disk_read(const char *disk_path, int direct_io) {
+    char raw_path[PATH_MAX];
+
+    if (raw_device_path(disk_path, raw_path, sizeof(raw_path)) != 0) {
+        return -1;
+    }
+
+    int flags = O_RDONLY;
+#ifdef __linux__
+    if (direct_io) {
+        flags |= O_DIRECT;
+    }
+#endif
+
+    int fd = open(raw_path, flags);
     if (fd < 0) {
         perror("open");
         return -1;
     }
 
+#ifdef __APPLE__
+    if (direct_io && fcntl(fd, F_NOCACHE, 1) < 0) {
+        perror("fcntl(F_NOCACHE)");
+    }
+#endif
+
     return fd;
 }
 
@@ -256,55 +331,1085 @@ ssize_t get_disk_size(int fd) {
 #endif
 }
 
-int wipe_disk(int fd, size_t disk_size, progress_info_t *progress) {
-    const size_t BUFFER_SIZE = 1024 * 1024; // 1MB
-    void *buffer;
-
-    // Allocare buffer allineato per performance ottimali
-    if (posix_memalign(&buffer, 4096, BUFFER_SIZE) != 0) {
-        perror("posix_memalign");
+static int sync_write_range(const io_range_t *range) {
+    // Il produttore della pipeline prepara il chunk successivo durante la write() corrente
+    pattern_pipeline_t *pipeline = pipeline_create(range->pass, range->start, range->length, range->chunk_size,
+                                                   range->alignment, 1 + IO_PIPELINE_LOOKAHEAD);
+    if (!pipeline) {
         return -1;
     }
 
-    // Riempire buffer con zeri
-    memset(buffer, 0, BUFFER_SIZE);
+    int result = 0;
+    uint64_t last_completion = latency_now_ns(); // il tempo tra due write (attesa del pattern compresa) va alla fascia
+    int shared = pipeline_shared(pipeline); // pattern fisso: pwritev() della pagina condivisa ripetuta
+    struct iovec iov[IO_SHARED_IOVECS];
+
+    while (result == 0) {
+        // Controllare se l'operazione è stata interrotta (dall'utente o da un altro stripe)
+        if (io_should_stop(range)) {
+            result = -2; // Codice speciale per interruzione
+            break;
+        }
 
-    size_t total_written = 0;
+        unsigned int index;
+        size_t offset, length;
+        int acquired = pipeline_acquire(pipeline, &index, &offset, &length);
+        if (acquired != 0) {
+            result = acquired > 0 ? 0 : -1;
+            break;
+        }
 
-    while (total_written < disk_size) {
-        // Controllare se l'operazione è stata interrotta
-        if (interrupted) {
-            printf("\n\nOperation interrupted by user.\n");
-            free(buffer);
-            return -2; // Codice speciale per interruzione
+        const char *buffer = pipeline_buffer(pipeline, index);
+        size_t done = 0;
+        int timed = range->progress->stats || range->throttle;
+
+        if (range->throttle) {
+            io_throttle_sleep(range, throttle_reserve(range->throttle, length));
         }
 
-        size_t to_write = (disk_size - total_written > BUFFER_SIZE)
-                          ? BUFFER_SIZE
-                          : (disk_size - total_written);
+        while (done < length) {
+            uint64_t submitted = timed ? latency_now_ns() : 0;
+            ssize_t written = shared ? pwritev(range->fd, iov,
+                                               pattern_shared_iov(buffer, length - done, iov, IO_SHARED_IOVECS),
+                                               (off_t)(offset + done))
+                                     : pwrite(range->fd, buffer + done, length - done, (off_t)(offset + done));
+            if (timed) {
+                uint64_t completed = latency_now_ns();
+                if (range->progress->stats) {
+                    io_stats_record(range->progress->stats, offset + done, written > 0 ? (size_t)written : 0,
+                                    completed - submitted, completed - last_completion);
+                }
+                if (range->throttle && written > 0) {
+                    throttle_complete(range->throttle, (size_t)written, completed - submitted);
+                }
+                last_completion = completed;
+            }
+            if (written < 0) {
+                if (errno == EINTR) {
+                    if (io_should_stop(range)) {
+                        result = -2;
+                        break;
+                    }
+                    continue; // Retry su interrupt
+                }
+                // Settore difettoso: bisezione del resto del chunk, poi il ciclo prosegue a chunk interi
+                if (range->config->skip_bad && io_media_error(errno)) {
+                    result = io_write_recover(range, shared ? buffer : buffer + done, offset + done,
+                                              length - done, shared);
+                    if (result == 0 && range->written_mark) {
+                        __atomic_store_n(range->written_mark, offset + length, __ATOMIC_RELEASE);
+                    }
+                    break;
+                }
+                perror("write");
+                result = -1;
+                break;
+            }
+
+            done += written;
+            progress_update(range->progress, written);
+            if (range->written_mark) {
+                __atomic_store_n(range->written_mark, offset + done, __ATOMIC_RELEASE);
+            }
+        }
+
+        pipeline_release(pipeline, index);
+    }
+
+    pipeline_destroy(pipeline);
+    return result;
+}
+
+ssize_t get_block_size(int fd) {
+#ifdef __APPLE__
+    uint32_t block_size;
+
+    if (ioctl(fd, DKIOCGETBLOCKSIZE, &block_size) < 0) {
+        perror("ioctl(DKIOCGETBLOCKSIZE)");
+        return -1;
+    }
+
+    return (ssize_t)block_size;
+#elif __linux__
+    int block_size;
+
+    // Linux: BLKSSZGET restituisce la dimensione del blocco logico
+    if (ioctl(fd, BLKSSZGET, &block_size) < 0) {
+        perror("ioctl(BLKSSZGET)");
+        return -1;
+    }
+
+    return (ssize_t)block_size;
+#else
+    return -1;
+#endif
+}
+
+// Scrive la coda finale non multipla del blocco logico, che O_DIRECT rifiuterebbe
+static int write_unaligned_tail(int fd, size_t offset, size_t length, const pattern_pass_t *pass,
+                                progress_info_t *progress) {
+    char buffer[4096];
+    int flags = fcntl(fd, F_GETFL);
 
-        ssize_t written = write(fd, buffer, to_write);
+#ifdef __linux__
+    if (flags >= 0 && (flags & O_DIRECT)) {
+        fcntl(fd, F_SETFL, flags & ~O_DIRECT);
+    }
+#endif
+
+    int result = 0;
+    while (length > 0) {
+        size_t to_write = length > sizeof(buffer) ? sizeof(buffer) : length;
+        pattern_fill(pass, offset, buffer, to_write);
+        ssize_t written = pwrite(fd, buffer, to_write, (off_t)offset);
         if (written < 0) {
             if (errno == EINTR) {
-                continue; // Retry su interrupt
+                continue;
             }
-            perror("write");
-            free(buffer);
-            return -1;
+            perror("pwrite");
+            result = -1;
+            break;
         }
-
-        total_written += written;
+        offset += written;
+        length -= written;
         progress_update(progress, written);
     }
 
-    free(buffer);
+    if (flags >= 0) {
+        fcntl(fd, F_SETFL, flags);
+    }
+
+    return result;
+}
+
+static int write_range(io_engine_t engine, const io_range_t *range) {
+    if (range->config->read_compare) {
+        return rcw_write_range(range, engine);
+    }
+    if (engine == IO_ENGINE_URING) {
+        return uring_write_range(range);
+    }
+    return sync_write_range(range);
+}
+
+// Un worker per ogni stripe dell'intervallo LBA
+typedef struct {
+    pthread_t thread;
+    io_engine_t engine;
+    io_range_t range;
+    progress_thread_stat_t *stat;
+    int result;
+} stripe_worker_t;
+
+static void *stripe_worker(void *arg) {
+    stripe_worker_t *worker = arg;
+    sigset_t mask;
+
+    // I segnali vanno gestiti dal thread principale: i worker vedono solo il flag interrupted
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    // La priorità di I/O è per thread: ogni writer la imposta per sé
+    throttle_apply_priority(worker->range.config->throttle.ioprio);
+
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    worker->result = write_range(worker->engine, &worker->range);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // Un errore su uno stripe ferma anche gli altri
+    if (worker->result == -1) {
+        *worker->range.cancel = 1;
+    }
+
+    // Somma su tutte le passate, come il riepilogo (progress_init azzera gli slot)
+    worker->stat->bytes += worker->result == 0 ? worker->range.length : 0;
+    worker->stat->seconds += (double)(end.tv_sec - begin.tv_sec) + (double)(end.tv_nsec - begin.tv_nsec) / 1e9;
+
+    return NULL;
+}
+
+// Suddivide una passata nuova in stripe multipli del chunk, così restano allineati anche con O_DIRECT
+static void plan_stripes(checkpoint_t *checkpoint, size_t length, size_t chunk_size, unsigned int threads) {
+    size_t chunks = (length + chunk_size - 1) / chunk_size;
+    size_t stripe_size = threads > 1 ? ((chunks + threads - 1) / threads) * chunk_size : length;
+
+    checkpoint->stripe_count = 0;
+    for (size_t offset = 0; offset < length && checkpoint->stripe_count < (int)threads; offset += stripe_size) {
+        checkpoint_stripe_t *stripe = &checkpoint->stripes[checkpoint->stripe_count++];
+        stripe->start = offset;
+        stripe->end = (length - offset > stripe_size) ? offset + stripe_size : length;
+        stripe->done = offset;
+    }
+
+    // Device più piccolo di un blocco: solo la coda non allineata
+    if (checkpoint->stripe_count == 0) {
+        checkpoint->stripes[0] = (checkpoint_stripe_t){0, 0, 0};
+        checkpoint->stripe_count = 1;
+    }
+
+    if (checkpoint->stripe_count > 1) {
+        log_message("Striped wipe: %d threads, stripe size %zu bytes", checkpoint->stripe_count, stripe_size);
+    }
+}
+
+// Un worker per ogni stripe non ancora completato, dal suo prefisso già scritto alla fine
+static int striped_write(io_engine_t engine, const io_range_t *range, checkpoint_t *checkpoint) {
+    stripe_worker_t workers[CHECKPOINT_MAX_STRIPES];
+    volatile sig_atomic_t cancel = 0;
+    unsigned int started = 0;
+    int result = 0;
+
+    // Uno slot per stripe, non per thread avviato: i totali si sommano passata dopo passata anche
+    // quando una ripresa salta gli stripe già completati
+    for (int i = 0; i < checkpoint->stripe_count; i++) {
+        checkpoint_stripe_t *stripe = &checkpoint->stripes[i];
+        range->progress->threads[i].offset = stripe->start;
+        if (stripe->done >= stripe->end) {
+            continue;
+        }
+
+        stripe_worker_t *worker = &workers[started];
+        worker->engine = engine;
+        worker->range = *range;
+        worker->range.start = stripe->done;
+        worker->range.length = stripe->end - stripe->done;
+        worker->range.cancel = &cancel;
+        worker->range.written_mark = &stripe->done;
+        worker->stat = &range->progress->threads[i];
+        worker->result = 0;
+
+        if (pthread_create(&worker->thread, NULL, stripe_worker, worker) != 0) {
+            perror("pthread_create");
+            cancel = 1;
+            result = -1;
+            break;
+        }
+        started++;
+    }
 
-    // Assicurarsi che tutto sia scritto su disco
-    printf("\nSyncing to disk...\n");
-    if (fsync(fd) < 0) {
+    for (unsigned int i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+
+        // Un errore ha precedenza sull'interruzione
+        if (workers[i].result == -1) {
+            result = -1;
+        } else if (workers[i].result == -2 && result == 0) {
+            result = -2;
+        }
+    }
+
+    range->progress->thread_count = checkpoint->stripe_count;
+    return result;
+}
+
+// Worker della sovrascrittura di un device a zone: prende le zone in ordine da un indice condiviso
+// e scrive ognuna dall'inizio con write() sequenziali, l'unico ordine accettato dalle zone sequenziali
+typedef struct {
+    pthread_t thread;
+    io_range_t range;          // fd, passata, configurazione e limite comuni
+    const zone_map_t *map;
+    unsigned int *next;        // prossima zona da assegnare
+    int conventional_only;     // dopo un reset restano da scrivere solo le zone convenzionali
+    progress_thread_stat_t *stat;
+    int result;
+} zone_worker_t;
+
+static void *zone_worker(void *arg) {
+    zone_worker_t *worker = arg;
+    progress_info_t *progress = worker->range.progress;
+    sigset_t mask;
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    throttle_apply_priority(worker->range.config->throttle.ioprio);
+
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    size_t written = 0;
+    worker->stat->offset = 0;
+    while (worker->result == 0) {
+        if (io_should_stop(&worker->range)) {
+            worker->result = -2;
+            break;
+        }
+
+        unsigned int index = __atomic_fetch_add(worker->next, 1, __ATOMIC_RELAXED);
+        if (index >= worker->map->count) {
+            break;
+        }
+
+        // Zone non scrivibili (già nel report) e zone azzerate contano come elaborate
+        const zone_t *zone = &worker->map->zones[index];
+        if (!zone->usable) {
+            progress_update(progress, zone->length);
+            continue;
+        }
+        if (worker->conventional_only && zone->sequential) {
+            continue;
+        }
+
+        if (written == 0) {
+            worker->stat->offset = zone->start;
+        }
+
+        io_range_t range = worker->range;
+        range.start = zone->start;
+        range.length = zone->capacity;
+        worker->result = write_range(IO_ENGINE_SYNC, &range);
+        if (worker->result == 0) {
+            // Oltre la capacità (ZNS) la zona non è scrivibile né leggibile
+            progress_update(progress, zone->length - zone->capacity);
+            written += zone->capacity;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (worker->result == -1) {
+        *worker->range.cancel = 1;
+    }
+
+    worker->stat->bytes += written;
+    worker->stat->seconds += (double)(end.tv_sec - begin.tv_sec) + (double)(end.tv_nsec - begin.tv_nsec) / 1e9;
+
+    return NULL;
+}
+
+// Scrive la passata di range su tutte le zone (solo le convenzionali con conventional_only)
+static int zoned_write(const io_range_t *range, const zone_map_t *map, unsigned int worker_count,
+                       int conventional_only) {
+    zone_worker_t workers[IO_MAX_THREADS];
+    volatile sig_atomic_t cancel = 0;
+    unsigned int next = 0;
+    unsigned int started = 0;
+    int result = 0;
+
+    for (unsigned int i = 0; i < worker_count; i++) {
+        zone_worker_t *worker = &workers[started];
+        worker->range = *range;
+        worker->range.cancel = &cancel;
+        worker->map = map;
+        worker->next = &next;
+        worker->conventional_only = conventional_only;
+        worker->stat = &range->progress->threads[started];
+        worker->result = 0;
+
+        if (pthread_create(&worker->thread, NULL, zone_worker, worker) != 0) {
+            perror("pthread_create");
+            cancel = 1;
+            result = -1;
+            break;
+        }
+        started++;
+    }
+
+    for (unsigned int i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+
+        if (workers[i].result == -1) {
+            result = -1;
+        } else if (workers[i].result == -2 && result == 0) {
+            result = -2;
+        }
+    }
+
+    range->progress->thread_count = (int)started;
+    return result;
+}
+
+static double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Sonda di auto-tuning: scrive la passata corrente all'inizio dello stripe con ogni combinazione
+// di chunk e queue depth per una frazione di TUNE_TIME_BUDGET e adotta la più veloce.
+// I byte scritti fanno parte del wipe: lo stripe riprende da dove la sonda si è fermata, e byte
+// e tempo della sonda vanno nella riga dello stripe (stat) della tabella per thread.
+static int tune_io(io_engine_t engine, const io_range_t *range, checkpoint_stripe_t *stripe, io_config_t *config,
+                   progress_thread_stat_t *stat) {
+    static const size_t chunk_sizes[] = {128 * 1024, 256 * 1024, 512 * 1024, 1024 * 1024,
+                                         2 * 1024 * 1024, 4 * 1024 * 1024, 8 * 1024 * 1024};
+    static const unsigned int queue_depths[] = {4, 8, 16, 32, 64};
+    size_t chunks[sizeof(chunk_sizes) / sizeof(chunk_sizes[0])];
+    unsigned int depths[sizeof(queue_depths) / sizeof(queue_depths[0])];
+    int chunk_count = 0, depth_count = 0;
+
+    // Solo i parametri non fissati dall'utente; la queue depth non conta senza io_uring
+    for (size_t i = 0; i < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); i++) {
+        if ((config->tune & IO_TUNE_CHUNK_SIZE) && chunk_sizes[i] >= range->alignment &&
+            chunk_sizes[i] % config->chunk_align == 0) {
+            chunks[chunk_count++] = chunk_sizes[i];
+        }
+    }
+    if (chunk_count == 0) {
+        chunks[chunk_count++] = config->chunk_size;
+    }
+    for (size_t i = 0; i < sizeof(queue_depths) / sizeof(queue_depths[0]); i++) {
+        if (engine == IO_ENGINE_URING && (config->tune & IO_TUNE_QUEUE_DEPTH)) {
+            depths[depth_count++] = queue_depths[i];
+        }
+    }
+    if (depth_count == 0) {
+        depths[depth_count++] = config->queue_depth;
+    }
+
+    int trials = 0;
+    for (int c = 0; c < chunk_count; c++) {
+        for (int d = 0; d < depth_count; d++) {
+            trials += chunks[c] * depths[d] <= TUNE_MAX_BUFFERS;
+        }
+    }
+    if (trials < 2) {
+        return 0;
+    }
+
+    // Al massimo un quarto dello stripe, così sui device piccoli la sonda non domina il wipe
+    size_t limit = stripe->done + (stripe->end - stripe->done) / 4;
+    if (limit - stripe->done < TUNE_MIN_REGION) {
+        log_message("Auto-tune skipped: region too small");
+        return 0;
+    }
+
+    double slice = TUNE_TIME_BUDGET / trials;
+    size_t share = (limit - stripe->done) / (size_t)trials;
+    double rate = 0.0; // byte/s dell'ultima prova, per dimensionare la successiva
+    double best_mbps = 0.0;
+    size_t best_chunk = config->chunk_size;
+    unsigned int best_depth = config->queue_depth;
+    size_t probe_start = stripe->done;
+    double probe_seconds = 0.0;
+
+    for (int c = 0; c < chunk_count; c++) {
+        for (int d = 0; d < depth_count; d++) {
+            size_t chunk = chunks[c];
+            unsigned int depth = depths[d];
+            if (chunk * depth > TUNE_MAX_BUFFERS) {
+                continue;
+            }
+
+            // Ogni prova dura circa slice secondi, senza superare la sua quota della regione;
+            // una combinazione che non riempie almeno una volta la coda non sarebbe misurata bene
+            size_t length = rate > 0 ? (size_t)(rate * slice) : TUNE_FIRST_TRIAL;
+            size_t minimum = chunk * (engine == IO_ENGINE_URING ? depth : 2);
+            if (length > share) {
+                length = share;
+            }
+            if (length < minimum) {
+                continue;
+            }
+            length -= length % chunk;
+
+            io_config_t trial_config = *config;
+            trial_config.queue_depth = depth;
+            if (trial_config.batch_size > depth) {
+                trial_config.batch_size = depth;
+            }
+
+            io_range_t trial = *range;
+            trial.start = stripe->done;
+            trial.length = length;
+            trial.chunk_size = chunk;
+            trial.config = &trial_config;
+            trial.written_mark = &stripe->done;
+
+            // Il flush fa parte della misura: senza O_DIRECT si misurerebbe la page cache
+            double begin = monotonic_seconds();
+            int result = write_range(engine, &trial);
+            if (result == 0 && fsync(range->fd) < 0) {
+                perror("fsync");
+                result = -1;
+            }
+            double seconds = monotonic_seconds() - begin;
+            probe_seconds += seconds;
+
+            if (result != 0) {
+                return result;
+            }
+
+            rate = seconds > 0 ? (double)length / seconds : 0.0;
+            double mbps = rate / (1024.0 * 1024.0);
+            log_message("Auto-tune: chunk %zu bytes, queue depth %u: %.2f MB/s", chunk, depth, mbps);
+
+            if (mbps > best_mbps) {
+                best_mbps = mbps;
+                best_chunk = chunk;
+                best_depth = depth;
+            }
+        }
+    }
+
+    stat->bytes += stripe->done - probe_start;
+    stat->seconds += probe_seconds;
+
+    if (best_mbps <= 0) {
+        log_message("Auto-tune skipped: no complete trial");
+        return 0;
+    }
+
+    config->chunk_size = best_chunk;
+    config->queue_depth = best_depth;
+    if (config->batch_size > best_depth) {
+        config->batch_size = best_depth;
+    }
+
+    char chunk_str[64], probe_str[64];
+    format_bytes(best_chunk, chunk_str, sizeof(chunk_str));
+    format_bytes(stripe->done - probe_start, probe_str, sizeof(probe_str));
+    log_message("Auto-tune: selected chunk %zu bytes, queue depth %u (%.2f MB/s), %zu bytes probed",
+                best_chunk, best_depth, best_mbps, stripe->done - probe_start);
+    if (!range->progress->quiet) {
+        if (engine == IO_ENGINE_URING) {
+            printf("\nAuto-tune: chunk %s, queue depth %u (%.2f MB/s over %s)\n\n", chunk_str, best_depth, best_mbps,
+                   probe_str);
+        } else {
+            printf("\nAuto-tune: chunk %s (%.2f MB/s over %s)\n\n", chunk_str, best_mbps, probe_str);
+        }
+    }
+
+    return 0;
+}
+
+// Una passata completa dello schema sull'intero device (o il resto di una passata ripresa).
+// Durante la scrittura il checkpoint registra periodicamente il prefisso durevole di ogni stripe.
+static int wipe_pass(io_engine_t engine, const io_range_t *range, checkpoint_t *checkpoint, size_t disk_size) {
+    int result;
+
+    if (checkpoint_start(checkpoint, range->fd) != 0) {
+        return -1;
+    }
+
+    if (checkpoint->stripe_count > 1) {
+        result = striped_write(engine, range, checkpoint);
+    } else {
+        checkpoint_stripe_t *stripe = &checkpoint->stripes[0];
+        io_range_t remaining = *range;
+        remaining.start = stripe->done;
+        remaining.length = stripe->end - stripe->done;
+        remaining.written_mark = &stripe->done;
+        result = write_range(engine, &remaining);
+    }
+
+    // Ultimo checkpoint anche dopo un'interruzione: è quello da cui si riprenderà
+    checkpoint_stop(checkpoint);
+
+    size_t aligned_size = range->start + range->length;
+    if (result == 0 && aligned_size < disk_size) {
+        result = write_unaligned_tail(range->fd, aligned_size, disk_size - aligned_size, range->pass, range->progress);
+    }
+
+    if (result != 0) {
+        return result;
+    }
+
+    // Ogni passata deve raggiungere il supporto prima della successiva,
+    // altrimenti la cache del disco potrebbe assorbire le passate intermedie
+    if (!range->progress->quiet) {
+        printf("\nSyncing to disk...\n");
+    }
+    if (fsync(range->fd) < 0) {
         perror("fsync");
         return -1;
     }
 
     return 0;
 }
+
+// Cancellazione delegata al kernel (BLKZEROOUT/BLKDISCARD/BLKSECDISCARD).
+// Ritorna 1 se il metodo non è disponibile e bisogna ripiegare sulla sovrascrittura.
+static int wipe_offload(int fd, const char *disk_path, size_t disk_size, wipe_method_t method,
+                        progress_info_t *progress) {
+    offload_caps_t caps;
+    offload_detect(disk_path, &caps);
+
+    log_message("Offload capabilities of %s: discard_max_bytes=%llu, discard_granularity=%llu, "
+                "write_zeroes_max_bytes=%llu", disk_path, caps.discard_max_bytes, caps.discard_granularity,
+                caps.write_zeroes_max_bytes);
+
+    int result = 1;
+    if (offload_supported(&caps, method)) {
+        ssize_t block_size = get_block_size(fd);
+        if (block_size <= 0) {
+            block_size = 512;
+        }
+
+        if (!progress->quiet) {
+            printf("Erasing with %s...\n\n", wipe_method_ioctl(method));
+        }
+        result = offload_range(fd, method, 0, disk_size, (size_t)block_size, progress);
+    }
+
+    if (result == 1) {
+        if (!progress->quiet) {
+            fprintf(stderr, "WARNING: %s not supported by %s, falling back to overwriting with zeros\n",
+                    wipe_method_ioctl(method), disk_path);
+        }
+        log_message("Erase method: %s not supported by %s, falling back to overwrite", wipe_method_name(method),
+                    disk_path);
+        return 1;
+    }
+
+    if (result == 0) {
+        if (fsync(fd) < 0) {
+            perror("fsync");
+            return -1;
+        }
+        log_message("Erase method: %s (%s) completed on %s", wipe_method_name(method), wipe_method_ioctl(method),
+                    disk_path);
+    } else if (result == -2 && !progress->quiet) {
+        printf("\n\nOperation interrupted by user.\n");
+    }
+
+    return result;
+}
+
+// Cancellazione rapida: solo tabelle delle partizioni e firme di filesystem, md, LVM e ZFS
+static int wipe_quick(int fd, const char *disk_path, size_t disk_size, io_engine_t engine,
+                      progress_info_t *progress) {
+    ssize_t block_size = get_block_size(fd);
+    metadata_plan_t *plan = progress->metadata ? progress->metadata : malloc(sizeof(metadata_plan_t));
+    if (!plan) {
+        perror("malloc");
+        return -1;
+    }
+    // fd è in sola scrittura: le tabelle delle partizioni si leggono da un descrittore a parte
+    int read_fd = open_disk_read(disk_path, 0);
+    int planned = read_fd >= 0 ? metadata_plan(read_fd, disk_path, disk_size,
+                                               block_size > 0 ? (size_t)block_size : 512, plan) : -1;
+    if (read_fd >= 0) {
+        close(read_fd);
+    }
+    if (planned != 0) {
+        if (plan != progress->metadata) {
+            free(plan);
+        }
+        return -1;
+    }
+
+    // Il totale impostato dal chiamante è l'intero device: qui si scrivono solo gli intervalli
+    progress_set_total(progress, plan->bytes);
+    if (!progress->quiet) {
+        printf("Clearing %d metadata range(s)...\n\n", plan->count);
+    }
+
+    int result = metadata_wipe(fd, engine, plan, progress);
+    if (result == 0 && fsync(fd) < 0) {
+        perror("fsync");
+        result = -1;
+    }
+
+    if (result == 0) {
+        metadata_log(plan, disk_path);
+#ifdef __linux__
+        // Il kernel rilegge la tabella ormai vuota; fallisce senza danni su partizioni e loop senza partscan
+        if (ioctl(fd, BLKRRPART) == 0) {
+            log_message("Partition table of %s re-read by the kernel", disk_path);
+        } else {
+            log_message("Partition table of %s not re-read: %s", disk_path, strerror(errno));
+        }
+#endif
+        if (!progress->quiet) {
+            metadata_print(plan);
+            printf("\n");
+        }
+    } else if (result == -2 && !progress->quiet) {
+        printf("\n\nOperation interrupted by user.\n");
+    }
+
+    if (plan != progress->metadata) {
+        free(plan);
+    }
+    return result;
+}
+
+// Device a zone: reset delle zone sequenziali a gruppi, poi (con overwrite) ogni passata riazzera le zone
+// e le riscrive in parallelo, una zona per worker. Con zonereset si scrivono solo le zone convenzionali.
+static int wipe_zoned(const char *disk_path, const wipe_options_t *options, const io_config_t *config,
+                      size_t logical_block, throttle_t *throttle, progress_info_t *progress) {
+    const wipe_scheme_t *scheme = &options->scheme;
+    int reset_only = options->method == WIPE_METHOD_ZONERESET;
+
+    // O_DIRECT: il writeback della page cache non garantisce l'ordine richiesto dalle zone sequenziali
+    int fd = open_disk_raw(disk_path, 1);
+    if (fd < 0) {
+        return -1;
+    }
+
+    zone_map_t map;
+    if (zoned_report(fd, disk_path, &map) != 0) {
+        close(fd);
+        return -1;
+    }
+    zoned_log(&map, disk_path);
+    if (!progress->quiet) {
+        zoned_print(&map, "");
+    }
+
+    for (unsigned int i = 0; i < map.count; i++) {
+        if (!map.zones[i].usable) {
+            log_message("Zone at offset %zu of %s is offline or read-only, skipped", map.zones[i].start, disk_path);
+            if (progress->stats) {
+                io_stats_bad_range(progress->stats, map.zones[i].start, map.zones[i].length);
+            }
+        }
+    }
+
+    // Scritture sincrone e sequenziali in ogni zona: niente riscritture fuori posto né richieste in volo
+    // oltre al write pointer
+    io_config_t zone_config = *config;
+    zone_config.engine = IO_ENGINE_SYNC;
+    zone_config.direct_io = 1;
+    if (config->read_compare || config->skip_bad) {
+        log_message("Zoned device: read-compare-write and bad block bisection disabled (zones are written "
+                    "sequentially from the write pointer)");
+        zone_config.read_compare = 0;
+        zone_config.skip_bad = 0;
+    }
+
+    size_t alignment = logical_block > 4096 ? logical_block : 4096;
+    if (map.write_granularity > alignment) {
+        alignment = map.write_granularity;
+    }
+
+    // Una zona per worker, entro i limiti di zone aperte/attive del device
+    unsigned int workers = (config->tune & IO_TUNE_THREADS) ? ZONED_DEFAULT_WORKERS : config->threads;
+    if (map.max_open > 0 && workers > map.max_open) {
+        workers = map.max_open;
+    }
+    if (map.max_active > 0 && workers > map.max_active) {
+        workers = map.max_active;
+    }
+    if (workers > map.count) {
+        workers = map.count;
+    }
+    if (workers > IO_MAX_THREADS) {
+        workers = IO_MAX_THREADS;
+    }
+    log_message("Zoned %s: %u zone(s) written in parallel", reset_only ? "reset" : "overwrite", workers);
+
+    int result = 0;
+    for (int pass = 0; pass < scheme->pass_count && result == 0; pass++) {
+        char pattern_str[16];
+        pattern_describe(&scheme->passes[pass], pattern_str, sizeof(pattern_str));
+        progress_set_pass(progress, pass + 1, scheme->pass_count, pattern_str);
+        log_message("Pass %d/%d: %s, zones reset then written sequentially", pass + 1, scheme->pass_count,
+                    pattern_str);
+
+        if (!progress->quiet) {
+            printf("Resetting zones...\n\n");
+        }
+        result = zoned_reset(fd, &map, reset_only ? progress : NULL);
+        if (result != 0) {
+            break;
+        }
+
+        io_range_t range = {
+            .fd = fd,
+            .chunk_size = config->chunk_size - config->chunk_size % alignment,
+            .alignment = alignment,
+            .block_size = logical_block,
+            .pass = &scheme->passes[pass],
+            .config = &zone_config,
+            .progress = progress,
+            .throttle = throttle,
+            .read_fd = -1,
+        };
+        if (range.chunk_size == 0) {
+            range.chunk_size = alignment;
+        }
+
+        result = zoned_write(&range, &map, workers, reset_only);
+
+        if (result == 0 && fsync(fd) < 0) {
+            perror("fsync");
+            result = -1;
+        }
+    }
+
+    if (result == 0) {
+        log_message("Erase method: %s completed on %u zone(s) of %s", reset_only ? "zonereset (BLKRESETZONE)" :
+                    "overwrite (zone by zone)", map.count, disk_path);
+    }
+
+    zoned_free(&map);
+    close(fd);
+    return result;
+}
+
+size_t wipe_aligned_size(int fd, size_t disk_size, int direct_io) {
+    struct stat st;
+
+    if (!direct_io || fstat(fd, &st) != 0 || !S_ISBLK(st.st_mode)) {
+        return disk_size;
+    }
+    ssize_t block_size = get_block_size(fd);
+    size_t logical_block = block_size > 0 ? (size_t)block_size : 512;
+    return disk_size - disk_size % logical_block;
+}
+
+int wipe_checkpoint_prepare(const char *disk_path, size_t disk_size, size_t aligned_size, wipe_options_t *options,
+                            checkpoint_t *checkpoint) {
+    checkpoint_t saved;
+    int loaded = checkpoint_load(&saved, disk_path);
+
+    if (loaded < 0) {
+        return -1;
+    }
+
+    if (loaded == 0 && !options->resume) {
+        fprintf(stderr, "WARNING: %s has an unfinished wipe (pass %d/%d, %.1f%% done); "
+                "use --resume to continue it, otherwise it starts over\n", disk_path, saved.pass + 1,
+                saved.pass_count, checkpoint_percent(&saved));
+    } else if (loaded == 1 && options->resume) {
+        fprintf(stderr, "WARNING: No checkpoint found for %s, starting from the beginning\n", disk_path);
+    }
+
+    if (loaded != 0 || !options->resume) {
+        checkpoint_init(checkpoint, disk_path, disk_size, options->method, &options->scheme, options->seed,
+                        options->checkpoint_interval);
+        return 0;
+    }
+
+    if (!checkpoint_matches(&saved, disk_path, disk_size, aligned_size)) {
+        return -1;
+    }
+
+    // Metodo, schema e seed vengono dal journal: le passate casuali devono rigenerare lo stesso flusso
+    wipe_scheme_t scheme;
+    if (scheme_from_name(saved.passes, &scheme) != 0 || scheme.pass_count != saved.pass_count) {
+        fprintf(stderr, "ERROR: Invalid passes '%s' in checkpoint journal %s\n", saved.passes, saved.path);
+        return -1;
+    }
+    snprintf(scheme.name, sizeof(scheme.name), "%s", saved.scheme);
+    scheme_set_seed(&scheme, saved.seed);
+
+    options->scheme = scheme;
+    options->method = saved.method;
+    options->seed = saved.seed;
+
+    *checkpoint = saved;
+    snprintf(checkpoint->device, sizeof(checkpoint->device), "%s", disk_path);
+    checkpoint->interval = options->checkpoint_interval;
+
+    log_message("Resuming wipe of %s from %s: pass %d/%d, %zu bytes already erased, scheme %s, seed 0x%016llx",
+                disk_path, checkpoint->path, checkpoint->pass + 1, checkpoint->pass_count,
+                checkpoint_done_bytes(checkpoint), checkpoint->scheme, (unsigned long long)checkpoint->seed);
+    return 1;
+}
+
+int wipe_disk(int fd, const char *disk_path, size_t disk_size, const wipe_options_t *options,
+              checkpoint_t *checkpoint, progress_info_t *progress) {
+    const wipe_scheme_t *scheme = &options->scheme;
+    io_config_t tuned = options->io; // chunk e queue depth possono cambiare con l'auto-tuning
+    const io_config_t *config = &tuned;
+    io_engine_t engine = config->engine;
+    size_t alignment = 4096;
+    size_t aligned_size = disk_size;
+    int result = 0;
+
+    if (progress->stats) {
+        io_stats_init(progress->stats, disk_size, IO_STATS_STALL_NS);
+    }
+
+    // Device a zone: le zone sequenziali accettano solo scritture al write pointer
+    zoned_model_t zoned = zoned_model(disk_path);
+
+    if (options->method == WIPE_METHOD_QUICK && zoned != ZONED_NONE) {
+        fprintf(stderr, "ERROR: %s is a zoned device: its metadata cannot be rewritten in place, "
+                "use --method=zonereset\n", disk_path);
+        return -1;
+    }
+
+    if (options->method == WIPE_METHOD_QUICK) {
+        result = wipe_quick(fd, disk_path, disk_size, engine, progress);
+        if (result == 0) {
+            checkpoint_remove(checkpoint);
+        }
+        return result;
+    }
+
+    if (options->method != WIPE_METHOD_OVERWRITE && !(options->method == WIPE_METHOD_ZONERESET && zoned)) {
+        result = wipe_offload(fd, disk_path, disk_size, options->method, progress);
+        if (result == 0) {
+            checkpoint_remove(checkpoint);
+        }
+        if (result != 1) {
+            return result;
+        }
+        result = 0;
+    }
+
+    // O_DIRECT richiede buffer, offset e lunghezze multipli del blocco logico
+    // (un file regolare, come nei benchmark, usa l'allineamento di default);
+    // anche la bisezione degli errori di scrittura scende fino al blocco logico
+    struct stat st;
+    int is_block = fstat(fd, &st) == 0 && S_ISBLK(st.st_mode);
+    size_t logical_block = 512;
+    if (is_block) {
+        ssize_t block_size = get_block_size(fd);
+        if (block_size > 0) {
+            logical_block = (size_t)block_size;
+        }
+    }
+    if (config->direct_io && is_block) {
+        if (logical_block > alignment) {
+            alignment = logical_block;
+        }
+        aligned_size = wipe_aligned_size(fd, disk_size, config->direct_io);
+        log_message("Direct I/O enabled - logical block size: %zu bytes", logical_block);
+    }
+
+    // io_uring può essere assente (kernel < 5.6) o disabilitato (seccomp, sysctl)
+    if (engine == IO_ENGINE_URING && !io_uring_available()) {
+        if (!progress->quiet) {
+            fprintf(stderr, "WARNING: io_uring not available, falling back to synchronous writes\n");
+        }
+        log_message("io_uring not available, falling back to sync engine");
+        engine = IO_ENGINE_SYNC;
+    }
+
+    if (engine == IO_ENGINE_URING) {
+        log_message("Write engine: io_uring (queue depth %u, batch %u, chunk %zu bytes)", config->queue_depth,
+                    config->batch_size, config->chunk_size);
+    } else {
+        log_message("Write engine: sync (chunk %zu bytes)", config->chunk_size);
+    }
+
+    if (config->skip_bad) {
+        log_message("Bad block tolerance enabled: media errors are bisected to %zu-byte blocks", logical_block);
+    }
+
+    // Limite condiviso da tutti gli stripe del wipe
+    throttle_t throttle;
+    int throttled = throttle_enabled(&config->throttle);
+    if (throttled) {
+        char limits[256];
+        throttle_init(&throttle, &config->throttle);
+        log_message("Throttle: %s", throttle_describe(&config->throttle, limits, sizeof(limits)));
+    }
+
+    // Il checkpoint non serve: un wipe interrotto riparte dal reset delle zone
+    if (zoned != ZONED_NONE) {
+        result = wipe_zoned(disk_path, options, config, logical_block, throttled ? &throttle : NULL, progress);
+        if (progress->stats) {
+            io_stats_log(progress->stats, disk_path);
+        }
+        checkpoint_remove(checkpoint);
+        if (result == -2 && !progress->quiet) {
+            printf("\n\nOperation interrupted by user.\n");
+        }
+        return result;
+    }
+
+    // Read-compare-write: un descrittore separato per le letture, con la stessa modalità di I/O
+    int read_fd = -1;
+    if (config->read_compare) {
+        read_fd = open_disk_read(disk_path, config->direct_io);
+        if (read_fd < 0) {
+            return -1;
+        }
+        log_message("Read-compare-write enabled: only blocks differing from the pass are written");
+    }
+
+    // Con un limite la sonda misurerebbe il limite, non il device; in read-compare-write misurerebbe le letture
+    int tune_pending = tuned.probe && (tuned.tune & IO_TUNE_PROBED) != 0 && !throttled && !config->read_compare;
+    if (tuned.probe && (tuned.tune & IO_TUNE_PROBED) != 0 && throttled) {
+        log_message("Auto-tuning skipped: writes are throttled");
+    } else if (tuned.probe && (tuned.tune & IO_TUNE_PROBED) != 0 && config->read_compare) {
+        log_message("Auto-tuning skipped: read-compare-write");
+    }
+
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    for (int pass = checkpoint->pass; pass < scheme->pass_count && result == 0; pass++) {
+        char pattern_str[16];
+        pattern_describe(&scheme->passes[pass], pattern_str, sizeof(pattern_str));
+        progress_set_pass(progress, pass + 1, scheme->pass_count, pattern_str);
+
+        // Una passata ripresa mantiene gli stripe del journal, anche se --threads è cambiato
+        if (checkpoint->stripe_count == 0) {
+            log_message("Pass %d/%d: %s", pass + 1, scheme->pass_count, pattern_str);
+            plan_stripes(checkpoint, aligned_size, config->chunk_size, config->threads);
+        } else {
+            log_message("Pass %d/%d: %s, resumed at %zu bytes in %d stripe(s)", pass + 1, scheme->pass_count,
+                        pattern_str, checkpoint_done_bytes(checkpoint) - disk_size * (size_t)pass,
+                        checkpoint->stripe_count);
+        }
+        checkpoint->pass = pass;
+
+        io_range_t range = {
+            .fd = fd,
+            .start = 0,
+            .length = aligned_size,
+            .chunk_size = config->chunk_size,
+            .alignment = alignment,
+            .block_size = logical_block,
+            .pass = &scheme->passes[pass],
+            .config = config,
+            .progress = progress,
+            .cancel = NULL,
+            .throttle = throttled ? &throttle : NULL,
+            .read_fd = read_fd,
+        };
+
+        // Sonda sul primo stripe ancora da scrivere, una sola volta per wipe
+        for (int i = 0; tune_pending && i < checkpoint->stripe_count; i++) {
+            if (checkpoint->stripes[i].done < checkpoint->stripes[i].end) {
+                result = tune_io(engine, &range, &checkpoint->stripes[i], &tuned, &progress->threads[i]);
+                range.chunk_size = tuned.chunk_size;
+                tune_pending = 0;
+            }
+        }
+        if (result != 0) {
+            break;
+        }
+        checkpoint_save(checkpoint);
+
+        result = wipe_pass(engine, &range, checkpoint, disk_size);
+
+        // Passata durevole: il journal riparte dalla successiva
+        if (result == 0 && pass + 1 < scheme->pass_count) {
+            checkpoint->pass = pass + 1;
+            checkpoint->stripe_count = 0;
+            checkpoint_save(checkpoint);
+        }
+    }
+
+    if (read_fd >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (progress->stats) {
+            io_stats_compare_finish(progress->stats,
+                                    (double)(end.tv_sec - begin.tv_sec) + (double)(end.tv_nsec - begin.tv_nsec) / 1e9,
+                                    config->threads);
+        }
+        close(read_fd);
+    }
+
+    if (progress->stats) {
+        io_stats_log(progress->stats, disk_path);
+    }
+
+    if (result == 0) {
+        checkpoint_remove(checkpoint);
+    } else if (checkpoint->interval > 0) {
+        log_message("Checkpoint of %s saved in %s: pass %d/%d, %zu bytes erased", disk_path, checkpoint->path,
+                    checkpoint->pass + 1, checkpoint->pass_count, checkpoint_done_bytes(checkpoint));
+    }
+
+    if (result == -2 && !progress->quiet) {
+        printf("\n\nOperation interrupted by user.\n");
+    }
+
+    return result;
+}
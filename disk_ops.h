@@ -2,16 +2,54 @@
 #define DISK_OPS_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <sys/types.h>
+#include "checkpoint.h"
+#include "io_engine.h"
+#include "offload.h"
+#include "pattern.h"
 #include "progress.h"
+#include "verify.h"
+
+#define TUNE_TIME_BUDGET 3.0                     // secondi complessivi della sonda di auto-tuning
+#define TUNE_FIRST_TRIAL (16 * 1024 * 1024)      // byte della prima prova, le successive seguono la velocità misurata
+#define TUNE_MAX_BUFFERS (64 * 1024 * 1024)      // chunk * queue depth massimi provati
+#define TUNE_MIN_REGION (256ULL * 1024 * 1024)   // sotto questa regione la sonda non è attendibile
+
+// Opzioni complete di un'operazione di cancellazione (interattiva o batch)
+typedef struct {
+    wipe_scheme_t scheme;
+    io_config_t io;
+    wipe_method_t method;   // sovrascrittura o offload al kernel (lo schema è allora un'unica passata di zeri)
+    verify_config_t verify; // verifica dopo l'ultima passata
+    uint64_t seed;          // seed dello schema, registrato nel journal
+    unsigned int checkpoint_interval; // secondi tra due checkpoint, 0 disabilita il journal
+    int resume;             // riprendere dal journal del device, se presente
+    const char *certificate_dir; // certificato di cancellazione (cert.h) in questa cartella, NULL se non richiesto
+} wipe_options_t;
 
 // Funzioni per gestire le operazioni sul disco
 int list_disks(void);
 int verify_disk(const char *disk_path);
 int is_system_disk(const char *disk_path);
 int unmount_disk(const char *disk_path);
-int open_disk_raw(const char *disk_path);
+int open_disk_raw(const char *disk_path, int direct_io);
+// Apertura in sola lettura per la verifica; con direct_io le letture non passano dalla page cache
+int open_disk_read(const char *disk_path, int direct_io);
 ssize_t get_disk_size(int fd);
-int wipe_disk(int fd, size_t disk_size, progress_info_t *progress);
+ssize_t get_block_size(int fd);
+// Parte del device scritta a stripe: disk_size, arrotondata al blocco logico con O_DIRECT su un block device
+// (la coda la scrive write_unaligned_tail)
+size_t wipe_aligned_size(int fd, size_t disk_size, int direct_io);
+// Prepara il journal del wipe. Con options->resume riprende quello del device, se presente,
+// e ne adotta metodo, schema e seed; aligned_size viene da wipe_aligned_size(). Ritorna 1 se
+// il wipe riprende, 0 se parte da capo, -1 se il journal appartiene a un altro device, non
+// copre aligned_size o è illeggibile.
+int wipe_checkpoint_prepare(const char *disk_path, size_t disk_size, size_t aligned_size, wipe_options_t *options,
+                            checkpoint_t *checkpoint);
+// Esegue il metodo scelto o le passate dello schema a partire dal checkpoint; rimuove il journal
+// al termine. progress->total_bytes deve coprire disk_size * pass_count
+int wipe_disk(int fd, const char *disk_path, size_t disk_size, const wipe_options_t *options,
+              checkpoint_t *checkpoint, progress_info_t *progress);
 
 #endif // DISK_OPS_H
@@ -0,0 +1,535 @@
+#define _GNU_SOURCE
+
+#include "inventory.h"
+#include "sysfs.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/mount.h>
+#include <sys/sysmacros.h>
+
+#define INVENTORY_MAX_DEPTH 8 // catene di holder (partizione -> md -> LVM -> dm-crypt)
+
+// mountinfo codifica spazi e caratteri speciali del path come \ooo
+static void unescape_path(const char *src, char *dst, size_t dst_size) {
+    size_t used = 0;
+
+    while (*src && used + 1 < dst_size) {
+        if (src[0] == '\\' && src[1] >= '0' && src[1] <= '7' && src[2] >= '0' && src[2] <= '7' &&
+            src[3] >= '0' && src[3] <= '7') {
+            dst[used++] = (char)((src[1] - '0') * 64 + (src[2] - '0') * 8 + (src[3] - '0'));
+            src += 4;
+        } else {
+            dst[used++] = *src++;
+        }
+    }
+    dst[used] = '\0';
+}
+
+static int device_number(const char *path, unsigned int *major_out, unsigned int *minor_out) {
+    struct stat st;
+    if (strncmp(path, "/dev/", 5) != 0 || stat(path, &st) != 0 || !S_ISBLK(st.st_mode)) {
+        return -1;
+    }
+    *major_out = major(st.st_rdev);
+    *minor_out = minor(st.st_rdev);
+    return 0;
+}
+
+// Aggiunge un elemento a un array che raddoppia al bisogno
+static void *grow(void *array, int count, int *capacity, size_t item_size) {
+    if (count < *capacity) {
+        return array;
+    }
+    int next = *capacity > 0 ? *capacity * 2 : 64;
+    void *grown = realloc(array, (size_t)next * item_size);
+    if (grown) {
+        *capacity = next;
+    }
+    return grown;
+}
+
+int mount_table_load(mount_table_t *table) {
+    memset(table, 0, sizeof(*table));
+
+    FILE *fp = fopen("/proc/self/mountinfo", "r");
+    if (!fp) {
+        perror("fopen(/proc/self/mountinfo)");
+        return -1;
+    }
+
+    char line[PATH_MAX * 2 + 512];
+    int capacity = 0;
+
+    // "36 35 98:0 /root /mnt rw,noatime shared:1 - ext4 /dev/sda1 rw"
+    while (fgets(line, sizeof(line), fp)) {
+        char *save = NULL;
+        char *fields[8] = {NULL};
+        int count = 0;
+        char *source = NULL;
+
+        for (char *field = strtok_r(line, " \n", &save); field; field = strtok_r(NULL, " \n", &save)) {
+            if (strcmp(field, "-") == 0) {
+                strtok_r(NULL, " \n", &save); // tipo di filesystem
+                source = strtok_r(NULL, " \n", &save);
+                break;
+            }
+            if (count < 8) {
+                fields[count++] = field;
+            }
+        }
+
+        unsigned int fs_major, fs_minor;
+        if (count < 5 || sscanf(fields[2], "%u:%u", &fs_major, &fs_minor) != 2) {
+            continue;
+        }
+
+        mount_entry_t *mounts = grow(table->mounts, table->mount_count, &capacity, sizeof(mount_entry_t));
+        if (!mounts) {
+            perror("realloc");
+            fclose(fp);
+            mount_table_free(table);
+            return -1;
+        }
+        table->mounts = mounts;
+
+        mount_entry_t *entry = &table->mounts[table->mount_count++];
+        entry->major = entry->src_major = fs_major;
+        entry->minor = entry->src_minor = fs_minor;
+        if (source) {
+            device_number(source, &entry->src_major, &entry->src_minor);
+        }
+        unescape_path(fields[4], entry->mountpoint, sizeof(entry->mountpoint));
+    }
+    fclose(fp);
+
+    // Le aree di swap su partizione o volume; i file di swap stanno su un filesystem già montato
+    fp = fopen("/proc/swaps", "r");
+    if (fp) {
+        capacity = 0;
+        while (fgets(line, sizeof(line), fp)) {
+            char path[PATH_MAX];
+            unsigned int swap_major, swap_minor;
+
+            if (sscanf(line, "%4095s", path) != 1 || device_number(path, &swap_major, &swap_minor) != 0) {
+                continue;
+            }
+
+            swap_entry_t *swaps = grow(table->swaps, table->swap_count, &capacity, sizeof(swap_entry_t));
+            if (!swaps) {
+                break;
+            }
+            table->swaps = swaps;
+            table->swaps[table->swap_count].major = swap_major;
+            table->swaps[table->swap_count].minor = swap_minor;
+            table->swap_count++;
+        }
+        fclose(fp);
+    }
+
+    return 0;
+}
+
+void mount_table_free(mount_table_t *table) {
+    free(table->mounts);
+    free(table->swaps);
+    memset(table, 0, sizeof(*table));
+}
+
+static int read_dev(const char *name, unsigned int *major_out, unsigned int *minor_out) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/sys/class/block/%s/dev", name);
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+    int result = fscanf(fp, "%u:%u", major_out, minor_out) == 2 ? 0 : -1;
+    fclose(fp);
+    return result;
+}
+
+static int is_partition(const char *name) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/sys/class/block/%s/partition", name);
+    return access(path, F_OK) == 0;
+}
+
+// Il primo motivo di sistema prevale su quelli informativi
+static void add_usage(disk_info_t *info, unsigned int flag, const char *format, ...) {
+    int replace = (flag & DISK_USE_SYSTEM) && !(info->usage & DISK_USE_SYSTEM);
+
+    if (replace || info->usage_detail[0] == '\0') {
+        va_list args;
+        va_start(args, format);
+        vsnprintf(info->usage_detail, sizeof(info->usage_detail), format, args);
+        va_end(args);
+    }
+    info->usage |= flag;
+}
+
+static void collect_usage(const char *name, const mount_table_t *table, disk_info_t *info, int depth) {
+    unsigned int dev_major, dev_minor;
+
+    if (depth > INVENTORY_MAX_DEPTH) {
+        return;
+    }
+
+    if (read_dev(name, &dev_major, &dev_minor) == 0) {
+        for (int i = 0; i < table->mount_count; i++) {
+            const mount_entry_t *entry = &table->mounts[i];
+            if (!(entry->major == dev_major && entry->minor == dev_minor) &&
+                !(entry->src_major == dev_major && entry->src_minor == dev_minor)) {
+                continue;
+            }
+
+            const char *mountpoint = entry->mountpoint;
+            unsigned int flag = DISK_USE_MOUNTED;
+            if (strcmp(mountpoint, "/") == 0) {
+                flag |= DISK_USE_ROOT;
+            } else if (strcmp(mountpoint, "/boot") == 0 || strncmp(mountpoint, "/boot/", 6) == 0) {
+                flag |= DISK_USE_BOOT;
+            }
+            add_usage(info, flag, "%s mounted on %s", name, mountpoint);
+        }
+
+        for (int i = 0; i < table->swap_count; i++) {
+            if (table->swaps[i].major == dev_major && table->swaps[i].minor == dev_minor) {
+                add_usage(info, DISK_USE_SWAP, "%s used as swap", name);
+            }
+        }
+    }
+
+    // Holder: device costruiti sopra questo (volumi LVM, array md, dm-crypt, multipath)
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/sys/class/block/%s/holders", name);
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        char uuid[128] = "";
+        char holder_path[PATH_MAX];
+        snprintf(holder_path, sizeof(holder_path), "/dev/%s", entry->d_name);
+        sysfs_read_string(holder_path, "dm/uuid", uuid, sizeof(uuid));
+
+        if (strncmp(entry->d_name, "md", 2) == 0) {
+            add_usage(info, DISK_USE_MD, "%s in md array %s", name, entry->d_name);
+        } else if (strncmp(uuid, "LVM-", 4) == 0) {
+            add_usage(info, DISK_USE_LVM, "%s in LVM (%s)", name, entry->d_name);
+        } else {
+            add_usage(info, DISK_USE_HOLDER, "%s held by %s", name, entry->d_name);
+        }
+        collect_usage(entry->d_name, table, info, depth + 1);
+    }
+    closedir(dir);
+}
+
+int inventory_disk(const char *disk_path, const mount_table_t *table, disk_info_t *info) {
+    memset(info, 0, sizeof(*info));
+    if (sysfs_device_name(disk_path, info->name, sizeof(info->name)) != 0) {
+        return -1;
+    }
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/sys/class/block/%s", info->name);
+    if (access(path, F_OK) != 0) {
+        return -1;
+    }
+
+    unsigned long long value;
+    if (sysfs_read_u64(disk_path, "size", &value) == 0) {
+        info->size = value * 512; // sempre in settori da 512 byte
+    }
+    if (sysfs_queue_u64(disk_path, "rotational", &value) == 0) {
+        info->rotational = value != 0;
+    }
+    if (sysfs_read_u64(disk_path, "removable", &value) == 0) {
+        info->removable = value != 0;
+    }
+    if (sysfs_read_string(disk_path, "device/model", info->model, sizeof(info->model)) != 0) {
+        info->model[0] = '\0';
+    }
+    if (sysfs_read_string(disk_path, "device/serial", info->serial, sizeof(info->serial)) != 0) {
+        info->serial[0] = '\0';
+    }
+    if (sysfs_read_string(disk_path, "wwid", info->wwn, sizeof(info->wwn)) != 0 &&
+        sysfs_read_string(disk_path, "device/wwid", info->wwn, sizeof(info->wwn)) != 0) {
+        info->wwn[0] = '\0';
+    }
+
+    collect_usage(info->name, table, info, 0);
+
+    // Un disco intero comprende tutte le sue partizioni
+    if (!is_partition(info->name)) {
+        DIR *dir = opendir(path);
+        if (dir) {
+            struct dirent *entry;
+            while ((entry = readdir(dir)) != NULL) {
+                if (strncmp(entry->d_name, info->name, strlen(info->name)) == 0 && is_partition(entry->d_name)) {
+                    info->partition_count++;
+                    collect_usage(entry->d_name, table, info, 1);
+                }
+            }
+            closedir(dir);
+        }
+    }
+
+    return 0;
+}
+
+static const char *usage_label(unsigned int usage) {
+    if (usage & DISK_USE_SYSTEM) {
+        return "SYSTEM";
+    }
+    if (usage & DISK_USE_STACKED) {
+        return "in use";
+    }
+    if (usage & DISK_USE_MOUNTED) {
+        return "mounted";
+    }
+    return "-";
+}
+
+static int compare_names(const struct dirent **a, const struct dirent **b) {
+    return strverscmp((*a)->d_name, (*b)->d_name);
+}
+
+int inventory_list(void) {
+    mount_table_t table;
+    struct dirent **names;
+
+    if (mount_table_load(&table) != 0) {
+        return -1;
+    }
+
+    int count = scandir("/sys/block", &names, NULL, compare_names);
+    if (count < 0) {
+        perror("scandir(/sys/block)");
+        mount_table_free(&table);
+        return -1;
+    }
+
+    printf("  %-12s %10s %-6s %-24s %-20s %s\n", "NAME", "SIZE", "TYPE", "MODEL", "SERIAL", "USAGE");
+    for (int i = 0; i < count; i++) {
+        disk_info_t info;
+        char disk_path[PATH_MAX];
+
+        snprintf(disk_path, sizeof(disk_path), "/dev/%s", names[i]->d_name);
+        if (names[i]->d_name[0] != '.' && inventory_disk(disk_path, &table, &info) == 0 && info.size > 0) {
+            char size_str[64];
+            format_bytes(info.size, size_str, sizeof(size_str));
+            char type[8];
+            snprintf(type, sizeof(type), "%s%s", info.rotational ? "HDD" : "SSD", info.removable ? " RM" : "");
+            printf("  %-12s %10s %-6s %-24.24s %-20.20s %s", info.name, size_str, type, info.model,
+                   info.serial[0] != '\0' ? info.serial : info.wwn, usage_label(info.usage));
+            if (info.usage_detail[0] != '\0') {
+                printf(" (%s)", info.usage_detail);
+            }
+            printf("\n");
+        }
+        free(names[i]);
+    }
+
+    free(names);
+    mount_table_free(&table);
+    return 0;
+}
+
+// WWN senza prefisso di tipo, spazi e maiuscole: "naa.5000C500..." e "0x5000c500..." coincidono
+static void normalize_wwn(const char *src, char *dst, size_t dst_size) {
+    static const char *const prefixes[] = {"naa.", "eui.", "t10.", "0x"};
+    size_t len = 0;
+
+    for (size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); i++) {
+        if (strncasecmp(src, prefixes[i], strlen(prefixes[i])) == 0) {
+            src += strlen(prefixes[i]);
+            break;
+        }
+    }
+    for (; *src != '\0' && len + 1 < dst_size; src++) {
+        if (!isspace((unsigned char)*src)) {
+            dst[len++] = (char)tolower((unsigned char)*src);
+        }
+    }
+    dst[len] = '\0';
+}
+
+int inventory_find(const char *serial, const char *wwn, char *disk_path, size_t path_size) {
+    struct dirent **names;
+    char wanted[64] = "";
+    int matches = 0;
+
+    if (wwn && wwn[0] != '\0') {
+        normalize_wwn(wwn, wanted, sizeof(wanted));
+    }
+
+    int count = scandir("/sys/block", &names, NULL, compare_names);
+    if (count < 0) {
+        perror("scandir(/sys/block)");
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        char path[PATH_MAX];
+        char value[64];
+        int match = names[i]->d_name[0] != '.';
+
+        snprintf(path, sizeof(path), "/dev/%s", names[i]->d_name);
+        if (match && serial && serial[0] != '\0') {
+            match = sysfs_read_string(path, "device/serial", value, sizeof(value)) == 0 && strcmp(value, serial) == 0;
+        }
+        if (match && wanted[0] != '\0') {
+            char found[64];
+            match = (sysfs_read_string(path, "wwid", value, sizeof(value)) == 0 ||
+                     sysfs_read_string(path, "device/wwid", value, sizeof(value)) == 0);
+            if (match) {
+                normalize_wwn(value, found, sizeof(found));
+                match = strcmp(found, wanted) == 0;
+            }
+        }
+        if (match && matches++ == 0) {
+            snprintf(disk_path, path_size, "%s", path);
+        }
+        free(names[i]);
+    }
+
+    free(names);
+    return matches;
+}
+
+static int belongs_to(const char *disk_name, unsigned int dev_major, unsigned int dev_minor) {
+    char path[PATH_MAX];
+    unsigned int disk_major, disk_minor;
+
+    if (read_dev(disk_name, &disk_major, &disk_minor) == 0 && disk_major == dev_major && disk_minor == dev_minor) {
+        return 1;
+    }
+
+    // Una partizione ha il disco come directory padre in /sys/dev/block
+    snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/partition", dev_major, dev_minor);
+    if (access(path, F_OK) != 0) {
+        return 0;
+    }
+
+    char resolved[PATH_MAX];
+    snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/..", dev_major, dev_minor);
+    if (!realpath(path, resolved)) {
+        return 0;
+    }
+    const char *parent = strrchr(resolved, '/');
+    return parent && strcmp(parent + 1, disk_name) == 0;
+}
+
+// Vero se mountpoint è dentro parent (non uguale)
+static int is_nested(const char *mountpoint, const char *parent) {
+    size_t len = strlen(parent);
+    if (strcmp(parent, "/") == 0) {
+        return 0; // il disco di sistema non arriva fin qui
+    }
+    return strncmp(mountpoint, parent, len) == 0 && mountpoint[len] == '/';
+}
+
+int inventory_unmount(const char *disk_path) {
+    mount_table_t table;
+    char name[NAME_MAX + 1];
+    int failed = 0;
+
+    if (sysfs_device_name(disk_path, name, sizeof(name)) != 0 || mount_table_load(&table) != 0) {
+        return -1;
+    }
+
+    char *targets = calloc((size_t)table.mount_count + 1, 1);
+    if (!targets) {
+        perror("calloc");
+        mount_table_free(&table);
+        return -1;
+    }
+
+    // Filesystem del disco, più tutto ciò che vi è montato sopra (altrimenti EBUSY)
+    for (int i = 0; i < table.mount_count; i++) {
+        const mount_entry_t *entry = &table.mounts[i];
+        if (belongs_to(name, entry->major, entry->minor) || belongs_to(name, entry->src_major, entry->src_minor)) {
+            targets[i] = 1;
+            for (int j = 0; j < table.mount_count; j++) {
+                if (is_nested(table.mounts[j].mountpoint, entry->mountpoint)) {
+                    targets[j] = 1;
+                }
+            }
+        }
+    }
+
+    // Dall'ultimo montato al primo: i mount annidati vanno smontati prima del padre
+    for (int i = table.mount_count - 1; i >= 0; i--) {
+        const mount_entry_t *entry = &table.mounts[i];
+        if (!targets[i]) {
+            continue;
+        }
+
+        if (umount2(entry->mountpoint, 0) == 0) {
+            printf("  Unmounted %s\n", entry->mountpoint);
+            log_message("Unmounted %s from %s", entry->mountpoint, disk_path);
+        } else {
+            fprintf(stderr, "WARNING: Cannot unmount %s: %s\n", entry->mountpoint, strerror(errno));
+            log_message("Failed to unmount %s: %s", entry->mountpoint, strerror(errno));
+            failed++;
+        }
+    }
+
+    free(targets);
+    mount_table_free(&table);
+    return failed;
+}
+
+#else
+
+int mount_table_load(mount_table_t *table) {
+    memset(table, 0, sizeof(*table));
+    return -1;
+}
+
+void mount_table_free(mount_table_t *table) {
+    (void)table;
+}
+
+int inventory_disk(const char *disk_path, const mount_table_t *table, disk_info_t *info) {
+    (void)disk_path;
+    (void)table;
+    (void)info;
+    return -1;
+}
+
+int inventory_list(void) {
+    return -1;
+}
+
+int inventory_find(const char *serial, const char *wwn, char *disk_path, size_t path_size) {
+    (void)serial;
+    (void)wwn;
+    (void)disk_path;
+    (void)path_size;
+    return -1;
+}
+
+int inventory_unmount(const char *disk_path) {
+    (void)disk_path;
+    return -1;
+}
+
+#endif
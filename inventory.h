@@ -0,0 +1,69 @@
+#ifndef INVENTORY_H
+#define INVENTORY_H
+
+#include <limits.h>
+#include <stddef.h>
+
+// Inventario dei dischi senza processi esterni: /sys/block per gli attributi,
+// /proc/self/mountinfo e /proc/swaps per l'uso (solo Linux, -1 altrove)
+
+// Uso di un disco o di una sua partizione, anche attraverso LVM, md o altri device-mapper
+#define DISK_USE_MOUNTED 0x01
+#define DISK_USE_ROOT    0x02
+#define DISK_USE_BOOT    0x04
+#define DISK_USE_SWAP    0x08
+#define DISK_USE_LVM     0x10
+#define DISK_USE_MD      0x20
+#define DISK_USE_HOLDER  0x40 // dm-crypt, multipath o altro device-mapper
+#define DISK_USE_SYSTEM  (DISK_USE_ROOT | DISK_USE_BOOT | DISK_USE_SWAP)
+#define DISK_USE_STACKED (DISK_USE_LVM | DISK_USE_MD | DISK_USE_HOLDER)
+
+typedef struct {
+    unsigned int major;      // device del filesystem (da mountinfo, o dalla sorgente /dev/...)
+    unsigned int minor;
+    unsigned int src_major;  // device della sorgente: differisce con btrfs (device anonimo)
+    unsigned int src_minor;
+    char mountpoint[PATH_MAX];
+} mount_entry_t;
+
+typedef struct {
+    unsigned int major;
+    unsigned int minor;
+} swap_entry_t;
+
+// Filesystem montati e aree di swap su block device, letti una sola volta per l'inventario
+typedef struct {
+    mount_entry_t *mounts;
+    int mount_count;
+    swap_entry_t *swaps;
+    int swap_count;
+} mount_table_t;
+
+typedef struct {
+    char name[NAME_MAX + 1];
+    unsigned long long size;  // byte
+    char model[64];
+    char serial[64];
+    char wwn[64];             // World Wide Name (wwid), es. "naa.5000c500a1b2c3d4"
+    int rotational;
+    int removable;
+    int partition_count;
+    unsigned int usage;       // DISK_USE_* del disco e di tutte le sue partizioni
+    char usage_detail[160];   // motivo principale, es. "sda2 mounted on /" o "sda3 in LVM (dm-0)"
+} disk_info_t;
+
+int mount_table_load(mount_table_t *table);
+void mount_table_free(mount_table_t *table);
+
+// Attributi e uso del disco (o della sola partizione, se disk_path è una partizione)
+int inventory_disk(const char *disk_path, const mount_table_t *table, disk_info_t *info);
+// Elenco dei dischi in /sys/block con dimensione, modello, seriale e uso
+int inventory_list(void);
+// Cerca in /sys/block il disco con seriale e/o WWN indicati (NULL o vuoto: non confrontato;
+// il WWN è confrontato senza prefisso naa./eui./0x e senza distinguere maiuscole).
+// In disk_path il primo trovato; ritorna quanti dischi corrispondono, -1 su errore.
+int inventory_find(const char *serial, const char *wwn, char *disk_path, size_t path_size);
+// Smonta i filesystem del disco e delle sue partizioni con umount2(); ritorna quanti restano montati
+int inventory_unmount(const char *disk_path);
+
+#endif // INVENTORY_H
@@ -0,0 +1,867 @@
+#define _GNU_SOURCE
+
+#include "io_engine.h"
+#include "pattern.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+// Variabile globale per gestire interruzioni
+extern volatile sig_atomic_t interrupted;
+
+void io_config_default(io_config_t *config) {
+#ifdef __linux__
+    config->engine = IO_ENGINE_URING;
+#else
+    config->engine = IO_ENGINE_SYNC;
+#endif
+    config->queue_depth = IO_DEFAULT_QUEUE_DEPTH;
+    config->batch_size = IO_DEFAULT_BATCH_SIZE;
+    config->direct_io = 0;
+    config->threads = 1;
+    config->chunk_size = IO_DEFAULT_CHUNK_SIZE;
+    config->chunk_align = IO_MIN_CHUNK_SIZE;
+    config->tune = IO_TUNE_CHUNK_SIZE | IO_TUNE_QUEUE_DEPTH | IO_TUNE_THREADS;
+    config->probe = 1;
+    config->skip_bad = 0;
+    config->read_compare = 0;
+    throttle_config_default(&config->throttle);
+}
+
+int io_should_stop(const io_range_t *range) {
+    return interrupted || (range->cancel && *range->cancel);
+}
+
+void io_throttle_sleep(const io_range_t *range, uint64_t ns) {
+    const uint64_t slice = 100ULL * 1000 * 1000;
+
+    while (ns > 0 && !io_should_stop(range)) {
+        uint64_t step = ns < slice ? ns : slice;
+        struct timespec delay = {(time_t)(step / 1000000000ULL), (long)(step % 1000000000ULL)};
+        nanosleep(&delay, NULL);
+        ns -= step;
+    }
+}
+
+int io_media_error(int err) {
+    switch (err) {
+        case EIO:
+        case EILSEQ:
+        case EBADMSG:
+#ifdef ENODATA
+        case ENODATA:
+#endif
+#ifdef EREMOTEIO
+        case EREMOTEIO: // errore del supporto riportato da NVMe e SCSI
+#endif
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int io_pwrite_all(int fd, const void *buffer, size_t length, size_t offset) {
+    size_t done = 0;
+
+    while (done < length) {
+        ssize_t written = pwrite(fd, (const char *)buffer + done, length - done, (off_t)(offset + done));
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            if (written == 0) {
+                errno = EIO;
+            }
+            return -1;
+        }
+        done += (size_t)written;
+    }
+    return 0;
+}
+
+int io_pwrite_shared(int fd, const void *page, size_t length, size_t offset) {
+    struct iovec iov[IO_SHARED_IOVECS];
+    size_t done = 0;
+
+    while (done < length) {
+        int count = pattern_shared_iov(page, length - done, iov, IO_SHARED_IOVECS);
+        ssize_t written = pwritev(fd, iov, count, (off_t)(offset + done));
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            if (written == 0) {
+                errno = EIO;
+            }
+            return -1;
+        }
+        done += (size_t)written;
+    }
+    return 0;
+}
+
+// Blocchi non scrivibili consecutivi diventano un unico range nel report
+typedef struct {
+    size_t offset;
+    size_t length;
+} bad_run_t;
+
+static void flush_bad_run(const io_range_t *range, bad_run_t *run) {
+    if (run->length == 0) {
+        return;
+    }
+    log_message("Unwritable range: %zu bytes at offset %zu skipped", run->length, run->offset);
+    if (range->progress->stats) {
+        io_stats_bad_range(range->progress->stats, run->offset, run->length);
+    }
+    run->length = 0;
+}
+
+static int recover_write(const io_range_t *range, const char *buffer, size_t offset, size_t length, int shared) {
+    return shared ? io_pwrite_shared(range->fd, buffer, length, offset)
+                  : io_pwrite_all(range->fd, buffer, length, offset);
+}
+
+static int recover_range(const io_range_t *range, const char *buffer, size_t offset, size_t length, int shared,
+                         bad_run_t *run) {
+    if (io_should_stop(range)) {
+        return -2;
+    }
+
+    // Un solo blocco: tentativi limitati, poi nella skip map
+    if (length <= range->block_size) {
+        for (int attempt = 0; attempt < IO_BAD_BLOCK_RETRIES; attempt++) {
+            if (recover_write(range, buffer, offset, length, shared) == 0) {
+                flush_bad_run(range, run);
+                progress_update(range->progress, length);
+                return 0;
+            }
+            if (!io_media_error(errno)) {
+                perror("write");
+                return -1;
+            }
+        }
+
+        if (run->length > 0 && run->offset + run->length == offset) {
+            run->length += length;
+        } else {
+            flush_bad_run(range, run);
+            run->offset = offset;
+            run->length = length;
+        }
+        progress_update(range->progress, length);
+        return 0;
+    }
+
+    if (recover_write(range, buffer, offset, length, shared) == 0) {
+        flush_bad_run(range, run);
+        progress_update(range->progress, length);
+        return 0;
+    }
+    if (!io_media_error(errno)) {
+        perror("write");
+        return -1;
+    }
+
+    // Metà allineata al blocco logico: la parte sana torna subito a richieste grandi
+    size_t half = length / 2 / range->block_size * range->block_size;
+    if (half == 0) {
+        half = range->block_size;
+    }
+    int result = recover_range(range, buffer, offset, half, shared, run);
+    if (result != 0) {
+        return result;
+    }
+    return recover_range(range, shared ? buffer : buffer + half, offset + half, length - half, shared, run);
+}
+
+int io_write_recover(const io_range_t *range, const char *buffer, size_t offset, size_t length, int shared) {
+    bad_run_t run = {0, 0};
+
+    log_message("Media error in %zu bytes at offset %zu, bisecting to %zu-byte blocks", length, offset,
+                range->block_size);
+    int result = recover_range(range, buffer, offset, length, shared, &run);
+    flush_bad_run(range, &run);
+    return result;
+}
+
+int io_engine_from_name(const char *name, io_engine_t *engine) {
+    if (strcasecmp(name, "sync") == 0) {
+        *engine = IO_ENGINE_SYNC;
+        return 0;
+    }
+    if (strcasecmp(name, "io_uring") == 0 || strcasecmp(name, "uring") == 0) {
+        *engine = IO_ENGINE_URING;
+        return 0;
+    }
+    return -1;
+}
+
+const char *io_engine_name(io_engine_t engine) {
+    switch (engine) {
+        case IO_ENGINE_SYNC:
+            return "sync";
+        case IO_ENGINE_URING:
+            return "io_uring";
+    }
+    return "unknown";
+}
+
+#ifdef __linux__
+
+// Ring io_uring gestito direttamente via syscall (nessuna dipendenza da liburing)
+typedef struct {
+    int ring_fd;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr;
+    void *cq_ptr;
+    size_t sq_len;
+    size_t cq_len;
+    size_t sqes_len;
+    unsigned int pending; // SQE preparate ma non ancora sottomesse
+    int ext_arg;          // IORING_FEAT_EXT_ARG: attesa dei completamenti con timeout
+} uring_t;
+
+// Stato di una richiesta in volo
+typedef struct {
+    void *buffer;
+    struct iovec *iov;         // pattern fisso: iovec sulla pagina condivisa (IO_SHARED_IOVECS), NULL altrimenti
+    unsigned int buffer_index; // buffer della pipeline (indice registrato)
+    size_t offset; // offset assoluto sul device
+    size_t length; // byte totali della richiesta
+    size_t done;   // byte già completati (scritture parziali)
+    int active;    // richiesta in volo
+    uint64_t submitted; // istante di preparazione della SQE, per la latenza
+} uring_slot_t;
+
+static int sys_io_uring_setup(unsigned int entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int ring_fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags) {
+    return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int ring_fd, unsigned int opcode, const void *arg, unsigned int nr_args) {
+    return (int)syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+static void uring_close(uring_t *ring) {
+    if (ring->sqes && ring->sqes != MAP_FAILED) {
+        munmap(ring->sqes, ring->sqes_len);
+    }
+    if (ring->cq_ptr && ring->cq_ptr != MAP_FAILED && ring->cq_ptr != ring->sq_ptr) {
+        munmap(ring->cq_ptr, ring->cq_len);
+    }
+    if (ring->sq_ptr && ring->sq_ptr != MAP_FAILED) {
+        munmap(ring->sq_ptr, ring->sq_len);
+    }
+    if (ring->ring_fd >= 0) {
+        close(ring->ring_fd);
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->ring_fd = -1;
+}
+
+static int uring_open(uring_t *ring, unsigned int entries) {
+    struct io_uring_params params;
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&params, 0, sizeof(params));
+
+    ring->ring_fd = sys_io_uring_setup(entries, &params);
+    if (ring->ring_fd < 0) {
+        return -1;
+    }
+
+#ifdef IORING_FEAT_EXT_ARG
+    ring->ext_arg = (params.features & IORING_FEAT_EXT_ARG) != 0;
+#endif
+    ring->sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    // Con IORING_FEAT_SINGLE_MMAP SQ e CQ condividono la stessa mappatura
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_len > ring->sq_len) {
+            ring->sq_len = ring->cq_len;
+        }
+        ring->cq_len = ring->sq_len;
+    }
+
+    ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->ring_fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        uring_close(ring);
+        return -1;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring->ring_fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            uring_close(ring);
+            return -1;
+        }
+    }
+
+    ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->ring_fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        uring_close(ring);
+        return -1;
+    }
+
+    char *sq = ring->sq_ptr;
+    char *cq = ring->cq_ptr;
+    ring->sq_head = (unsigned int *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned int *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned int *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned int *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned int *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned int *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned int *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    return 0;
+}
+
+static struct io_uring_sqe *uring_get_sqe(uring_t *ring) {
+    unsigned int tail = *ring->sq_tail;
+    unsigned int head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    unsigned int mask = *ring->sq_mask;
+
+    if (tail - head > mask) {
+        return NULL; // SQ piena
+    }
+
+    unsigned int index = tail & mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->pending++;
+    return sqe;
+}
+
+// Sottomette le SQE pendenti ed eventualmente attende almeno wait_nr completamenti
+static int uring_submit(uring_t *ring, unsigned int wait_nr) {
+    unsigned int flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+
+    while (ring->pending > 0 || wait_nr > 0) {
+        int ret = sys_io_uring_enter(ring->ring_fd, ring->pending, wait_nr, flags);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                // Un segnale non deve far perdere SQE già accodate: il chiamante ricontrolla interrupted
+                if (interrupted) {
+                    return 0;
+                }
+                continue;
+            }
+            return -1;
+        }
+        ring->pending -= (unsigned int)ret < ring->pending ? (unsigned int)ret : ring->pending;
+        if (ring->pending == 0) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+// Sottomette le SQE pendenti e attende un completamento per al massimo timeout_ns.
+// Richiede ext_arg; il timeout scaduto (ETIME) non è un errore.
+static int uring_wait_timeout(uring_t *ring, uint64_t timeout_ns) {
+#ifdef IORING_ENTER_EXT_ARG
+    if (uring_submit(ring, 0) != 0) {
+        return -1;
+    }
+
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    ts.tv_sec = (long long)(timeout_ns / 1000000000ULL);
+    ts.tv_nsec = (long long)(timeout_ns % 1000000000ULL);
+    arg.ts = (uint64_t)(uintptr_t)&ts;
+
+    int ret = (int)syscall(__NR_io_uring_enter, ring->ring_fd, 0, 1,
+                           IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    if (ret < 0 && errno != ETIME && errno != EINTR) {
+        return -1;
+    }
+    return 0;
+#else
+    (void)timeout_ns;
+    return uring_submit(ring, 1);
+#endif
+}
+
+static void prep_rw(struct io_uring_sqe *sqe, uring_slot_t *slot, unsigned int slot_index,
+                    int fixed_buffers, int is_read, const io_range_t *range) {
+    if (range->progress->stats || range->throttle) {
+        slot->submitted = latency_now_ns();
+    }
+    if (is_read) {
+        sqe->opcode = fixed_buffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    } else {
+        sqe->opcode = fixed_buffers ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    }
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->fd = 0; // indice nella tabella dei fixed file
+    if (slot->iov) {
+        // Il resto del chunk, anche dopo una scrittura parziale, è la pagina condivisa ripetuta
+        sqe->opcode = IORING_OP_WRITEV;
+        sqe->addr = (unsigned long)slot->iov;
+        sqe->len = (unsigned int)pattern_shared_iov(slot->buffer, slot->length - slot->done, slot->iov,
+                                                    IO_SHARED_IOVECS);
+    } else {
+        sqe->addr = (unsigned long)((char *)slot->buffer + slot->done);
+        sqe->len = (unsigned int)(slot->length - slot->done);
+    }
+    sqe->off = slot->offset + slot->done;
+    sqe->buf_index = fixed_buffers ? (unsigned short)slot->buffer_index : 0;
+    sqe->user_data = slot_index;
+    if (!is_read && range->config->throttle.ioprio != THROTTLE_IOPRIO_NONE) {
+        sqe->ioprio = (unsigned short)range->config->throttle.ioprio;
+    }
+}
+
+int io_uring_available(void) {
+    uring_t ring;
+
+    if (uring_open(&ring, 1) != 0) {
+        return 0;
+    }
+    uring_close(&ring);
+    return 1;
+}
+
+// Ciclo comune a scritture e letture: con consume NULL scrive la passata range->pass,
+// altrimenti legge l'intervallo e passa ogni chunk completato a consume
+static int uring_run(const io_range_t *range, io_read_fn consume, void *ctx) {
+    int is_read = consume != NULL;
+    const char *op_name = is_read ? "read" : "write";
+    unsigned int depth = range->config->queue_depth;
+    unsigned int batch = range->config->batch_size;
+
+    if (depth == 0 || depth > IO_MAX_QUEUE_DEPTH) {
+        depth = IO_DEFAULT_QUEUE_DEPTH;
+    }
+    if (batch == 0 || batch > depth) {
+        batch = depth;
+    }
+
+    uring_t ring;
+    if (uring_open(&ring, depth) != 0) {
+        perror("io_uring_setup");
+        return -1;
+    }
+
+    // In scrittura due buffer in più delle richieste in volo: il produttore prepara i chunk
+    // successivi mentre quelli correnti sono in scrittura. In lettura la pipeline distribuisce
+    // solo buffer e offset.
+    unsigned int buffer_count = is_read ? depth : depth + IO_PIPELINE_LOOKAHEAD;
+    pattern_pipeline_t *pipeline = pipeline_create(is_read ? NULL : range->pass, range->start, range->length,
+                                                   range->chunk_size, range->alignment, buffer_count);
+    uring_slot_t *slots = calloc(depth, sizeof(uring_slot_t));
+    unsigned int *free_slots = calloc(depth, sizeof(unsigned int));
+    struct iovec *iovecs = calloc(buffer_count, sizeof(struct iovec));
+    int shared = pipeline && pipeline_shared(pipeline);
+    struct iovec *shared_iovecs = shared ? calloc((size_t)depth * IO_SHARED_IOVECS, sizeof(struct iovec)) : NULL;
+    if (!pipeline || !slots || !free_slots || !iovecs || (shared && !shared_iovecs)) {
+        perror("calloc");
+        pipeline_destroy(pipeline);
+        free(slots);
+        free(free_slots);
+        free(iovecs);
+        free(shared_iovecs);
+        uring_close(&ring);
+        return -1;
+    }
+
+    int result = 0;
+    unsigned int free_count = 0;
+
+    for (unsigned int i = 0; i < depth; i++) {
+        free_slots[free_count++] = i;
+        slots[i].iov = shared ? shared_iovecs + (size_t)i * IO_SHARED_IOVECS : NULL;
+    }
+    for (unsigned int i = 0; i < buffer_count; i++) {
+        iovecs[i].iov_base = pipeline_buffer(pipeline, i);
+        iovecs[i].iov_len = range->chunk_size;
+    }
+
+    if (sys_io_uring_register(ring.ring_fd, IORING_REGISTER_FILES, &range->fd, 1) < 0) {
+        perror("io_uring_register(FILES)");
+        result = -1;
+    }
+
+    // I buffer registrati evitano il pin delle pagine ad ogni richiesta; se il limite
+    // RLIMIT_MEMLOCK non lo consente si ripiega su IORING_OP_WRITE/READ normali. La pagina condivisa
+    // non si registra: è di sola lettura e il kernel fissa i buffer registrati in scrittura
+    int fixed_buffers = 0;
+    if (result == 0 && !shared) {
+        fixed_buffers = sys_io_uring_register(ring.ring_fd, IORING_REGISTER_BUFFERS, iovecs, buffer_count) == 0;
+        if (!fixed_buffers) {
+            log_message("io_uring: buffer registration failed (%s), using unregistered buffers",
+                        strerror(errno));
+        }
+    }
+
+    unsigned int inflight = 0;
+    int exhausted = 0;  // tutti i chunk dell'intervallo sono stati accodati
+    int incomplete = 0; // richieste parziali abbandonate per interruzione
+    size_t issued_end = range->start; // fine dell'ultimo chunk accodato
+    uint64_t last_completion = latency_now_ns(); // il tempo tra due completamenti va alla fascia del secondo
+
+    // Chunk acquisito ma trattenuto dal limite di banda fino a release_ns: nel frattempo si continuano
+    // a raccogliere i completamenti, altrimenti la latenza misurata includerebbe l'attesa
+    int held = 0;
+    unsigned int held_index = 0;
+    size_t held_offset = 0, held_length = 0;
+    uint64_t release_ns = 0;
+
+    while (result == 0 || inflight > 0) {
+        // Accodare nuove richieste finché ci sono slot liberi
+        while (result == 0 && !io_should_stop(range) && free_count > 0 && !exhausted) {
+            if (!held) {
+                int acquired = pipeline_acquire(pipeline, &held_index, &held_offset, &held_length);
+                if (acquired != 0) {
+                    exhausted = (acquired == 1);
+                    break;
+                }
+                held = 1;
+
+                uint64_t wait = range->throttle && !is_read ? throttle_reserve(range->throttle, held_length) : 0;
+                release_ns = wait > 0 ? latency_now_ns() + wait : 0;
+            }
+            if (release_ns > 0 && latency_now_ns() < release_ns) {
+                break;
+            }
+
+            unsigned int buffer_index = held_index;
+            size_t offset = held_offset, length = held_length;
+            held = 0;
+            release_ns = 0;
+
+            struct io_uring_sqe *sqe = uring_get_sqe(&ring);
+            if (!sqe) {
+                // Non dovrebbe accadere: la SQ ha almeno depth voci
+                pipeline_release(pipeline, buffer_index);
+                result = -1;
+                break;
+            }
+
+            unsigned int index = free_slots[--free_count];
+            uring_slot_t *slot = &slots[index];
+            slot->buffer = pipeline_buffer(pipeline, buffer_index);
+            slot->buffer_index = buffer_index;
+            slot->offset = offset;
+            slot->length = length;
+            slot->done = 0;
+            slot->active = 1;
+            issued_end = offset + length;
+
+            prep_rw(sqe, slot, index, fixed_buffers, is_read, range);
+            inflight++;
+
+            if (ring.pending >= batch && uring_submit(&ring, 0) != 0) {
+                perror("io_uring_enter");
+                result = -1;
+            }
+        }
+
+        uint64_t now = release_ns > 0 ? latency_now_ns() : 0;
+        int throttled = held && release_ns > now && result == 0 && !io_should_stop(range);
+
+        if (inflight == 0) {
+            if (!throttled) {
+                break;
+            }
+            io_throttle_sleep(range, release_ns - now);
+            continue;
+        }
+
+        // Sottomettere il resto del batch e attendere almeno un completamento; se un chunk attende
+        // il limite di banda l'attesa finisce comunque al suo turno (senza EXT_ARG si dorme e basta)
+        int waited;
+        if (throttled && free_count > 0 && ring.ext_arg) {
+            waited = uring_wait_timeout(&ring, release_ns - now);
+        } else if (throttled && free_count > 0) {
+            waited = uring_submit(&ring, 0);
+            io_throttle_sleep(range, release_ns - now);
+        } else {
+            waited = uring_submit(&ring, 1);
+        }
+        if (waited != 0) {
+            perror("io_uring_enter");
+            result = -1;
+            break;
+        }
+
+        // Raccogliere i completamenti, che possono arrivare in qualsiasi ordine
+        unsigned int head = *ring.cq_head;
+        unsigned int tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+
+        while (head != tail) {
+            struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+            unsigned int index = (unsigned int)cqe->user_data;
+            int res = cqe->res;
+            uring_slot_t *slot = &slots[index];
+            head++;
+
+            if (range->progress->stats || range->throttle) {
+                uint64_t completed = latency_now_ns();
+                if (range->progress->stats) {
+                    io_stats_record(range->progress->stats, slot->offset + slot->done, res > 0 ? (size_t)res : 0,
+                                    completed - slot->submitted, completed - last_completion);
+                }
+                if (range->throttle && res > 0) {
+                    throttle_complete(range->throttle, (size_t)res, completed - slot->submitted);
+                }
+                last_completion = completed;
+            }
+
+            if (res > 0) {
+                slot->done += (size_t)res;
+                progress_update(range->progress, (size_t)res);
+            }
+
+            // Settore difettoso: il resto del chunk si scrive in sincrono a pezzi, poi si riprende a chunk interi
+            int recovered = 1;
+            if (!is_read && res < 0 && range->config->skip_bad && io_media_error(-res) && result == 0) {
+                recovered = io_write_recover(range, shared ? slot->buffer : (const char *)slot->buffer + slot->done,
+                                             slot->offset + slot->done, slot->length - slot->done, shared);
+                if (recovered == 0) {
+                    slot->done = slot->length;
+                }
+            }
+
+            int requeue = 0;
+            if (recovered <= 0) {
+                // Chunk completato dal ripristino, oppure abbandonato (il messaggio è già stato dato)
+                incomplete |= recovered == -2;
+                if (recovered == -1) {
+                    result = -1;
+                }
+            } else if (res < 0 && res != -EINTR && res != -EAGAIN) {
+                if (result == 0) {
+                    errno = -res;
+                    perror(op_name);
+                    result = -1;
+                }
+            } else if (slot->done < slot->length) {
+                // Richiesta parziale o ritentabile: riaccodare il resto
+                if (res == 0) {
+                    fprintf(stderr, "%s: no progress at offset %zu\n", op_name, slot->offset + slot->done);
+                    result = -1;
+                } else {
+                    requeue = (result == 0 && !io_should_stop(range));
+                    incomplete |= !requeue;
+                }
+            } else if (is_read && result == 0 && consume(ctx, slot->offset, slot->buffer, slot->length) != 0) {
+                result = -1;
+            }
+
+            if (requeue) {
+                struct io_uring_sqe *sqe = uring_get_sqe(&ring);
+                if (sqe) {
+                    prep_rw(sqe, slot, index, fixed_buffers, is_read, range);
+                    continue;
+                }
+                result = -1;
+            }
+
+            inflight--;
+            slot->active = 0;
+            pipeline_release(pipeline, slot->buffer_index);
+            free_slots[free_count++] = index;
+        }
+
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+
+        // I chunk sono accodati in ordine di offset: il prefisso scritto (in lettura, già passato
+        // a consume) arriva fino alla richiesta in volo più bassa (o alla fine dell'ultimo chunk accodato)
+        if (range->written_mark && result == 0) {
+            size_t mark = issued_end;
+            for (unsigned int i = 0; i < depth; i++) {
+                if (slots[i].active && slots[i].offset + slots[i].done < mark) {
+                    mark = slots[i].offset + slots[i].done;
+                }
+            }
+            __atomic_store_n(range->written_mark, mark, __ATOMIC_RELEASE);
+        }
+
+        if (io_should_stop(range) && result == 0 && inflight == 0) {
+            break;
+        }
+    }
+
+    if (held) {
+        pipeline_release(pipeline, held_index);
+    }
+    if (result == 0 && (!exhausted || incomplete)) {
+        result = -2;
+    }
+
+    // Chiudere il ring prima di liberare i buffer che il kernel potrebbe ancora usare
+    uring_close(&ring);
+    pipeline_destroy(pipeline);
+    free(slots);
+    free(free_slots);
+    free(iovecs);
+    free(shared_iovecs);
+
+    return result;
+}
+
+int uring_write_range(const io_range_t *range) {
+    return uring_run(range, NULL, NULL);
+}
+
+int uring_read_range(const io_range_t *range, io_read_fn consume, void *ctx) {
+    return uring_run(range, consume, ctx);
+}
+
+// Sottomette gli extent a gruppi di IO_MAX_QUEUE_DEPTH e attende ogni gruppo; le scritture corte
+// si completano in sincrono. *done conta gli extent già scritti: il resto passa da pwrite().
+static int uring_write_extents(int fd, const io_extent_t *extents, unsigned int count, const void *buffer,
+                               progress_info_t *progress, unsigned int *done) {
+    uring_t ring;
+    unsigned int depth = count < IO_MAX_QUEUE_DEPTH ? count : IO_MAX_QUEUE_DEPTH;
+
+    if (uring_open(&ring, depth) != 0) {
+        log_message("io_uring: setup failed (%s), writing extents with pwrite()", strerror(errno));
+        return 0;
+    }
+
+    int result = 0;
+    while (*done < count && result == 0 && !interrupted) {
+        unsigned int group = count - *done < depth ? count - *done : depth;
+
+        for (unsigned int i = 0; i < group; i++) {
+            const io_extent_t *extent = &extents[*done + i];
+            struct io_uring_sqe *sqe = uring_get_sqe(&ring);
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = fd;
+            sqe->addr = (unsigned long)buffer;
+            sqe->len = (unsigned int)extent->length;
+            sqe->off = extent->offset;
+            sqe->user_data = *done + i;
+        }
+
+        unsigned int reaped = 0;
+        while (reaped < group) {
+            if (uring_submit(&ring, 1) != 0) {
+                perror("io_uring_enter");
+                uring_close(&ring);
+                return -1;
+            }
+
+            unsigned int head = *ring.cq_head;
+            unsigned int tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+            for (; head != tail; head++, reaped++) {
+                struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+                const io_extent_t *extent = &extents[cqe->user_data];
+                int res = cqe->res;
+
+                if (res < 0 && res != -EINTR && res != -EAGAIN) {
+                    if (result == 0) {
+                        errno = -res;
+                        perror("write");
+                        result = -1;
+                    }
+                    continue;
+                }
+
+                size_t written = res > 0 ? (size_t)res : 0;
+                if (written < extent->length && result == 0 &&
+                    io_pwrite_all(fd, (const char *)buffer + written, extent->length - written,
+                               extent->offset + written) != 0) {
+                    perror("write");
+                    result = -1;
+                    continue;
+                }
+                progress_update(progress, extent->length);
+            }
+            __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+        }
+
+        *done += group;
+    }
+
+    uring_close(&ring);
+    return result;
+}
+
+#else
+
+int io_uring_available(void) {
+    return 0;
+}
+
+int uring_write_range(const io_range_t *range) {
+    (void)range;
+    return -1;
+}
+
+int uring_read_range(const io_range_t *range, io_read_fn consume, void *ctx) {
+    (void)range;
+    (void)consume;
+    (void)ctx;
+    return -1;
+}
+
+#endif
+
+int io_write_extents(int fd, io_engine_t engine, const io_extent_t *extents, unsigned int count,
+                     const void *buffer, progress_info_t *progress) {
+    unsigned int done = 0;
+
+#ifdef __linux__
+    if (engine == IO_ENGINE_URING && io_uring_available()) {
+        int result = uring_write_extents(fd, extents, count, buffer, progress, &done);
+        if (result != 0) {
+            return result;
+        }
+    }
+#else
+    (void)engine;
+#endif
+
+    for (; done < count; done++) {
+        if (interrupted) {
+            return -2;
+        }
+        if (io_pwrite_all(fd, buffer, extents[done].length, extents[done].offset) != 0) {
+            perror("write");
+            return -1;
+        }
+        progress_update(progress, extents[done].length);
+    }
+
+    return interrupted ? -2 : 0;
+}
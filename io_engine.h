@@ -0,0 +1,119 @@
+#ifndef IO_ENGINE_H
+#define IO_ENGINE_H
+
+#include <signal.h>
+#include <stddef.h>
+#include "pattern.h"
+#include "progress.h"
+#include "throttle.h"
+
+#define IO_DEFAULT_QUEUE_DEPTH 16
+#define IO_DEFAULT_BATCH_SIZE 4
+#define IO_MAX_QUEUE_DEPTH 256
+#define IO_MAX_THREADS PROGRESS_MAX_THREADS
+#define IO_PIPELINE_LOOKAHEAD 2
+#define IO_DEFAULT_CHUNK_SIZE (1024 * 1024)
+#define IO_MIN_CHUNK_SIZE 4096
+#define IO_MAX_CHUNK_SIZE (64 * 1024 * 1024)
+#define IO_SHARED_IOVECS (IO_MAX_CHUNK_SIZE / PATTERN_SHARED_SIZE) // iovec per un chunk dalla pagina condivisa
+#define IO_BAD_BLOCK_RETRIES 3 // tentativi su un singolo blocco prima di aggiungerlo alla skip map
+
+// Parametri scelti automaticamente (piano dai limiti della coda, poi sonda di auto-tuning)
+#define IO_TUNE_CHUNK_SIZE 0x1
+#define IO_TUNE_QUEUE_DEPTH 0x2
+#define IO_TUNE_THREADS 0x4     // --threads non indicato: i device a zone usano ZONED_DEFAULT_WORKERS
+#define IO_TUNE_PROBED (IO_TUNE_CHUNK_SIZE | IO_TUNE_QUEUE_DEPTH) // parametri misurati dalla sonda
+
+// Motori di scrittura disponibili
+typedef enum {
+    IO_ENGINE_SYNC = 0,  // write() sincrona, una richiesta alla volta
+    IO_ENGINE_URING      // io_uring con buffer registrati e fixed file
+} io_engine_t;
+
+typedef struct {
+    io_engine_t engine;
+    unsigned int queue_depth; // richieste in volo contemporaneamente
+    unsigned int batch_size;  // SQE accumulate prima di ogni io_uring_enter()
+    int direct_io;            // O_DIRECT: bypass della page cache, un solo flush finale
+    unsigned int threads;     // worker che scrivono stripe indipendenti del device
+    size_t chunk_size;        // byte per richiesta di scrittura
+    size_t chunk_align;       // i chunk provati dalla sonda devono esserne multipli (optimal_io_size)
+    unsigned int tune;        // IO_TUNE_*: parametri non fissati dall'utente
+    int probe;                // misurare i parametri in tune sul device prima del wipe
+    int skip_bad;             // su errore del supporto bisecare il chunk e saltare i blocchi non scrivibili
+    int read_compare;         // leggere prima e scrivere solo i blocchi diversi dalla passata (rcw.h)
+    throttle_config_t throttle; // limiti di banda/IOPS/latenza e priorità di I/O delle scritture
+} io_config_t;
+
+// Intervallo del device da scrivere (o rileggere) con uno dei motori
+typedef struct {
+    int fd;
+    size_t start;
+    size_t length;
+    size_t chunk_size;
+    size_t alignment;              // allineamento dei buffer (blocco logico con O_DIRECT)
+    size_t block_size;             // blocco logico: granularità della bisezione con config->skip_bad
+    const pattern_pass_t *pass;    // contenuto da scrivere
+    const io_config_t *config;
+    progress_info_t *progress;
+    volatile sig_atomic_t *cancel; // annullamento condiviso dai worker dello stesso wipe (può essere NULL)
+    size_t *written_mark;          // fine del prefisso contiguo già scritto, per i checkpoint (può essere NULL)
+    throttle_t *throttle;          // limite condiviso dai worker dello stesso wipe (NULL = nessuno)
+    int read_fd;                   // con config->read_compare: descrittore per leggere il device
+} io_range_t;
+
+void io_config_default(io_config_t *config);
+int io_engine_from_name(const char *name, io_engine_t *engine);
+const char *io_engine_name(io_engine_t engine);
+int io_uring_available(void);
+
+// Vero se l'utente ha interrotto o un altro worker dello stesso wipe ha fallito
+int io_should_stop(const io_range_t *range);
+
+// Attende ns nanosecondi prenotati con throttle_reserve(), a fette per restare interrompibile
+void io_throttle_sleep(const io_range_t *range, uint64_t ns);
+
+// Errori del supporto (settore illeggibile o non riallocabile): il resto del device resta scrivibile
+int io_media_error(int err);
+
+// Scrittura completa di [offset, offset + length) con pwrite(); -1 con errno impostato
+int io_pwrite_all(int fd, const void *buffer, size_t length, size_t offset);
+// Come io_pwrite_all, ma con pwritev() che ripete la pagina condivisa di un pattern fisso (pattern_shared)
+int io_pwrite_shared(int fd, const void *page, size_t length, size_t offset);
+
+// Riscrive [offset, offset + length) da buffer dopo un errore del supporto: divide l'intervallo
+// a metà fino al blocco logico, ritenta ogni blocco IO_BAD_BLOCK_RETRIES volte e registra i blocchi
+// non scrivibili (log e range->progress->stats). I byte saltati contano come elaborati nel progress.
+// Con shared buffer è la pagina condivisa di un pattern fisso, ripetuta per tutto l'intervallo.
+// Ritorna 0 se l'intervallo è stato scritto o saltato, -1 su un errore diverso, -2 se interrotto.
+int io_write_recover(const io_range_t *range, const char *buffer, size_t offset, size_t length, int shared);
+
+// Scrive la passata range->pass nell'intervallo [start, start + length) con io_uring.
+// Con O_DIRECT start, length e chunk_size devono essere multipli del blocco logico
+// e alignment deve essere almeno pari alla dimensione del blocco.
+// Con config->skip_bad gli errori del supporto passano per io_write_recover(). I pattern fissi
+// si scrivono con IORING_OP_WRITEV dalla pagina condivisa, senza buffer per chunk.
+// Ritorna 0 se completato, -1 in caso di errore, -2 se interrotto.
+int uring_write_range(const io_range_t *range);
+
+// Riceve ogni chunk letto per intero, in ordine di completamento (non di offset).
+// Ritorna 0 per proseguire, -1 per interrompere la lettura con errore.
+typedef int (*io_read_fn)(void *ctx, size_t offset, const void *buffer, size_t length);
+
+// Legge [start, start + length) con io_uring mantenendo queue_depth letture in volo;
+// range->pass è ignorato. Stessi vincoli di allineamento e valori di ritorno di uring_write_range.
+int uring_read_range(const io_range_t *range, io_read_fn consume, void *ctx);
+
+// Intervallo di una scrittura sparsa
+typedef struct {
+    size_t offset;
+    size_t length;
+} io_extent_t;
+
+// Scrive buffer (lungo almeno quanto l'extent più grande) su tutti gli extent: con io_uring vengono
+// sottomessi insieme, a gruppi di IO_MAX_QUEUE_DEPTH, altrimenti uno alla volta con pwrite().
+// Ritorna 0 se completato, -1 in caso di errore, -2 se interrotto.
+int io_write_extents(int fd, io_engine_t engine, const io_extent_t *extents, unsigned int count,
+                     const void *buffer, progress_info_t *progress);
+
+#endif // IO_ENGINE_H
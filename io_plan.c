@@ -0,0 +1,139 @@
+#include "io_plan.h"
+#include "utils.h"
+#include <stdio.h>
+#include <string.h>
+
+static size_t gcd(size_t a, size_t b) {
+    while (b != 0) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static size_t round_up(size_t value, size_t step) {
+    return ((value + step - 1) / step) * step;
+}
+
+void io_plan_build(const char *disk_path, io_plan_t *plan) {
+    memset(plan, 0, sizeof(*plan));
+    plan->chunk_size = IO_DEFAULT_CHUNK_SIZE;
+    plan->chunk_align = IO_MIN_CHUNK_SIZE;
+    plan->queue_depth = IO_DEFAULT_QUEUE_DEPTH;
+    plan->device_class = "unknown";
+    plan->zoned = zoned_model(disk_path);
+    numa_plan(disk_path, &plan->numa);
+
+    if (sysfs_queue_limits(disk_path, &plan->limits) != 0) {
+        return;
+    }
+
+    const queue_limits_t *limits = &plan->limits;
+    int rotational = limits->rotational != 0;
+    plan->device_class = rotational ? "HDD" : "SSD";
+
+    // I chunk restano multipli della dimensione ottimale (stripe dei RAID, unità di scrittura
+    // degli SSD) o almeno del blocco fisico, così nessuna scrittura richiede read-modify-write
+    size_t align = limits->optimal_io_size > 0 ? limits->optimal_io_size : limits->physical_block_size;
+    if (align < IO_MIN_CHUNK_SIZE) {
+        align = IO_MIN_CHUNK_SIZE;
+    }
+    if (align % limits->logical_block_size != 0 || align > IO_MAX_CHUNK_SIZE) {
+        align = IO_MIN_CHUNK_SIZE;
+    }
+    plan->chunk_align = align;
+
+    // Il kernel divide le richieste oltre max_sectors_kb: un chunk multiplo evita un frammento finale
+    plan->max_request = (size_t)limits->max_sectors_kb * 1024;
+    size_t step = align;
+    if (plan->max_request > 0) {
+        size_t lcm = step / gcd(step, plan->max_request) * plan->max_request;
+        if (lcm <= IO_MAX_CHUNK_SIZE) {
+            step = lcm;
+        }
+    }
+
+    size_t chunk = round_up(rotational ? IO_PLAN_HDD_CHUNK : IO_PLAN_SSD_CHUNK, step);
+    if (chunk > IO_MAX_CHUNK_SIZE) {
+        chunk = step <= IO_MAX_CHUNK_SIZE ? step : IO_MAX_CHUNK_SIZE;
+    }
+    plan->chunk_size = chunk;
+
+    // Coda: pochi comandi per un HDD (scrittura sequenziale), di più per gli SSD,
+    // senza superare la coda del block layer né la memoria dei buffer
+    unsigned int depth = rotational ? IO_PLAN_HDD_DEPTH : IO_PLAN_SSD_DEPTH;
+    if (limits->nr_requests > 0 && depth > limits->nr_requests) {
+        depth = (unsigned int)limits->nr_requests;
+    }
+    while (depth > 1 && (size_t)depth * chunk > IO_PLAN_MAX_BUFFERS) {
+        depth /= 2;
+    }
+    plan->queue_depth = depth > 0 ? depth : 1;
+}
+
+void io_plan_apply(const io_plan_t *plan, io_config_t *config) {
+    config->chunk_align = plan->chunk_align;
+
+    if (config->tune & IO_TUNE_CHUNK_SIZE) {
+        config->chunk_size = plan->chunk_size;
+    }
+    if (config->tune & IO_TUNE_QUEUE_DEPTH) {
+        config->queue_depth = plan->queue_depth;
+    }
+
+    // Il batch non può superare le richieste in volo
+    if (config->batch_size > config->queue_depth) {
+        config->batch_size = config->queue_depth;
+    }
+}
+
+void io_plan_print(const io_plan_t *plan, const io_config_t *config, const char *indent) {
+    const queue_limits_t *limits = &plan->limits;
+    char chunk_str[64];
+
+    format_bytes(config->chunk_size, chunk_str, sizeof(chunk_str));
+
+    printf("%sI/O plan: %s device, chunk %s", indent, plan->device_class, chunk_str);
+    if (config->engine == IO_ENGINE_URING) {
+        printf(", queue depth %u", config->queue_depth);
+    }
+    if (config->probe && (config->tune & IO_TUNE_PROBED) != 0) {
+        printf(" (the startup probe may refine it)");
+    }
+    printf("\n");
+
+    if (plan->zoned != ZONED_NONE) {
+        printf("%s  Zoned device (%s): zones are reset, then written sequentially by parallel sync writers\n",
+               indent, zoned_model_name(plan->zoned));
+    }
+
+    char placement[256];
+    printf("%s  Placement: %s\n", indent, numa_describe(&plan->numa, placement, sizeof(placement)));
+
+    if (!limits->valid) {
+        printf("%s  Queue limits not available, using defaults\n", indent);
+        return;
+    }
+
+    char optimal_str[64], request_str[64];
+    format_bytes(limits->optimal_io_size, optimal_str, sizeof(optimal_str));
+    format_bytes(plan->max_request, request_str, sizeof(request_str));
+    printf("%s  Blocks %llu/%llu (logical/physical), optimal I/O %s, max request %s (hw %llu KB), "
+           "nr_requests %llu\n", indent, limits->logical_block_size, limits->physical_block_size,
+           limits->optimal_io_size > 0 ? optimal_str : "not reported", request_str, limits->max_hw_sectors_kb,
+           limits->nr_requests);
+}
+
+void io_plan_log(const io_plan_t *plan, const io_config_t *config, const char *disk_path) {
+    const queue_limits_t *limits = &plan->limits;
+
+    log_message("I/O plan for %s: %s, chunk %zu bytes (align %zu), queue depth %u - logical %llu, physical %llu, "
+                "optimal_io_size %llu, max_sectors_kb %llu, max_hw_sectors_kb %llu, rotational %llu, nr_requests %llu",
+                disk_path, plan->device_class, config->chunk_size, plan->chunk_align, config->queue_depth,
+                limits->logical_block_size, limits->physical_block_size, limits->optimal_io_size,
+                limits->max_sectors_kb, limits->max_hw_sectors_kb, limits->rotational, limits->nr_requests);
+
+    char placement[256];
+    log_message("Placement for %s: %s", disk_path, numa_describe(&plan->numa, placement, sizeof(placement)));
+}
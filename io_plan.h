@@ -0,0 +1,36 @@
+#ifndef IO_PLAN_H
+#define IO_PLAN_H
+
+#include <stddef.h>
+#include "io_engine.h"
+#include "numa.h"
+#include "sysfs.h"
+#include "zoned.h"
+
+#define IO_PLAN_HDD_CHUNK (1024 * 1024)      // HDD: scrittura sequenziale, richieste medie bastano
+#define IO_PLAN_SSD_CHUNK (2 * 1024 * 1024)  // SSD/NVMe: più byte per richiesta per i canali paralleli
+#define IO_PLAN_HDD_DEPTH 4
+#define IO_PLAN_SSD_DEPTH 32
+#define IO_PLAN_MAX_BUFFERS (64 * 1024 * 1024) // chunk * queue depth massimi per device
+
+// Piano di I/O di un device ricavato dai limiti della sua coda
+typedef struct {
+    queue_limits_t limits;
+    size_t chunk_size;
+    size_t chunk_align;        // optimal_io_size, o il blocco fisico se non dichiarato
+    size_t max_request;        // max_sectors_kb in byte: i chunk ne sono multipli per non lasciare code spezzate
+    unsigned int queue_depth;
+    const char *device_class;  // "HDD", "SSD" o "unknown"
+    zoned_model_t zoned;       // device a zone: reset e scrittura sequenziale zona per zona
+    numa_placement_t numa;     // CPU e memoria del nodo del controller per writer e buffer
+} io_plan_t;
+
+// Calcola chunk e queue depth per il device (senza limiti leggibili restano i default)
+void io_plan_build(const char *disk_path, io_plan_t *plan);
+// Applica il piano ai parametri non fissati dall'utente (config->tune)
+void io_plan_apply(const io_plan_t *plan, io_config_t *config);
+// Righe del piano per la conferma: valori scelti e limiti da cui derivano
+void io_plan_print(const io_plan_t *plan, const io_config_t *config, const char *indent);
+void io_plan_log(const io_plan_t *plan, const io_config_t *config, const char *disk_path);
+
+#endif // IO_PLAN_H
@@ -0,0 +1,236 @@
+#include "io_stats.h"
+#include "utils.h"
+#include <stdio.h>
+#include <string.h>
+
+void io_stats_init(io_stats_t *stats, size_t disk_size, uint64_t stall_threshold_ns) {
+    memset(stats, 0, sizeof(*stats));
+    latency_init(&stats->latency);
+    stats->disk_size = disk_size;
+    stats->region_size = (disk_size + IO_STATS_REGIONS - 1) / IO_STATS_REGIONS;
+    if (stats->region_size == 0) {
+        stats->region_size = 1;
+    }
+    stats->stall_threshold_ns = stall_threshold_ns;
+}
+
+void io_stats_record(io_stats_t *stats, size_t offset, size_t length, uint64_t latency_ns, uint64_t busy_ns) {
+    latency_record(&stats->latency, latency_ns);
+
+    size_t region = offset / stats->region_size;
+    if (region >= IO_STATS_REGIONS) {
+        region = IO_STATS_REGIONS - 1;
+    }
+    __atomic_add_fetch(&stats->region_bytes[region], length, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats->region_ns[region], busy_ns, __ATOMIC_RELAXED);
+
+    // Evento raro: il log si scrive direttamente dal writer
+    if (stats->stall_threshold_ns > 0 && latency_ns >= stats->stall_threshold_ns) {
+        uint64_t index = __atomic_fetch_add(&stats->stall_count, 1, __ATOMIC_RELAXED);
+        if (index < IO_STATS_MAX_STALLS) {
+            stats->stalls[index].offset = offset;
+            stats->stalls[index].length = length;
+            stats->stalls[index].ns = latency_ns;
+        }
+        log_message("I/O stall: %zu bytes at offset %zu took %.3f s", length, offset, (double)latency_ns / 1e9);
+    }
+}
+
+void io_stats_bad_range(io_stats_t *stats, size_t offset, size_t length) {
+    uint64_t index = __atomic_fetch_add(&stats->bad_count, 1, __ATOMIC_RELAXED);
+    if (index < IO_STATS_MAX_BAD_RANGES) {
+        stats->bad_ranges[index].offset = offset;
+        stats->bad_ranges[index].length = length;
+    }
+    __atomic_add_fetch(&stats->bad_bytes, length, __ATOMIC_RELAXED);
+}
+
+void io_stats_compare(io_stats_t *stats, size_t read_bytes, size_t written_bytes, uint64_t writes,
+                      uint64_t write_ns) {
+    __atomic_add_fetch(&stats->compare_read_bytes, read_bytes, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats->compare_written_bytes, written_bytes, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats->compare_writes, writes, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats->compare_write_ns, write_ns, __ATOMIC_RELAXED);
+}
+
+void io_stats_compare_finish(io_stats_t *stats, double seconds, unsigned int workers) {
+    double write_bps = 0.0;
+
+    // Il tempo di scrittura è la somma dei writer: diviso per i writer diventa tempo reale
+    if (stats->compare_written_bytes >= IO_STATS_MIN_WRITE_SAMPLE && stats->compare_write_ns > 0) {
+        write_bps = (double)stats->compare_written_bytes /
+                    ((double)stats->compare_write_ns / 1e9 / (double)(workers > 0 ? workers : 1));
+        stats->compare_assumed = 0;
+    } else if (seconds > 0) {
+        write_bps = (double)stats->compare_read_bytes / seconds;
+        stats->compare_assumed = 1;
+    }
+
+    stats->compare_seconds = seconds;
+    stats->compare_blind_seconds = write_bps > 0 ? (double)stats->compare_read_bytes / write_bps : 0.0;
+}
+
+static char *format_compare(const io_stats_t *stats, char *buffer, size_t buffer_size) {
+    char read_str[32], written_str[32], saved_str[32];
+    double saved = stats->compare_blind_seconds - stats->compare_seconds;
+
+    format_bytes(stats->compare_read_bytes, read_str, sizeof(read_str));
+    format_bytes(stats->compare_written_bytes, written_str, sizeof(written_str));
+    format_time((time_t)(saved > 0 ? saved : -saved), saved_str, sizeof(saved_str));
+    snprintf(buffer, buffer_size, "read %s, rewrote %s in %llu write(s), %s %s", read_str, written_str,
+             (unsigned long long)stats->compare_writes, saved_str, saved >= 0 ? "saved" : "lost");
+    return buffer;
+}
+
+static char *format_latency(uint64_t ns, char *buffer, size_t buffer_size) {
+    if (ns >= 1000000000ULL) {
+        snprintf(buffer, buffer_size, "%.2f s", (double)ns / 1e9);
+    } else if (ns >= 1000000ULL) {
+        snprintf(buffer, buffer_size, "%.2f ms", (double)ns / 1e6);
+    } else {
+        snprintf(buffer, buffer_size, "%.1f us", (double)ns / 1e3);
+    }
+    return buffer;
+}
+
+static double region_speed(const io_stats_t *stats, int region) {
+    if (stats->region_ns[region] == 0) {
+        return 0.0;
+    }
+    return (double)stats->region_bytes[region] / ((double)stats->region_ns[region] / 1e9) / (1024.0 * 1024.0);
+}
+
+char *io_stats_summary(const io_stats_t *stats, char *buffer, size_t buffer_size) {
+    char p50_str[32], p99_str[32], max_str[32];
+
+    format_latency(latency_percentile(&stats->latency, 50.0), p50_str, sizeof(p50_str));
+    format_latency(latency_percentile(&stats->latency, 99.0), p99_str, sizeof(p99_str));
+    format_latency(stats->latency.max_ns, max_str, sizeof(max_str));
+    int len = snprintf(buffer, buffer_size, "latency p50 %s, p99 %s, max %s, %llu stall(s)", p50_str, p99_str,
+                       max_str, (unsigned long long)stats->stall_count);
+    if (stats->bad_bytes > 0 && len > 0 && (size_t)len < buffer_size) {
+        char bad_str[32];
+        format_bytes(stats->bad_bytes, bad_str, sizeof(bad_str));
+        len += snprintf(buffer + len, buffer_size - (size_t)len, ", %s unwritable", bad_str);
+    }
+    if (stats->compare_read_bytes > 0 && len > 0 && (size_t)len < buffer_size) {
+        char compare_str[160];
+        snprintf(buffer + len, buffer_size - (size_t)len, "; %s",
+                 format_compare(stats, compare_str, sizeof(compare_str)));
+    }
+    return buffer;
+}
+
+void io_stats_print(const io_stats_t *stats) {
+    const double percentiles[] = {50.0, 90.0, 99.0, 99.9};
+    char value_str[32];
+
+    // Il confronto è utile anche se le letture non sono state misurate (motore sync)
+    if (stats->compare_read_bytes > 0) {
+        char read_str[32], written_str[32], blind_str[32], took_str[32];
+        double skipped = 100.0 - (double)stats->compare_written_bytes * 100.0 / (double)stats->compare_read_bytes;
+
+        format_bytes(stats->compare_read_bytes, read_str, sizeof(read_str));
+        format_bytes(stats->compare_written_bytes, written_str, sizeof(written_str));
+        format_time((time_t)stats->compare_blind_seconds, blind_str, sizeof(blind_str));
+        format_time((time_t)stats->compare_seconds, took_str, sizeof(took_str));
+        printf("\nRead-compare-write: read %s, rewrote %s in %llu write(s) (%.1f%% already matching)\n",
+               read_str, written_str, (unsigned long long)stats->compare_writes, skipped);
+        printf("Blind overwrite estimate: %s%s, this wipe took %s\n", blind_str,
+               stats->compare_assumed ? " (write speed assumed equal to read speed)" : "", took_str);
+    }
+
+    if (stats->latency.total == 0) {
+        return;
+    }
+
+    printf("\nI/O latency (%llu requests):", (unsigned long long)stats->latency.total);
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+        printf(" p%g %s |", percentiles[i],
+               format_latency(latency_percentile(&stats->latency, percentiles[i]), value_str, sizeof(value_str)));
+    }
+    printf(" max %s\n", format_latency(stats->latency.max_ns, value_str, sizeof(value_str)));
+
+    if (stats->stall_count > 0) {
+        printf("Stalls over %s: %llu\n", format_latency(stats->stall_threshold_ns, value_str, sizeof(value_str)),
+               (unsigned long long)stats->stall_count);
+        uint64_t shown = stats->stall_count < IO_STATS_MAX_STALLS ? stats->stall_count : IO_STATS_MAX_STALLS;
+        for (uint64_t i = 0; i < shown; i++) {
+            char offset_str[64];
+            format_bytes(stats->stalls[i].offset, offset_str, sizeof(offset_str));
+            printf("  at %s (offset %zu): %s\n", offset_str, stats->stalls[i].offset,
+                   format_latency(stats->stalls[i].ns, value_str, sizeof(value_str)));
+        }
+        if (stats->stall_count > shown) {
+            printf("  ... see the log for the remaining %llu\n", (unsigned long long)(stats->stall_count - shown));
+        }
+    }
+
+    // Skip map: quello che resta leggibile su questi settori non è stato cancellato
+    if (stats->bad_count > 0) {
+        char bad_str[64];
+        format_bytes(stats->bad_bytes, bad_str, sizeof(bad_str));
+        printf("WARNING: %s (%llu bytes) could not be erased in %llu unwritable range(s):\n", bad_str,
+               (unsigned long long)stats->bad_bytes, (unsigned long long)stats->bad_count);
+        uint64_t shown = stats->bad_count < IO_STATS_MAX_BAD_RANGES ? stats->bad_count : IO_STATS_MAX_BAD_RANGES;
+        for (uint64_t i = 0; i < shown; i++) {
+            printf("  offset %zu, %zu bytes\n", stats->bad_ranges[i].offset, stats->bad_ranges[i].length);
+        }
+        if (stats->bad_count > shown) {
+            printf("  ... see the log for the remaining %llu\n", (unsigned long long)(stats->bad_count - shown));
+        }
+    }
+
+    // Velocità lungo il device: un calo regolare verso la fine è normale sugli HDD,
+    // una singola fascia lenta indica una zona con riallocazioni
+    printf("Throughput by LBA region:\n");
+    for (int i = 0; i < IO_STATS_REGIONS; i++) {
+        if (stats->region_bytes[i] == 0) {
+            continue;
+        }
+        char start_str[64], end_str[64];
+        size_t start = (size_t)i * stats->region_size;
+        size_t end = start + stats->region_size < stats->disk_size ? start + stats->region_size : stats->disk_size;
+        format_bytes(start, start_str, sizeof(start_str));
+        format_bytes(end, end_str, sizeof(end_str));
+        printf("  %10s - %-10s %10.2f MB/s\n", start_str, end_str, region_speed(stats, i));
+    }
+}
+
+void io_stats_log(const io_stats_t *stats, const char *disk_path) {
+    if (stats->compare_read_bytes > 0) {
+        log_message("Read-compare-write on %s: %llu bytes read, %llu bytes rewritten in %llu writes, "
+                    "%.1f s elapsed, blind overwrite estimated at %.1f s%s", disk_path,
+                    (unsigned long long)stats->compare_read_bytes, (unsigned long long)stats->compare_written_bytes,
+                    (unsigned long long)stats->compare_writes, stats->compare_seconds, stats->compare_blind_seconds,
+                    stats->compare_assumed ? " (write speed assumed equal to read speed)" : "");
+    }
+    if (stats->latency.total == 0) {
+        return;
+    }
+
+    log_message("I/O latency of %s: %llu requests, p50 %llu us, p90 %llu us, p99 %llu us, p99.9 %llu us, "
+                "max %llu us, mean %llu us; stalls over %llu ms: %llu", disk_path,
+                (unsigned long long)stats->latency.total,
+                (unsigned long long)(latency_percentile(&stats->latency, 50.0) / 1000),
+                (unsigned long long)(latency_percentile(&stats->latency, 90.0) / 1000),
+                (unsigned long long)(latency_percentile(&stats->latency, 99.0) / 1000),
+                (unsigned long long)(latency_percentile(&stats->latency, 99.9) / 1000),
+                (unsigned long long)(stats->latency.max_ns / 1000),
+                (unsigned long long)(stats->latency.sum_ns / stats->latency.total / 1000),
+                (unsigned long long)(stats->stall_threshold_ns / 1000000), (unsigned long long)stats->stall_count);
+    if (stats->bad_count > 0) {
+        log_message("Unwritable ranges of %s: %llu, %llu bytes not erased", disk_path,
+                    (unsigned long long)stats->bad_count, (unsigned long long)stats->bad_bytes);
+    }
+
+    for (int i = 0; i < IO_STATS_REGIONS; i++) {
+        if (stats->region_bytes[i] > 0) {
+            size_t start = (size_t)i * stats->region_size;
+            size_t end = start + stats->region_size < stats->disk_size ? start + stats->region_size
+                                                                       : stats->disk_size;
+            log_message("Throughput of %s in region %d [%zu, %zu): %.2f MB/s", disk_path, i, start, end,
+                        region_speed(stats, i));
+        }
+    }
+}
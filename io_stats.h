@@ -0,0 +1,65 @@
+#ifndef IO_STATS_H
+#define IO_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "latency.h"
+
+#define IO_STATS_REGIONS 16                          // fasce LBA per la velocità lungo il device
+#define IO_STATS_STALL_NS (2000ULL * 1000 * 1000)    // oltre 2 s una richiesta è uno stallo
+#define IO_STATS_MAX_STALLS 16                       // stalli conservati per il report (tutti nel log)
+#define IO_STATS_MAX_BAD_RANGES 64                   // range non scrivibili conservati per il report (tutti nel log)
+#define IO_STATS_MIN_WRITE_SAMPLE (64ULL * 1024 * 1024) // scritture minime per stimare la velocità in read-compare-write
+
+typedef struct {
+    size_t offset;
+    size_t length;
+    uint64_t ns;
+} io_stall_t;
+
+typedef struct {
+    size_t offset;
+    size_t length;
+} io_bad_range_t;
+
+// Misure per richiesta di un wipe: distingue un device uniformemente lento da uno con
+// stalli di secondi (riallocazioni, garbage collection). Memoria fissa, aggiornamenti atomici.
+typedef struct {
+    latency_hist_t latency;
+    size_t disk_size;
+    size_t region_size;
+    uint64_t region_bytes[IO_STATS_REGIONS];
+    uint64_t region_ns[IO_STATS_REGIONS]; // tempo dei writer attribuito alla fascia
+    uint64_t stall_threshold_ns;
+    uint64_t stall_count;
+    io_stall_t stalls[IO_STATS_MAX_STALLS];
+    uint64_t bad_count;                   // range saltati dalla scrittura tollerante (skip map)
+    uint64_t bad_bytes;                   // byte che non è stato possibile cancellare
+    io_bad_range_t bad_ranges[IO_STATS_MAX_BAD_RANGES];
+    uint64_t compare_read_bytes;          // read-compare-write: byte letti e confrontati con la passata
+    uint64_t compare_written_bytes;       // byte diversi dalla passata e quindi riscritti
+    uint64_t compare_writes;              // scritture emesse dopo la fusione dei blocchi vicini
+    uint64_t compare_write_ns;            // tempo dei writer nelle scritture, per la velocità di scrittura
+    double compare_seconds;               // durata delle passate
+    double compare_blind_seconds;         // stima della stessa cancellazione con sovrascrittura completa
+    int compare_assumed;                  // troppe poche scritture: velocità di scrittura presunta pari alla lettura
+} io_stats_t;
+
+void io_stats_init(io_stats_t *stats, size_t disk_size, uint64_t stall_threshold_ns);
+// Una richiesta completata: latency_ns dalla sottomissione, busy_ns dal completamento precedente
+// dello stesso writer (così il tempo di ogni writer è ripartito tra le fasce che ha scritto)
+void io_stats_record(io_stats_t *stats, size_t offset, size_t length, uint64_t latency_ns, uint64_t busy_ns);
+// Range non scrivibile saltato dopo la bisezione (già registrato nel log dal motore)
+void io_stats_bad_range(io_stats_t *stats, size_t offset, size_t length);
+// Un intervallo completato in read-compare-write (aggiornamenti atomici, un'unica chiamata per writer)
+void io_stats_compare(io_stats_t *stats, size_t read_bytes, size_t written_bytes, uint64_t writes,
+                      uint64_t write_ns);
+// Fine delle passate in read-compare-write: seconds è la durata complessiva, workers i writer paralleli.
+// Stima il tempo di una sovrascrittura completa dalla velocità delle scritture effettuate.
+void io_stats_compare_finish(io_stats_t *stats, double seconds, unsigned int workers);
+// Riga compatta (p50, p99, max, stalli, byte non scrivibili) per la tabella del batch
+char *io_stats_summary(const io_stats_t *stats, char *buffer, size_t buffer_size);
+void io_stats_print(const io_stats_t *stats);
+void io_stats_log(const io_stats_t *stats, const char *disk_path);
+
+#endif // IO_STATS_H
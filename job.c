@@ -0,0 +1,478 @@
+#define _GNU_SOURCE
+
+#include "job.h"
+#include "inventory.h"
+#include "sysfs.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <unistd.h>
+
+// Stato della sezione in lettura: i controlli incrociati si fanno a sezione chiusa
+typedef struct {
+    wipe_options_t *options;
+    int scheme_given;
+    int line;
+} job_section_t;
+
+static char *trim(char *text) {
+    while (isspace((unsigned char)*text)) {
+        text++;
+    }
+    size_t len = strlen(text);
+    while (len > 0 && isspace((unsigned char)text[len - 1])) {
+        text[--len] = '\0';
+    }
+    return text;
+}
+
+static int parse_bool(const char *text, int *value) {
+    if (strcasecmp(text, "yes") == 0 || strcasecmp(text, "true") == 0 || strcmp(text, "1") == 0) {
+        *value = 1;
+        return 0;
+    }
+    if (strcasecmp(text, "no") == 0 || strcasecmp(text, "false") == 0 || strcmp(text, "0") == 0) {
+        *value = 0;
+        return 0;
+    }
+    return -1;
+}
+
+// Stesse regole di parse_options() per le opzioni di un wipe; ritorna 1 se la chiave non è un'opzione
+static int parse_option(job_section_t *section, const char *key, const char *value) {
+    wipe_options_t *options = section->options;
+    io_config_t *io = &options->io;
+
+    if (strcmp(key, "engine") == 0) {
+        return io_engine_from_name(value, &io->engine) == 0 ? 0 : -1;
+    } else if (strcmp(key, "queue_depth") == 0) {
+        io->tune &= ~IO_TUNE_QUEUE_DEPTH;
+        return parse_uint(value, 1, IO_MAX_QUEUE_DEPTH, &io->queue_depth);
+    } else if (strcmp(key, "batch") == 0) {
+        return parse_uint(value, 1, IO_MAX_QUEUE_DEPTH, &io->batch_size);
+    } else if (strcmp(key, "threads") == 0) {
+        io->tune &= ~IO_TUNE_THREADS;
+        return parse_uint(value, 1, IO_MAX_THREADS, &io->threads);
+    } else if (strcmp(key, "chunk_size") == 0) {
+        io->tune &= ~IO_TUNE_CHUNK_SIZE;
+        return parse_size(value, IO_MIN_CHUNK_SIZE, IO_MAX_CHUNK_SIZE, &io->chunk_size) == 0 &&
+               io->chunk_size % IO_MIN_CHUNK_SIZE == 0 ? 0 : -1;
+    } else if (strcmp(key, "tune") == 0) {
+        return parse_bool(value, &io->probe);
+    } else if (strcmp(key, "direct") == 0) {
+        return parse_bool(value, &io->direct_io);
+    } else if (strcmp(key, "skip_bad_blocks") == 0) {
+        return parse_bool(value, &io->skip_bad);
+    } else if (strcmp(key, "read_compare") == 0) {
+        return parse_bool(value, &io->read_compare);
+    } else if (strcmp(key, "limit_rate") == 0) {
+        size_t rate;
+        if (parse_size(value, 0, THROTTLE_MAX_BPS, &rate) != 0) {
+            return -1;
+        }
+        io->throttle.rate_bps = rate;
+        return 0;
+    } else if (strcmp(key, "limit_iops") == 0) {
+        unsigned int iops;
+        if (parse_uint(value, 0, 10000000, &iops) != 0) {
+            return -1;
+        }
+        io->throttle.iops = iops;
+        return 0;
+    } else if (strcmp(key, "latency_target") == 0) {
+        unsigned int target_ms;
+        if (parse_uint(value, 0, 60000, &target_ms) != 0) {
+            return -1;
+        }
+        io->throttle.latency_target_ns = (uint64_t)target_ms * 1000000;
+        return 0;
+    } else if (strcmp(key, "ioprio") == 0) {
+        return throttle_parse_priority(value, &io->throttle.ioprio);
+    } else if (strcmp(key, "method") == 0) {
+        return wipe_method_from_name(value, &options->method);
+    } else if (strcmp(key, "scheme") == 0) {
+        section->scheme_given = 1;
+        return scheme_from_name(value, &options->scheme);
+    } else if (strcmp(key, "seed") == 0) {
+        char *end;
+        options->seed = strtoull(value, &end, 0);
+        return *value != '\0' && *end == '\0' && options->seed != 0 ? 0 : -1;
+    } else if (strcmp(key, "verify") == 0) {
+        return verify_mode_from_name(value, &options->verify.mode);
+    } else if (strcmp(key, "samples") == 0) {
+        return verify_parse_samples(value, &options->verify);
+    } else if (strcmp(key, "resume") == 0) {
+        return parse_bool(value, &options->resume);
+    } else if (strcmp(key, "checkpoint_interval") == 0) {
+        return parse_uint(value, 0, 86400, &options->checkpoint_interval);
+    }
+    return 1;
+}
+
+// Come parse_options(): i metodi offload usano un'unica passata di zeri
+static int finish_section(const job_t *job, const job_section_t *section) {
+    wipe_options_t *options = section->options;
+
+    if (options->method != WIPE_METHOD_OVERWRITE) {
+        if (section->scheme_given) {
+            fprintf(stderr, "ERROR: %s:%d: scheme cannot be combined with method = %s\n", job->file, section->line,
+                    wipe_method_name(options->method));
+            return -1;
+        }
+        scheme_from_name("zero", &options->scheme);
+    }
+    if (options->method == WIPE_METHOD_QUICK && options->verify.mode != VERIFY_NONE) {
+        fprintf(stderr, "ERROR: %s:%d: verify cannot be combined with method = quick\n", job->file, section->line);
+        return -1;
+    }
+    if (options->method == WIPE_METHOD_QUICK && options->io.read_compare) {
+        fprintf(stderr, "ERROR: %s:%d: read_compare cannot be combined with method = quick\n", job->file,
+                section->line);
+        return -1;
+    }
+    if (options->certificate_dir) {
+        if (options->method == WIPE_METHOD_QUICK || options->verify.mode == VERIFY_SAMPLE) {
+            fprintf(stderr, "ERROR: %s:%d: certificate_dir needs verify = full (not sample or method = quick)\n",
+                    job->file, section->line);
+            return -1;
+        }
+        options->verify.mode = VERIFY_FULL;
+    }
+    scheme_set_seed(&options->scheme, options->seed);
+
+    if (options->io.batch_size > options->io.queue_depth) {
+        options->io.batch_size = options->io.queue_depth;
+    }
+    return 0;
+}
+
+static int finish_device(const job_t *job, const job_section_t *section) {
+    const job_device_t *device = &job->devices[job->count - 1];
+
+    if (device->serial[0] == '\0' && device->wwn[0] == '\0' && device->path[0] == '\0') {
+        fprintf(stderr, "ERROR: %s:%d: device needs serial, wwn or path\n", job->file, section->line);
+        return -1;
+    }
+    return finish_section(job, section);
+}
+
+int job_load(const char *path, const wipe_options_t *defaults, job_t *job) {
+    memset(job, 0, sizeof(*job));
+    snprintf(job->file, sizeof(job->file), "%s", path);
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        perror("fopen(job)");
+        return -1;
+    }
+
+    job->devices = calloc(JOB_MAX_DEVICES, sizeof(job_device_t));
+    if (!job->devices) {
+        perror("calloc");
+        fclose(fp);
+        return -1;
+    }
+
+    wipe_options_t globals = *defaults;
+    job_section_t section = {&globals, 0, 0};
+    int global_scheme = 0;
+    int in_device = 0;
+    int line_number = 0;
+    int valid = 1;
+    char line[512];
+
+    while (valid && fgets(line, sizeof(line), fp)) {
+        line_number++;
+        line[strcspn(line, "#\n")] = '\0';
+
+        char *key = trim(line);
+        if (*key == '\0') {
+            continue;
+        }
+
+        if (strcmp(key, "[device]") == 0) {
+            if (!in_device) {
+                valid = finish_section(job, &section) == 0;
+                global_scheme = section.scheme_given;
+            } else {
+                valid = finish_device(job, &section) == 0;
+            }
+            if (valid && job->count >= JOB_MAX_DEVICES) {
+                fprintf(stderr, "ERROR: %s:%d: more than %d devices\n", path, line_number, JOB_MAX_DEVICES);
+                valid = 0;
+            }
+            if (valid) {
+                // Ogni device parte dalle opzioni globali già lette
+                job_device_t *device = &job->devices[job->count++];
+                device->options = globals;
+                device->line = line_number;
+                section.options = &device->options;
+                section.scheme_given = global_scheme;
+                section.line = line_number;
+                in_device = 1;
+            }
+            continue;
+        }
+
+        char *value = strchr(key, '=');
+        if (!value) {
+            fprintf(stderr, "ERROR: %s:%d: expected key = value\n", path, line_number);
+            valid = 0;
+            continue;
+        }
+        *value++ = '\0';
+        key = trim(key);
+        value = trim(value);
+
+        job_device_t *device = in_device ? &job->devices[job->count - 1] : NULL;
+        int parsed = parse_option(&section, key, value);
+
+        if (parsed == 1 && device && strcmp(key, "serial") == 0) {
+            snprintf(device->serial, sizeof(device->serial), "%s", value);
+            parsed = 0;
+        } else if (parsed == 1 && device && strcmp(key, "wwn") == 0) {
+            snprintf(device->wwn, sizeof(device->wwn), "%s", value);
+            parsed = 0;
+        } else if (parsed == 1 && device && strcmp(key, "path") == 0) {
+            snprintf(device->path, sizeof(device->path), "%s%s", strncmp(value, "/dev/", 5) == 0 ? "" : "/dev/",
+                     value);
+            parsed = 0;
+        } else if (parsed == 1 && !device && strcmp(key, "confirm") == 0) {
+            snprintf(job->confirm, sizeof(job->confirm), "%s", value);
+            parsed = 0;
+        } else if (parsed == 1 && !device && strcmp(key, "workers") == 0) {
+            parsed = parse_uint(value, 0, JOB_MAX_DEVICES, &job->workers);
+        } else if (parsed == 1 && !device && strcmp(key, "results") == 0) {
+            snprintf(job->results, sizeof(job->results), "%s", value);
+            parsed = 0;
+        } else if (parsed == 1 && !device && strcmp(key, "throttle_file") == 0) {
+            // Nel job: i device lo ereditano dalle opzioni globali, quindi va prima delle sezioni
+            snprintf(job->throttle_file, sizeof(job->throttle_file), "%s", value);
+            globals.io.throttle.control_file = job->throttle_file;
+            parsed = 0;
+        } else if (parsed == 1 && !device && strcmp(key, "certificate_dir") == 0) {
+            snprintf(job->certificate_dir, sizeof(job->certificate_dir), "%s", value);
+            globals.certificate_dir = job->certificate_dir;
+            parsed = access(value, W_OK | X_OK) == 0 ? 0 : -1;
+        }
+
+        if (parsed == 1) {
+            fprintf(stderr, "ERROR: %s:%d: unknown %s key '%s'\n", path, line_number, device ? "device" : "job",
+                    key);
+            valid = 0;
+        } else if (parsed != 0) {
+            fprintf(stderr, "ERROR: %s:%d: invalid value '%s' for %s\n", path, line_number, value, key);
+            valid = 0;
+        }
+    }
+
+    fclose(fp);
+
+    if (valid) {
+        valid = in_device ? finish_device(job, &section) == 0 : finish_section(job, &section) == 0;
+    }
+    if (valid && job->count == 0) {
+        fprintf(stderr, "ERROR: %s: no [device] sections\n", path);
+        valid = 0;
+    }
+    if (!valid) {
+        job_free(job);
+        return -1;
+    }
+
+    if (job->results[0] == '\0') {
+        snprintf(job->results, sizeof(job->results), "%s%s", path, JOB_RESULTS_SUFFIX);
+    }
+    return 0;
+}
+
+int job_confirmed(const job_t *job, const char *token) {
+    char expected[64];
+
+    snprintf(expected, sizeof(expected), JOB_CONFIRM_FORMAT, job->count);
+    return token && strcmp(token, expected) == 0;
+}
+
+int job_resolve(job_device_t *device, char *reason, size_t reason_size) {
+    if (device->serial[0] != '\0' || device->wwn[0] != '\0') {
+        char found[256];
+        int matches = inventory_find(device->serial, device->wwn, found, sizeof(found));
+
+        if (matches < 0) {
+            snprintf(reason, reason_size, "cannot scan block devices");
+            return -1;
+        } else if (matches == 0) {
+            snprintf(reason, reason_size, "no device with this %s", device->serial[0] != '\0' ? "serial" : "WWN");
+            return -1;
+        } else if (matches > 1) {
+            snprintf(reason, reason_size, "%d devices match, identifier is ambiguous", matches);
+            return -1;
+        }
+
+        // Con path= il job fissa anche il nome atteso: un disco spostato viene rifiutato
+        if (device->path[0] != '\0' && strcmp(device->path, found) != 0) {
+            snprintf(reason, reason_size, "identifier matches %s, not %s", found, device->path);
+            return -1;
+        }
+        snprintf(device->path, sizeof(device->path), "%s", found);
+    }
+
+    // Per i risultati: seriale e WWN effettivi anche dei device indicati per path
+    if (device->serial[0] == '\0' &&
+        sysfs_read_string(device->path, "device/serial", device->serial, sizeof(device->serial)) != 0) {
+        device->serial[0] = '\0';
+    }
+    if (device->wwn[0] == '\0' && sysfs_read_string(device->path, "wwid", device->wwn, sizeof(device->wwn)) != 0 &&
+        sysfs_read_string(device->path, "device/wwid", device->wwn, sizeof(device->wwn)) != 0) {
+        device->wwn[0] = '\0';
+    }
+    return 0;
+}
+
+int job_exit_code(const batch_t *batch, int run_result) {
+    int failed = 0;
+    int refused = 0;
+
+    for (int i = 0; i < batch->count; i++) {
+        batch_status_t status = batch->devices[i].status;
+        if (status == BATCH_FAILED || status == BATCH_MISMATCH) {
+            failed = 1;
+        } else if (status == BATCH_REFUSED) {
+            refused = 1;
+        }
+    }
+
+    if (run_result == -2) {
+        return JOB_EXIT_INTERRUPTED;
+    } else if (failed) {
+        return JOB_EXIT_FAILED;
+    } else if (refused) {
+        return JOB_EXIT_REFUSED;
+    }
+    return JOB_EXIT_SUCCESS;
+}
+
+static void write_device(FILE *out, const job_device_t *job_device, const batch_device_t *device) {
+    const wipe_options_t *options = &device->options;
+    double mbps = device->seconds > 0 ? (double)device->written / device->seconds / (1024.0 * 1024.0) : 0.0;
+
+    fprintf(out, "    {\"line\": %d, \"path\": ", job_device->line);
+    json_write_string(out, device->path);
+    fprintf(out, ", \"serial\": ");
+    json_write_string(out, job_device->serial);
+    fprintf(out, ", \"wwn\": ");
+    json_write_string(out, job_device->wwn);
+    fprintf(out, ",\n     \"status\": \"%s\", \"reason\": ", batch_status_name(device->status));
+    json_write_string(out, device->reason);
+
+    if (device->status == BATCH_REFUSED) {
+        fprintf(out, "}");
+        return;
+    }
+
+    fprintf(out, ",\n     \"size\": %zu, \"method\": \"%s\", \"scheme\": \"%s\", \"seed\": \"0x%016llx\", "
+            "\"resumed\": %s,\n", device->size, wipe_method_name(options->method), options->scheme.name,
+            (unsigned long long)options->seed, device->resumed ? "true" : "false");
+    fprintf(out, "     \"bytes_written\": %zu, \"seconds\": %.3f, \"mbps\": %.1f, \"unwritable_bytes\": %llu, "
+            "\"unwritable_ranges\": %llu", device->written, device->seconds, mbps,
+            (unsigned long long)device->stats.bad_bytes, (unsigned long long)device->stats.bad_count);
+
+    if (device->metadata && device->status == BATCH_SUCCESS) {
+        const metadata_plan_t *plan = device->metadata;
+        fprintf(out, ",\n     \"partition_table\": \"%s\", \"partitions\": %d, \"cleared_ranges\": [", plan->table,
+                plan->partitions);
+        for (int i = 0; i < plan->count; i++) {
+            fprintf(out, "%s\n       {\"offset\": %zu, \"length\": %zu, \"label\": ", i > 0 ? "," : "",
+                    plan->ranges[i].offset, plan->ranges[i].length);
+            json_write_string(out, plan->ranges[i].label);
+            fprintf(out, "}");
+        }
+        fprintf(out, "]");
+    }
+
+    const numa_placement_t *numa = &device->plan.numa;
+    fprintf(out, ",\n     \"numa\": {\"node\": %d, \"pinned\": %s, \"cpus\": ", numa->node,
+            numa->pinned ? "true" : "false");
+    json_write_string(out, numa->cpulist);
+    fprintf(out, "}");
+
+    const io_stats_t *stats = &device->stats;
+    if (stats->latency.total > 0) {
+        fprintf(out, ",\n     \"latency\": {\"p50_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f, \"stalls\": %llu}",
+                latency_percentile(&stats->latency, 50.0) / 1000.0,
+                latency_percentile(&stats->latency, 99.0) / 1000.0, stats->latency.max_ns / 1000.0,
+                (unsigned long long)stats->stall_count);
+    }
+
+    if (stats->compare_read_bytes > 0) {
+        fprintf(out, ",\n     \"compare\": {\"bytes_read\": %llu, \"bytes_rewritten\": %llu, \"writes\": %llu, "
+                "\"blind_seconds\": %.3f, \"saved_seconds\": %.3f, \"write_speed_assumed\": %s}",
+                (unsigned long long)stats->compare_read_bytes, (unsigned long long)stats->compare_written_bytes,
+                (unsigned long long)stats->compare_writes, stats->compare_blind_seconds,
+                stats->compare_blind_seconds - stats->compare_seconds, stats->compare_assumed ? "true" : "false");
+    }
+
+    if (options->verify.mode != VERIFY_NONE) {
+        const verify_result_t *verify = &device->verify;
+        fprintf(out, ",\n     \"verify\": {\"mode\": \"%s\", \"bytes_read\": %zu, \"mismatched_bytes\": %zu, "
+                "\"ranges\": %zu, \"seconds\": %.3f}", verify_mode_name(options->verify.mode), verify->bytes_read,
+                verify->mismatched_bytes, verify->range_count, verify->seconds);
+    }
+
+    if (device->certificate[0] != '\0') {
+        fprintf(out, ",\n     \"certificate\": ");
+        json_write_string(out, device->certificate);
+    }
+    fprintf(out, "}");
+}
+
+int job_write_results(const job_t *job, const batch_t *batch, time_t started, time_t finished, int exit_code) {
+    char tmp_path[PATH_MAX + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", job->results);
+
+    FILE *out = fopen(tmp_path, "w");
+    if (!out) {
+        perror("fopen(results)");
+        return -1;
+    }
+
+    fprintf(out, "{\n  \"job\": ");
+    json_write_string(out, job->file);
+    fprintf(out, ",\n  \"started\": ");
+    json_write_time(out, started);
+    fprintf(out, ",\n  \"finished\": ");
+    json_write_time(out, finished);
+    fprintf(out, ",\n  \"workers\": %u,\n  \"exit_code\": %d,\n  \"peak_rss_bytes\": %zu,\n  \"devices\": [\n",
+            job->workers, exit_code, peak_rss());
+
+    for (int i = 0; i < job->count && i < batch->count; i++) {
+        write_device(out, &job->devices[i], &batch->devices[i]);
+        fprintf(out, "%s\n", i + 1 < job->count && i + 1 < batch->count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+
+    // Come il journal: il file dei risultati è sempre completo o assente
+    if (fflush(out) != 0 || fsync(fileno(out)) != 0) {
+        perror("write(results)");
+        fclose(out);
+        unlink(tmp_path);
+        return -1;
+    }
+    fclose(out);
+
+    if (rename(tmp_path, job->results) != 0) {
+        perror("rename(results)");
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+void job_free(job_t *job) {
+    free(job->devices);
+    job->devices = NULL;
+    job->count = 0;
+}
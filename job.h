@@ -0,0 +1,67 @@
+#ifndef JOB_H
+#define JOB_H
+
+#include <limits.h>
+#include <time.h>
+#include "batch.h"
+#include "disk_ops.h"
+
+// Modalità job: un file key=value descrive i device (per seriale o WWN) e le opzioni di ognuno,
+// un token esplicito sostituisce le conferme digitate e i risultati finiscono in un file JSON.
+//
+//   confirm = ERASE-2-DEVICES
+//   workers = 2
+//   verify = sample
+//
+//   [device]
+//   serial = S4EWNX0N123456
+//   scheme = dod
+//
+//   [device]
+//   wwn = naa.5000c500a1b2c3d4
+//   method = zeroout
+
+#define JOB_CONFIRM_FORMAT "ERASE-%d-DEVICES" // token di conferma per il numero di device del job
+#define JOB_MAX_DEVICES 256
+#define JOB_RESULTS_SUFFIX ".results.json"    // risultati accanto al job file se non indicati
+
+// Codici di uscita della modalità job
+#define JOB_EXIT_SUCCESS     0 // tutti i device cancellati (e verificati)
+#define JOB_EXIT_ERROR       1 // job file non valido, token errato o nessun device utilizzabile
+#define JOB_EXIT_INTERRUPTED 2
+#define JOB_EXIT_FAILED      3 // almeno un device fallito o con verifica non superata
+#define JOB_EXIT_REFUSED     4 // i device eseguiti sono a posto, ma altri sono stati esclusi
+
+typedef struct {
+    char serial[64];
+    char wwn[64];
+    char path[256];          // da path= oppure risolto da seriale e WWN
+    int line;                // riga della sezione [device], per i messaggi
+    wipe_options_t options;  // opzioni globali del job con quelle della sezione
+} job_device_t;
+
+typedef struct {
+    char file[PATH_MAX];
+    char confirm[64];
+    char results[PATH_MAX];
+    char throttle_file[PATH_MAX]; // file di controllo dei limiti, comune a tutti i device
+    char certificate_dir[PATH_MAX]; // cartella dei certificati, comune a tutti i device
+    unsigned int workers;    // device cancellati contemporaneamente, 0 = tutti
+    job_device_t *devices;
+    int count;
+} job_t;
+
+// Legge il job file; le opzioni partono da defaults (riga di comando). Ritorna 0 o -1 con messaggio.
+int job_load(const char *path, const wipe_options_t *defaults, job_t *job);
+// Il token deve essere JOB_CONFIRM_FORMAT con il numero di device del job
+int job_confirmed(const job_t *job, const char *token);
+// Trova il device per seriale/WWN (e controlla path, se indicato anche quello).
+// Ritorna 0, oppure -1 con il motivo in reason.
+int job_resolve(job_device_t *device, char *reason, size_t reason_size);
+// Codice di uscita dagli stati dei device e dal risultato di batch_run
+int job_exit_code(const batch_t *batch, int run_result);
+// Scrive i risultati (un device del batch per ogni device del job, nello stesso ordine)
+int job_write_results(const job_t *job, const batch_t *batch, time_t started, time_t finished, int exit_code);
+void job_free(job_t *job);
+
+#endif // JOB_H
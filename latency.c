@@ -0,0 +1,76 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "latency.h"
+#include <string.h>
+#include <time.h>
+
+void latency_init(latency_hist_t *hist) {
+    memset(hist, 0, sizeof(*hist));
+}
+
+uint64_t latency_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Gruppo 0: valori esatti 0..15; gruppo g >= 1: [16 << (g - 1), 32 << (g - 1)) in 16 parti
+static unsigned int bucket_index(uint64_t ns) {
+    if (ns < LATENCY_SUB_BUCKETS) {
+        return (unsigned int)ns;
+    }
+
+    unsigned int msb = 63 - (unsigned int)__builtin_clzll(ns);
+    unsigned int group = msb - LATENCY_SUB_BITS + 1;
+    if (group >= LATENCY_GROUPS) {
+        return LATENCY_BUCKETS - 1;
+    }
+
+    unsigned int sub = (unsigned int)(ns >> (group - 1)) - LATENCY_SUB_BUCKETS;
+    return group * LATENCY_SUB_BUCKETS + sub;
+}
+
+static uint64_t bucket_upper(unsigned int index) {
+    unsigned int group = index / LATENCY_SUB_BUCKETS;
+    unsigned int sub = index % LATENCY_SUB_BUCKETS;
+
+    if (group == 0) {
+        return sub;
+    }
+    return (((uint64_t)LATENCY_SUB_BUCKETS + sub + 1) << (group - 1)) - 1;
+}
+
+void latency_record(latency_hist_t *hist, uint64_t ns) {
+    __atomic_add_fetch(&hist->counts[bucket_index(ns)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&hist->total, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&hist->sum_ns, ns, __ATOMIC_RELAXED);
+
+    uint64_t max = __atomic_load_n(&hist->max_ns, __ATOMIC_RELAXED);
+    while (ns > max && !__atomic_compare_exchange_n(&hist->max_ns, &max, ns, 1, __ATOMIC_RELAXED,
+                                                    __ATOMIC_RELAXED)) {
+    }
+}
+
+uint64_t latency_percentile(const latency_hist_t *hist, double percentile) {
+    uint64_t total = __atomic_load_n(&hist->total, __ATOMIC_RELAXED);
+    if (total == 0) {
+        return 0;
+    }
+
+    // Rango del percentile (almeno il primo campione)
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)total + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += __atomic_load_n(&hist->counts[i], __ATOMIC_RELAXED);
+        if (seen >= rank) {
+            uint64_t upper = bucket_upper(i);
+            return upper < hist->max_ns ? upper : hist->max_ns;
+        }
+    }
+
+    return hist->max_ns;
+}
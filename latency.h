@@ -0,0 +1,27 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+// Istogramma log-lineare stile HDR: i valori fino a LATENCY_SUB_BUCKETS sono esatti, oltre
+// ogni potenza di due è divisa in LATENCY_SUB_BUCKETS sotto-bucket (errore relativo < 1/16).
+// Memoria fissa e contatori atomici: si registra da più thread senza lock né allocazioni.
+#define LATENCY_SUB_BITS 4
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+#define LATENCY_GROUPS 40 // fino a 2^43 ns (oltre 2 ore) prima dell'ultimo bucket
+#define LATENCY_BUCKETS (LATENCY_GROUPS * LATENCY_SUB_BUCKETS)
+
+typedef struct {
+    uint64_t counts[LATENCY_BUCKETS];
+    uint64_t total;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+} latency_hist_t;
+
+void latency_init(latency_hist_t *hist);
+uint64_t latency_now_ns(void);
+void latency_record(latency_hist_t *hist, uint64_t ns);
+// Limite superiore del bucket che contiene il percentile (0-100), 0 se l'istogramma è vuoto
+uint64_t latency_percentile(const latency_hist_t *hist, double percentile);
+
+#endif // LATENCY_H
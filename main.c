@@ -6,11 +6,47 @@
 #include <strings.h>
 #include <signal.h>
 #include <unistd.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <errno.h>
+#include "batch.h"
+#include "cert.h"
+#include "digest.h"
 #include "disk_ops.h"
+#include "io_plan.h"
+#include "job.h"
 #include "progress.h"
+#include "prng.h"
 #include "utils.h"
-
-#define VERSION "1.0"
+#include "verify.h"
+
+// Opzioni solo lunghe (senza forma breve)
+enum {
+    OPT_SEED = 256,
+    OPT_SAMPLES,
+    OPT_RESUME,
+    OPT_CHECKPOINT_INTERVAL,
+    OPT_CHUNK_SIZE,
+    OPT_NO_TUNE,
+    OPT_SKIP_BAD,
+    OPT_READ_COMPARE,
+    OPT_LIMIT_RATE,
+    OPT_LIMIT_IOPS,
+    OPT_LATENCY_TARGET,
+    OPT_THROTTLE_FILE,
+    OPT_IOPRIO,
+    OPT_CERTIFICATE_DIR,
+    OPT_JOB,
+    OPT_CONFIRM,
+    OPT_RESULTS
+};
+
+// Modalità job (--job): file, token di conferma e risultati dalla riga di comando
+typedef struct {
+    const char *file;
+    const char *confirm; // sostituisce la chiave confirm del job file
+    const char *results; // sostituisce la chiave results del job file
+} job_args_t;
 
 // Variabile globale per gestire interruzioni
 volatile sig_atomic_t interrupted = 0;
@@ -37,7 +73,45 @@ void print_header(void) {
     printf("====================================\n");
 }
 
-void print_warning(const char *disk_path, size_t disk_size) {
+void print_method_plan(const char *indent, wipe_method_t method, const wipe_scheme_t *scheme) {
+    if (method == WIPE_METHOD_QUICK) {
+        printf("%sMethod: quick (partition tables and RAID/LVM/ZFS/filesystem signatures only;\n", indent);
+        printf("%s        the rest of the data is NOT overwritten)\n", indent);
+    } else if (method != WIPE_METHOD_OVERWRITE) {
+        printf("%sMethod: %s (%s, falls back to overwriting with zeros)\n", indent, wipe_method_name(method),
+               wipe_method_ioctl(method));
+    } else {
+        printf("%sScheme: %s (%d pass%s)\n", indent, scheme->name, scheme->pass_count,
+               scheme->pass_count > 1 ? "es" : "");
+    }
+}
+
+void print_throttle_plan(const char *indent, const throttle_config_t *throttle) {
+    char limits[256];
+
+    if (throttle_enabled(throttle) || throttle->ioprio != THROTTLE_IOPRIO_NONE) {
+        printf("%sThrottle: %s\n", indent, throttle_describe(throttle, limits, sizeof(limits)));
+    }
+}
+
+void print_verify_plan(const char *indent, const verify_config_t *verify) {
+    if (verify->mode == VERIFY_FULL) {
+        printf("%sVerify: full read-back after the last pass\n", indent);
+    } else if (verify->mode == VERIFY_SAMPLE && verify->percent > 0) {
+        printf("%sVerify: %.2f%% of the blocks sampled after the last pass\n", indent, verify->percent);
+    } else if (verify->mode == VERIFY_SAMPLE) {
+        printf("%sVerify: %zu random blocks sampled after the last pass\n", indent, verify->samples);
+    }
+}
+
+void print_certificate_plan(const char *indent, const char *dir) {
+    if (dir) {
+        printf("%sCertificate: written to %s with BLAKE3 digests of the verified content\n", indent, dir);
+    }
+}
+
+void print_warning(const char *disk_path, size_t disk_size, const wipe_options_t *options, const io_plan_t *plan,
+                   const checkpoint_t *resume) {
     char size_str[64];
     format_bytes(disk_size, size_str, sizeof(size_str));
 
@@ -47,10 +121,327 @@ void print_warning(const char *disk_path, size_t disk_size) {
     printf("This will permanently erase ALL data on:\n");
     printf("  Device: %s\n", disk_path);
     printf("  Size: %s\n", size_str);
+    print_method_plan("  ", options->method, &options->scheme);
+    print_verify_plan("  ", &options->verify);
+    print_certificate_plan("  ", options->certificate_dir);
+    if (options->io.skip_bad) {
+        printf("  Bad blocks: skipped after %d attempts and reported\n", IO_BAD_BLOCK_RETRIES);
+    }
+    if (options->io.read_compare) {
+        printf("  Read-compare-write: only blocks that differ from each pass are written\n");
+    }
+    print_throttle_plan("  ", &options->io.throttle);
+    io_plan_print(plan, &options->io, "  ");
+    if (resume) {
+        printf("  Resume: pass %d/%d, %.1f%% already erased\n", resume->pass + 1, resume->pass_count,
+               checkpoint_percent(resume));
+    }
     printf("\nThis operation CANNOT be undone!\n");
     printf("ALL data will be PERMANENTLY lost!\n\n");
 }
 
+void print_usage(const char *program) {
+    printf("Usage: %s [options] [device...]\n\n", program);
+    printf("       %s [options] --job=FILE\n\n", program);
+    printf("With one or more devices on the command line, all of them are erased concurrently.\n");
+    printf("With --job, the devices and their settings come from a job file and no input is read.\n\n");
+    printf("Options:\n");
+    printf("  -e, --engine=NAME       Write engine: io_uring (default on Linux) or sync\n");
+    printf("  -q, --queue-depth=N     Requests in flight with io_uring (1-%d, default: from the I/O plan)\n",
+           IO_MAX_QUEUE_DEPTH);
+    printf("  -b, --batch=N           Requests submitted per io_uring_enter() (default %d)\n",
+           IO_DEFAULT_BATCH_SIZE);
+    printf("      --chunk-size=SIZE   Bytes per write request, e.g. 512K or 4M (default: from the I/O plan)\n");
+    printf("      --no-tune           Skip the startup probe and keep the planned chunk size and queue depth\n");
+    printf("  -t, --threads=N         Split the device into N stripes written in parallel (1-%d)\n",
+           IO_MAX_THREADS);
+    printf("  -d, --direct            Bypass the page cache with O_DIRECT and flush once at the end\n");
+    printf("      --skip-bad-blocks   On media errors, bisect the failed write to logical blocks, skip the\n");
+    printf("                          unwritable ones and report them instead of aborting\n");
+    printf("      --read-compare      Read each chunk first and write only the blocks that differ from the\n");
+    printf("                          pass (faster on devices that are already mostly erased)\n");
+    printf("      --limit-rate=SIZE   Limit the write bandwidth per device, e.g. 200M (bytes per second)\n");
+    printf("      --limit-iops=N      Limit the write requests per second per device\n");
+    printf("      --latency-target=MS Lower the bandwidth while the mean write latency exceeds MS\n");
+    printf("      --throttle-file=FILE\n");
+    printf("                          Re-read rate, iops and latency_target from FILE when it changes\n");
+    printf("      --ioprio=CLASS      I/O priority of the writers: idle, be or be:0-7\n");
+    printf("  -m, --method=NAME       Erase method: overwrite (default), zeroout, discard, secdiscard, zonereset\n");
+    printf("                          or quick; offload methods fall back to overwriting with zeros, quick only\n");
+    printf("                          clears partition tables and signatures at the start and end of disk and\n");
+    printf("                          partitions, zonereset only resets the zones of a zoned device\n");
+    printf("  -s, --scheme=NAME       Overwrite scheme (default zero):\n");
+    scheme_print_available();
+    printf("      --seed=N            Seed for random passes (default: from /dev/urandom)\n");
+    printf("  -V, --verify[=MODE]     Read the device back after the last pass and compare it\n");
+    printf("                          with the expected pattern (MODE: full or sample, default full)\n");
+    printf("      --samples=N|P%%      Random blocks read by --verify=sample (default %d)\n",
+           VERIFY_DEFAULT_SAMPLES);
+    printf("      --certificate-dir=DIR\n");
+    printf("                          Write a JSON erasure certificate to DIR, with BLAKE3 digests of\n");
+    printf("                          the verified content per %lluG region (implies --verify=full)\n",
+           (unsigned long long)(DIGEST_REGION_SIZE >> 30));
+    printf("      --resume            Continue an interrupted wipe from its checkpoint journal\n");
+    printf("      --checkpoint-interval=SEC\n");
+    printf("                          Seconds between checkpoints of the wipe (default %d, 0 disables)\n",
+           CHECKPOINT_DEFAULT_INTERVAL);
+    printf("      --job=FILE          Run the job file non-interactively (see README, \"Job Mode\")\n");
+    printf("      --confirm=TOKEN     Safety token of the job, \"ERASE-<N>-DEVICES\" for N devices\n");
+    printf("      --results=FILE      Where the job writes its JSON results (default FILE%s)\n", JOB_RESULTS_SUFFIX);
+    printf("  -h, --help              Show this help\n");
+    printf("\nJob exit codes: %d all erased, %d error, %d interrupted, %d some devices failed,\n",
+           JOB_EXIT_SUCCESS, JOB_EXIT_ERROR, JOB_EXIT_INTERRUPTED, JOB_EXIT_FAILED);
+    printf("                %d some devices refused\n", JOB_EXIT_REFUSED);
+}
+
+// Ritorna 0 se le opzioni sono valide, 1 se il programma deve terminare con successo (--help), -1 su errore.
+// In first_device l'indice del primo device passato come argomento (argc se nessuno).
+int parse_options(int argc, char *argv[], wipe_options_t *options, job_args_t *job, int *first_device) {
+    io_config_t *io_config = &options->io;
+    int scheme_given = 0;
+    static const struct option long_options[] = {
+        {"engine", required_argument, NULL, 'e'},
+        {"queue-depth", required_argument, NULL, 'q'},
+        {"batch", required_argument, NULL, 'b'},
+        {"threads", required_argument, NULL, 't'},
+        {"chunk-size", required_argument, NULL, OPT_CHUNK_SIZE},
+        {"no-tune", no_argument, NULL, OPT_NO_TUNE},
+        {"skip-bad-blocks", no_argument, NULL, OPT_SKIP_BAD},
+        {"read-compare", no_argument, NULL, OPT_READ_COMPARE},
+        {"limit-rate", required_argument, NULL, OPT_LIMIT_RATE},
+        {"limit-iops", required_argument, NULL, OPT_LIMIT_IOPS},
+        {"latency-target", required_argument, NULL, OPT_LATENCY_TARGET},
+        {"throttle-file", required_argument, NULL, OPT_THROTTLE_FILE},
+        {"ioprio", required_argument, NULL, OPT_IOPRIO},
+        {"direct", no_argument, NULL, 'd'},
+        {"method", required_argument, NULL, 'm'},
+        {"scheme", required_argument, NULL, 's'},
+        {"seed", required_argument, NULL, OPT_SEED},
+        {"verify", optional_argument, NULL, 'V'},
+        {"samples", required_argument, NULL, OPT_SAMPLES},
+        {"certificate-dir", required_argument, NULL, OPT_CERTIFICATE_DIR},
+        {"resume", no_argument, NULL, OPT_RESUME},
+        {"checkpoint-interval", required_argument, NULL, OPT_CHECKPOINT_INTERVAL},
+        {"job", required_argument, NULL, OPT_JOB},
+        {"confirm", required_argument, NULL, OPT_CONFIRM},
+        {"results", required_argument, NULL, OPT_RESULTS},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "e:q:b:t:dm:s:Vh", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'e':
+                if (io_engine_from_name(optarg, &io_config->engine) != 0) {
+                    fprintf(stderr, "ERROR: Unknown engine '%s' (use io_uring or sync)\n", optarg);
+                    return -1;
+                }
+                break;
+            case 'q':
+                if (parse_uint(optarg, 1, IO_MAX_QUEUE_DEPTH, &io_config->queue_depth) != 0) {
+                    fprintf(stderr, "ERROR: Queue depth must be between 1 and %d\n", IO_MAX_QUEUE_DEPTH);
+                    return -1;
+                }
+                io_config->tune &= ~IO_TUNE_QUEUE_DEPTH;
+                break;
+            case 'b':
+                if (parse_uint(optarg, 1, IO_MAX_QUEUE_DEPTH, &io_config->batch_size) != 0) {
+                    fprintf(stderr, "ERROR: Batch size must be between 1 and %d\n", IO_MAX_QUEUE_DEPTH);
+                    return -1;
+                }
+                break;
+            case 't':
+                if (parse_uint(optarg, 1, IO_MAX_THREADS, &io_config->threads) != 0) {
+                    fprintf(stderr, "ERROR: Threads must be between 1 and %d\n", IO_MAX_THREADS);
+                    return -1;
+                }
+                io_config->tune &= ~IO_TUNE_THREADS;
+                break;
+            case 'd':
+                io_config->direct_io = 1;
+                break;
+            case OPT_CHUNK_SIZE:
+                if (parse_size(optarg, IO_MIN_CHUNK_SIZE, IO_MAX_CHUNK_SIZE, &io_config->chunk_size) != 0 ||
+                    io_config->chunk_size % IO_MIN_CHUNK_SIZE != 0) {
+                    fprintf(stderr, "ERROR: Chunk size must be a multiple of 4K between 4K and 64M\n");
+                    return -1;
+                }
+                io_config->tune &= ~IO_TUNE_CHUNK_SIZE;
+                break;
+            case OPT_NO_TUNE:
+                io_config->probe = 0;
+                break;
+            case OPT_SKIP_BAD:
+                io_config->skip_bad = 1;
+                break;
+            case OPT_READ_COMPARE:
+                io_config->read_compare = 1;
+                break;
+            case OPT_LIMIT_RATE: {
+                size_t rate;
+                if (parse_size(optarg, 1, THROTTLE_MAX_BPS, &rate) != 0) {
+                    fprintf(stderr, "ERROR: Invalid rate '%s' (bytes per second, e.g. 200M)\n", optarg);
+                    return -1;
+                }
+                io_config->throttle.rate_bps = rate;
+                break;
+            }
+            case OPT_LIMIT_IOPS: {
+                unsigned int iops;
+                if (parse_uint(optarg, 1, 10000000, &iops) != 0) {
+                    fprintf(stderr, "ERROR: IOPS limit must be between 1 and 10000000\n");
+                    return -1;
+                }
+                io_config->throttle.iops = iops;
+                break;
+            }
+            case OPT_LATENCY_TARGET: {
+                unsigned int target_ms;
+                if (parse_uint(optarg, 1, 60000, &target_ms) != 0) {
+                    fprintf(stderr, "ERROR: Latency target must be between 1 and 60000 ms\n");
+                    return -1;
+                }
+                io_config->throttle.latency_target_ns = (uint64_t)target_ms * 1000000;
+                break;
+            }
+            case OPT_THROTTLE_FILE:
+                io_config->throttle.control_file = optarg;
+                break;
+            case OPT_IOPRIO:
+                if (throttle_parse_priority(optarg, &io_config->throttle.ioprio) != 0) {
+                    fprintf(stderr, "ERROR: Unknown I/O priority '%s' (use idle, be or be:0-7)\n", optarg);
+                    return -1;
+                }
+                break;
+            case 'm':
+                if (wipe_method_from_name(optarg, &options->method) != 0) {
+                    fprintf(stderr, "ERROR: Unknown method '%s' (use overwrite, zeroout, discard, secdiscard, "
+                            "zonereset or quick)\n", optarg);
+                    return -1;
+                }
+                break;
+            case 's':
+                if (scheme_from_name(optarg, &options->scheme) != 0) {
+                    fprintf(stderr, "ERROR: Unknown scheme '%s'\n", optarg);
+                    return -1;
+                }
+                scheme_given = 1;
+                break;
+            case OPT_SEED: {
+                char *end;
+                options->seed = strtoull(optarg, &end, 0);
+                if (*optarg == '\0' || *end != '\0') {
+                    fprintf(stderr, "ERROR: Invalid seed '%s'\n", optarg);
+                    return -1;
+                }
+                break;
+            }
+            case 'V':
+                options->verify.mode = VERIFY_FULL;
+                if (optarg && verify_mode_from_name(optarg, &options->verify.mode) != 0) {
+                    fprintf(stderr, "ERROR: Unknown verify mode '%s' (use full or sample)\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_SAMPLES:
+                if (verify_parse_samples(optarg, &options->verify) != 0) {
+                    fprintf(stderr, "ERROR: Invalid sample count '%s' (use N or a percentage like 0.5%%)\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_CERTIFICATE_DIR:
+                options->certificate_dir = optarg;
+                break;
+            case OPT_RESUME:
+                options->resume = 1;
+                break;
+            case OPT_CHECKPOINT_INTERVAL:
+                if (parse_uint(optarg, 0, 86400, &options->checkpoint_interval) != 0) {
+                    fprintf(stderr, "ERROR: Checkpoint interval must be between 0 and 86400 seconds\n");
+                    return -1;
+                }
+                break;
+            case OPT_JOB:
+                job->file = optarg;
+                break;
+            case OPT_CONFIRM:
+                job->confirm = optarg;
+                break;
+            case OPT_RESULTS:
+                job->results = optarg;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 1;
+            default:
+                print_usage(argv[0]);
+                return -1;
+        }
+    }
+
+    *first_device = optind;
+
+    if (job->file && optind < argc) {
+        fprintf(stderr, "ERROR: --job cannot be combined with devices on the command line\n");
+        return -1;
+    }
+    if (!job->file && (job->confirm || job->results)) {
+        fprintf(stderr, "ERROR: --confirm and --results require --job\n");
+        return -1;
+    }
+
+    // I metodi offload lasciano zeri (o blocchi non mappati): il ripiego e la verifica usano
+    // un'unica passata di zeri, uno schema diverso non avrebbe senso
+    if (options->method != WIPE_METHOD_OVERWRITE) {
+        if (scheme_given) {
+            fprintf(stderr, "ERROR: --scheme cannot be combined with --method=%s\n",
+                    wipe_method_name(options->method));
+            return -1;
+        }
+        scheme_from_name("zero", &options->scheme);
+    }
+    // La cancellazione rapida lascia intatti i dati fuori dai metadati: una verifica fallirebbe sempre
+    if (options->method == WIPE_METHOD_QUICK && options->verify.mode != VERIFY_NONE) {
+        fprintf(stderr, "ERROR: --verify cannot be combined with --method=quick\n");
+        return -1;
+    }
+    if (options->method == WIPE_METHOD_QUICK && io_config->read_compare) {
+        fprintf(stderr, "ERROR: --read-compare cannot be combined with --method=quick\n");
+        return -1;
+    }
+    // Il digest del certificato copre tutto il device: serve la rilettura completa
+    if (options->certificate_dir) {
+        if (options->method == WIPE_METHOD_QUICK || options->verify.mode == VERIFY_SAMPLE) {
+            fprintf(stderr, "ERROR: --certificate-dir needs a full verify (not --verify=sample or --method=quick)\n");
+            return -1;
+        }
+        if (access(options->certificate_dir, W_OK | X_OK) != 0) {
+            fprintf(stderr, "ERROR: Cannot write certificates to %s: %s\n", options->certificate_dir,
+                    strerror(errno));
+            return -1;
+        }
+        options->verify.mode = VERIFY_FULL;
+    }
+
+    // Il batch non può superare le richieste in volo
+    if (io_config->batch_size > io_config->queue_depth) {
+        io_config->batch_size = io_config->queue_depth;
+    }
+
+    return 0;
+}
+
+// Se l'utente ha inserito solo il nome del device senza /dev/, aggiungerlo
+void normalize_disk_path(char *disk_path, size_t path_size) {
+    if (strncmp(disk_path, "/dev/", 5) != 0) {
+        char temp[256];
+        strncpy(temp, disk_path, sizeof(temp) - 1);
+        temp[sizeof(temp) - 1] = '\0';
+        snprintf(disk_path, path_size, "/dev/%.250s", temp);
+    }
+}
+
 int get_disk_selection(char *disk_path, size_t path_size) {
 #ifdef __APPLE__
     printf("\nEnter disk to erase (e.g., disk2 or /dev/disk2), or 'QUIT' to exit: ");
@@ -76,13 +467,7 @@ int get_disk_selection(char *disk_path, size_t path_size) {
         return -2; // Codice speciale per uscita
     }
 
-    // Se l'utente ha inserito solo il nome del device senza /dev/, aggiungerlo
-    if (strncmp(disk_path, "/dev/", 5) != 0) {
-        char temp[256];
-        strncpy(temp, disk_path, sizeof(temp) - 1);
-        snprintf(disk_path, path_size, "/dev/%s", temp);
-    }
-
+    normalize_disk_path(disk_path, path_size);
     return 0;
 }
 
@@ -118,11 +503,299 @@ int confirm_disk_selection(const char *disk_path) {
     return (strcmp(input, disk_name) == 0);
 }
 
-int main(void) {
+int confirm_batch(int device_count) {
+    char input[128];
+    char expected[32];
+
+    snprintf(expected, sizeof(expected), "%d", device_count);
+    printf("Type the number of devices (%s) to confirm: ", expected);
+    fflush(stdout);
+
+    if (fgets(input, sizeof(input), stdin) == NULL) {
+        return 0;
+    }
+
+    // Rimuovere newline
+    size_t len = strlen(input);
+    if (len > 0 && input[len - 1] == '\n') {
+        input[len - 1] = '\0';
+    }
+
+    return (strcmp(input, expected) == 0);
+}
+
+// Wipe concorrente di più device passati da riga di comando
+int run_batch(char *const *args, int count, const wipe_options_t *options) {
+    const wipe_scheme_t *scheme = &options->scheme;
+
+    char (*paths)[256] = calloc((size_t)count, sizeof(*paths));
+    char **path_list = calloc((size_t)count, sizeof(char *));
+    if (!paths || !path_list) {
+        perror("calloc");
+        free(paths);
+        free(path_list);
+        return 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        snprintf(paths[i], sizeof(paths[i]), "%s", args[i]);
+        normalize_disk_path(paths[i], sizeof(paths[i]));
+        path_list[i] = paths[i];
+        log_message("Batch: selected disk %s", paths[i]);
+    }
+
+    // 1. Preflight di tutti i device
+    batch_t batch;
+    int ready = batch_init(&batch, path_list, count, options);
+    free(path_list);
+    free(paths);
+
+    if (ready <= 0) {
+        fprintf(stderr, "\nERROR: No usable devices\n");
+        log_message("Batch: no usable devices");
+        batch_free(&batch);
+        return 1;
+    }
+
+    // 2. Warning e doppia conferma
+    batch_print_plan(&batch);
+    printf("\n!!! WARNING !!!\n");
+    printf("================\n");
+    printf("This will permanently erase ALL data on %d device(s).\n", ready);
+    print_method_plan("", options->method, scheme);
+    print_verify_plan("", &options->verify);
+    print_certificate_plan("", options->certificate_dir);
+    if (options->io.skip_bad) {
+        printf("Bad blocks: skipped after %d attempts and reported\n", IO_BAD_BLOCK_RETRIES);
+    }
+    if (options->io.read_compare) {
+        printf("Read-compare-write: only blocks that differ from each pass are written\n");
+    }
+    print_throttle_plan("", &options->io.throttle);
+    printf("\nThis operation CANNOT be undone!\n");
+    printf("ALL data will be PERMANENTLY lost!\n\n");
+
+    if (!confirm_action("Type 'YES' to continue")) {
+        printf("\nOperation cancelled.\n");
+        log_message("Batch cancelled by user (first confirmation)");
+        batch_free(&batch);
+        return 0;
+    }
+
+    printf("\n");
+    if (!confirm_batch(ready)) {
+        printf("\nOperation cancelled.\n");
+        log_message("Batch cancelled by user (second confirmation)");
+        batch_free(&batch);
+        return 0;
+    }
+
+    log_message("User confirmed batch operation on %d devices", ready);
+
+    // 3. Unmount e apertura in scrittura
+    if (batch_open(&batch) == 0) {
+        fprintf(stderr, "\nERROR: Cannot open any device for writing\n");
+        batch_report(&batch);
+        batch_free(&batch);
+        return 1;
+    }
+
+    // 4. Wipe concorrente
+    setup_signal_handlers();
+    printf("\nStarting secure erase of %d device(s)...\n", ready);
+
+    int result = batch_run(&batch);
+
+    // 5. Report finale
+    batch_report(&batch);
+    batch_free(&batch);
+
+    if (result == -2) {
+        printf("\nOperation was interrupted.\n");
+        printf("Disks may be partially erased.\n");
+        if (options->checkpoint_interval > 0) {
+            printf("Run again with --resume to continue from the last checkpoint.\n");
+        }
+        log_message("Batch interrupted by user");
+        return 2;
+    } else if (result != 0) {
+        log_message("Batch completed with failures");
+        return 1;
+    }
+
+    log_message("Batch completed successfully");
+    return 0;
+}
+
+// Wipe non interattivo dal job file: nessuna lettura da stdin, risultati in JSON
+int run_job(const job_args_t *args, const wipe_options_t *options) {
+    job_t job;
+    time_t started = time(NULL);
+
+    if (job_load(args->file, options, &job) != 0) {
+        log_message("Job: invalid job file %s", args->file);
+        return JOB_EXIT_ERROR;
+    }
+    if (args->results) {
+        snprintf(job.results, sizeof(job.results), "%s", args->results);
+    }
+    log_message("Job: %s with %d device(s), %u worker(s)", job.file, job.count, job.workers);
+
+    // Il token sostituisce le due conferme: deve riportare il numero di device del job
+    const char *token = args->confirm ? args->confirm : job.confirm;
+    if (!job_confirmed(&job, token)) {
+        fprintf(stderr, "ERROR: Job not confirmed: set confirm = " JOB_CONFIRM_FORMAT " in the job file or pass "
+                "--confirm\n", job.count);
+        log_message("Job: missing or wrong confirmation token");
+        job_free(&job);
+        return JOB_EXIT_ERROR;
+    }
+
+    // 1. Risoluzione di seriali e WWN, poi preflight con le opzioni di ogni device
+    batch_t batch;
+    if (batch_create(&batch, job.count) != 0) {
+        job_free(&job);
+        return JOB_EXIT_ERROR;
+    }
+    batch.workers = (int)job.workers;
+
+    int ready = 0;
+    for (int i = 0; i < job.count; i++) {
+        job_device_t *device = &job.devices[i];
+        char reason[128];
+
+        if (job_resolve(device, reason, sizeof(reason)) != 0) {
+            char label[160];
+            snprintf(label, sizeof(label), "%s=%s", device->serial[0] != '\0' ? "serial" : "wwn",
+                     device->serial[0] != '\0' ? device->serial : device->wwn);
+            fprintf(stderr, "ERROR: %s:%d: %s\n", job.file, device->line, reason);
+            batch_add_refused(&batch, label, reason);
+            continue;
+        }
+        log_message("Job: device at line %d is %s (serial %s, wwn %s)", device->line, device->path,
+                    device->serial[0] != '\0' ? device->serial : "-", device->wwn[0] != '\0' ? device->wwn : "-");
+        ready += batch_add(&batch, device->path, &device->options) > 0;
+    }
+
+    batch_print_plan(&batch);
+    log_message("User confirmed job on %d devices with token", ready);
+
+    // 2. Unmount, apertura e wipe con al più workers device alla volta
+    int result = -1;
+    if (ready > 0 && batch_open(&batch) > 0) {
+        setup_signal_handlers();
+        printf("\nStarting secure erase of %d device(s)...\n", ready);
+        result = batch_run(&batch);
+    } else {
+        fprintf(stderr, "\nERROR: No usable devices\n");
+    }
+
+    // 3. Report e risultati
+    batch_report(&batch);
+    int exit_code = ready > 0 ? job_exit_code(&batch, result) : JOB_EXIT_ERROR;
+    if (job_write_results(&job, &batch, started, time(NULL), exit_code) == 0) {
+        printf("\nResults written to %s\n", job.results);
+    } else {
+        fprintf(stderr, "ERROR: Cannot write results to %s\n", job.results);
+        exit_code = JOB_EXIT_ERROR;
+    }
+
+    log_message("Job finished with exit code %d", exit_code);
+    batch_free(&batch);
+    job_free(&job);
+    return exit_code;
+}
+
+// Verifica dopo il wipe interattivo, con il certificato se cert non è NULL (già compilato con i dati
+// del wipe); ritorna il codice di uscita del programma
+int run_verify(const char *disk_path, size_t disk_size, const wipe_options_t *options, cert_info_t *cert) {
+    const pattern_pass_t *last = &options->scheme.passes[options->scheme.pass_count - 1];
+    progress_info_t progress;
+    verify_result_t verify;
+    char certificate[PATH_MAX] = "";
+
+    printf("\nVerifying...\n\n");
+    progress_init(&progress, 0);
+    progress_set_label(&progress, "Verify");
+
+    // Il digest si calcola sui chunk della rilettura, senza un'altra passata sul device
+    if (cert) {
+        cert->digest = digest_create(disk_size, 0);
+        if (!cert->digest) {
+            return 1;
+        }
+        progress.digest = cert->digest;
+    }
+
+    int result = verify_device(disk_path, disk_size, last, &options->io, &options->verify, &progress, &verify);
+    if (cert && (result == 0 || result == 1)) {
+        cert->result = result == 0 ? "success" : "mismatch";
+        cert->finished = time(NULL);
+        cert->verify = &verify;
+        if (cert_write(options->certificate_dir, cert, certificate, sizeof(certificate)) != 0) {
+            fprintf(stderr, "\nERROR: Cannot write the certificate to %s\n", options->certificate_dir);
+            log_message("Certificate for %s not written", disk_path);
+            digest_free(cert->digest);
+            cert->digest = NULL;
+            return 1;
+        }
+    }
+    if (cert) {
+        digest_free(cert->digest);
+        cert->digest = NULL;
+    }
+
+    if (result == -2) {
+        printf("\n\nVerification was interrupted.\n");
+        log_message("Verification interrupted by user");
+        return 2;
+    } else if (result < 0) {
+        fprintf(stderr, "\nERROR: Verification failed\n");
+        log_message("Verification failed with error");
+        return 1;
+    }
+
+    // Barra finale al 100%, poi il riepilogo sotto le due righe del display
+    progress_display(&progress);
+    printf("\n\n");
+    verify_report(&verify);
+    verify_log(&verify, disk_path);
+    if (certificate[0] != '\0') {
+        printf("\nCertificate written to %s\n", certificate);
+    }
+
+    return result == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
     char disk_path[256];
     int fd = -1;
     ssize_t disk_size;
     progress_info_t progress;
+    io_stats_t stats;
+    wipe_options_t options;
+    checkpoint_t checkpoint;
+    job_args_t job = {NULL, NULL, NULL};
+    int first_device;
+
+    io_config_default(&options.io);
+    scheme_from_name("zero", &options.scheme);
+    options.method = WIPE_METHOD_OVERWRITE;
+    verify_config_default(&options.verify);
+    options.seed = 0;
+    options.checkpoint_interval = CHECKPOINT_DEFAULT_INTERVAL;
+    options.resume = 0;
+    options.certificate_dir = NULL;
+    int parse_result = parse_options(argc, argv, &options, &job, &first_device);
+    if (parse_result != 0) {
+        return parse_result > 0 ? 0 : 1;
+    }
+
+    // Con il seed registrato nel log ogni passata casuale si può rigenerare per la verifica
+    if (options.seed == 0) {
+        options.seed = prng_random_seed();
+    }
+    scheme_set_seed(&options.scheme, options.seed);
 
     print_header();
 
@@ -134,6 +807,18 @@ int main(void) {
     }
 
     log_message("Program started");
+    log_message("Scheme: %s, random seed: 0x%016llx, generator kernel: %s", options.scheme.name,
+                (unsigned long long)options.seed, prng_kernel_name(prng_active_kernel()));
+
+    // Modalità job: device e opzioni dal job file, nessuna conferma interattiva
+    if (job.file) {
+        return run_job(&job, &options);
+    }
+
+    // Modalità batch: device passati da riga di comando
+    if (first_device < argc) {
+        return run_batch(&argv[first_device], argc - first_device, &options);
+    }
 
     // 2. Mostrare lista dischi
     printf("\n");
@@ -165,7 +850,7 @@ int main(void) {
 
     // 5. Aprire il disco per ottenere le informazioni
     printf("\nGetting disk information...\n");
-    fd = open_disk_raw(disk_path);
+    fd = open_disk_raw(disk_path, 0);
     if (fd < 0) {
         fprintf(stderr, "ERROR: Cannot open disk\n");
         log_message("Failed to open disk: %s", disk_path);
@@ -180,10 +865,24 @@ int main(void) {
         return 1;
     }
 
+    size_t aligned_size = wipe_aligned_size(fd, (size_t)disk_size, options.io.direct_io);
     close(fd);
 
+    // Journal del wipe: con --resume adotta metodo, schema e seed della sessione interrotta
+    int resumed = wipe_checkpoint_prepare(disk_path, (size_t)disk_size, aligned_size, &options, &checkpoint);
+    if (resumed < 0) {
+        log_message("Unusable checkpoint for %s", disk_path);
+        return 1;
+    }
+
+    // Chunk e queue depth dai limiti della coda del device (se non fissati da riga di comando)
+    io_plan_t plan;
+    io_plan_build(disk_path, &plan);
+    io_plan_apply(&plan, &options.io);
+    io_plan_log(&plan, &options.io, disk_path);
+
     // 6. Mostrare warning e richiedere prima conferma
-    print_warning(disk_path, disk_size);
+    print_warning(disk_path, disk_size, &options, &plan, resumed ? &checkpoint : NULL);
 
     if (!confirm_action("Type 'YES' to continue")) {
         printf("\nOperation cancelled.\n");
@@ -207,7 +906,7 @@ int main(void) {
 
     // 9. Aprire device raw per scrittura
     printf("\n");
-    fd = open_disk_raw(disk_path);
+    fd = open_disk_raw(disk_path, options.io.direct_io);
     if (fd < 0) {
         fprintf(stderr, "ERROR: Cannot open disk for writing\n");
         log_message("Failed to open disk for writing");
@@ -217,13 +916,20 @@ int main(void) {
     // 10. Setup signal handlers
     setup_signal_handlers();
 
+    // I thread del wipe ereditano CPU e memoria del nodo del device
+    numa_apply(&plan.numa, disk_path);
+
     // 11. Inizializzazione progress tracker
     printf("\nStarting secure erase...\n\n");
-    progress_init(&progress, disk_size);
-    log_message("Starting wipe operation - size: %zu bytes", disk_size);
+    progress_init(&progress, (size_t)disk_size * (size_t)options.scheme.pass_count);
+    progress_set_resumed(&progress, checkpoint_done_bytes(&checkpoint));
+    progress.stats = &stats;
+    log_message("Starting wipe operation - size: %zu bytes, method: %s, scheme: %s", disk_size,
+                wipe_method_name(options.method), options.scheme.name);
+    time_t started = time(NULL);
 
     // 12. Loop di scrittura con progress display
-    int result = wipe_disk(fd, disk_size, &progress);
+    int result = wipe_disk(fd, disk_path, disk_size, &options, &checkpoint, &progress);
 
     // 13. Chiusura
     close(fd);
@@ -235,6 +941,9 @@ int main(void) {
     } else if (result == -2) {
         printf("\nOperation was interrupted.\n");
         printf("Disk may be partially erased.\n");
+        if (options.checkpoint_interval > 0) {
+            printf("Run again with --resume to continue from the last checkpoint.\n");
+        }
         log_message("Operation interrupted by user");
         return 2;
     } else {
@@ -243,5 +952,22 @@ int main(void) {
         return 1;
     }
 
+    // 15. Rilettura e confronto con l'ultima passata
+    if (options.verify.mode != VERIFY_NONE && options.certificate_dir) {
+        cert_info_t cert = {
+            .disk_path = disk_path,
+            .size = (size_t)disk_size,
+            .options = &options,
+            .started = started,
+            .wipe_seconds = progress_elapsed(&progress),
+            .written = progress.written_bytes - progress.resumed_bytes,
+            .resumed = resumed,
+            .stats = &stats,
+        };
+        return run_verify(disk_path, (size_t)disk_size, &options, &cert);
+    } else if (options.verify.mode != VERIFY_NONE) {
+        return run_verify(disk_path, (size_t)disk_size, &options, NULL);
+    }
+
     return 0;
 }
@@ -0,0 +1,394 @@
+#define _GNU_SOURCE
+
+#include "metadata.h"
+#include "sysfs.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define GPT_SIGNATURE "EFI PART"
+#define GPT_MAX_ENTRIES_SIZE (1024 * 1024) // oltre non è una tabella plausibile
+#define MBR_PARTITION_OFFSET 446
+#define MBR_GPT_PROTECTIVE 0xEE
+#define BTRFS_SUPER_SIZE 4096
+
+// Copie del superblock btrfs oltre a quella a 64 KiB, che sta nel primo MiB
+static const size_t btrfs_mirrors[] = {64ULL << 20, 256ULL << 30, 1ULL << 50};
+
+typedef struct {
+    uint64_t alternate_lba;
+    uint64_t entries_lba;
+    uint32_t entry_count;
+    uint32_t entry_size;
+} gpt_header_t;
+
+typedef struct {
+    int number;
+    size_t start;
+    size_t size;
+} partition_t;
+
+typedef struct {
+    int fd;
+    size_t disk_size;
+    size_t block_size;
+    size_t aligned_size;     // disk_size arrotondato al blocco logico
+    void *buffer;            // un blocco logico, allineato per O_DIRECT
+    partition_t partitions[METADATA_MAX_PARTITIONS];
+    int partition_count;
+    metadata_plan_t *plan;
+} plan_ctx_t;
+
+static uint32_t le32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t le64(const unsigned char *p) {
+    return (uint64_t)le32(p) | (uint64_t)le32(p + 4) << 32;
+}
+
+static int read_exact(int fd, void *buffer, size_t length, size_t offset) {
+    size_t done = 0;
+
+    while (done < length) {
+        ssize_t n = pread(fd, (char *)buffer + done, length - done, (off_t)(offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+static void append_label(char *label, const char *text) {
+    size_t len = strlen(label);
+
+    if (strstr(label, text)) {
+        return;
+    }
+    if (len > 0 && len + 2 + strlen(text) < METADATA_LABEL_SIZE) {
+        strcat(label, ", ");
+        strcat(label, text);
+    } else if (len == 0) {
+        snprintf(label, METADATA_LABEL_SIZE, "%s", text);
+    }
+}
+
+// Intervallo allineato al blocco logico e limitato al device; gli intervalli vengono fusi dopo
+static void add_range(plan_ctx_t *ctx, size_t offset, size_t length, const char *label) {
+    metadata_plan_t *plan = ctx->plan;
+
+    if (offset >= ctx->aligned_size || length == 0) {
+        return;
+    }
+    size_t end = length > ctx->aligned_size - offset ? ctx->aligned_size : offset + length;
+    offset -= offset % ctx->block_size;
+    if (end % ctx->block_size) {
+        end += ctx->block_size - end % ctx->block_size;
+    }
+    if (end > ctx->aligned_size) {
+        end = ctx->aligned_size;
+    }
+
+    if (plan->count == METADATA_MAX_RANGES) {
+        log_message("Quick wipe: more than %d metadata ranges, ignoring %s at %zu", METADATA_MAX_RANGES, label,
+                    offset);
+        return;
+    }
+
+    metadata_range_t *range = &plan->ranges[plan->count++];
+    range->offset = offset;
+    range->length = end - offset;
+    range->label[0] = '\0';
+    append_label(range->label, label);
+}
+
+static int compare_ranges(const void *a, const void *b) {
+    const metadata_range_t *ra = a;
+    const metadata_range_t *rb = b;
+
+    if (ra->offset != rb->offset) {
+        return ra->offset < rb->offset ? -1 : 1;
+    }
+    return 0;
+}
+
+// Ordina per offset e fonde gli intervalli sovrapposti o contigui, unendo le descrizioni
+static void merge_ranges(metadata_plan_t *plan) {
+    int count = 0;
+
+    qsort(plan->ranges, (size_t)plan->count, sizeof(plan->ranges[0]), compare_ranges);
+    for (int i = 0; i < plan->count; i++) {
+        metadata_range_t *range = &plan->ranges[i];
+        metadata_range_t *last = count > 0 ? &plan->ranges[count - 1] : NULL;
+
+        if (last && range->offset <= last->offset + last->length) {
+            size_t end = range->offset + range->length;
+            if (end > last->offset + last->length) {
+                last->length = end - last->offset;
+            }
+            append_label(last->label, range->label);
+            continue;
+        }
+        plan->ranges[count++] = *range;
+    }
+
+    plan->count = count;
+    plan->bytes = 0;
+    for (int i = 0; i < count; i++) {
+        plan->bytes += plan->ranges[i].length;
+    }
+}
+
+// Stesso inizio: stessa partizione vista dalla tabella su disco e dal kernel
+static void add_partition(plan_ctx_t *ctx, int number, size_t start, size_t size) {
+    if (size == 0 || start >= ctx->disk_size || size > ctx->disk_size - start) {
+        return;
+    }
+    for (int i = 0; i < ctx->partition_count; i++) {
+        if (ctx->partitions[i].start == start) {
+            return;
+        }
+    }
+    if (ctx->partition_count < METADATA_MAX_PARTITIONS) {
+        partition_t *partition = &ctx->partitions[ctx->partition_count++];
+        partition->number = number;
+        partition->start = start;
+        partition->size = size;
+    }
+}
+
+static int read_gpt_header(plan_ctx_t *ctx, uint64_t lba, gpt_header_t *header) {
+    const unsigned char *block = ctx->buffer;
+
+    if (lba == 0 || lba >= ctx->aligned_size / ctx->block_size ||
+        read_exact(ctx->fd, ctx->buffer, ctx->block_size, (size_t)lba * ctx->block_size) != 0 ||
+        memcmp(block, GPT_SIGNATURE, 8) != 0) {
+        return -1;
+    }
+
+    header->alternate_lba = le64(block + 32);
+    header->entries_lba = le64(block + 72);
+    header->entry_count = le32(block + 80);
+    header->entry_size = le32(block + 84);
+
+    uint64_t entries_size = (uint64_t)header->entry_count * header->entry_size;
+    if (header->entry_size < 128 || entries_size == 0 || entries_size > GPT_MAX_ENTRIES_SIZE ||
+        header->entries_lba >= ctx->aligned_size / ctx->block_size ||
+        entries_size > ctx->aligned_size - header->entries_lba * ctx->block_size) {
+        return -1;
+    }
+    return 0;
+}
+
+// Intestazione e array delle voci; con entries != 0 aggiunge anche le partizioni
+static void add_gpt(plan_ctx_t *ctx, uint64_t lba, const gpt_header_t *header, const char *which, int entries) {
+    char label[64];
+    size_t entries_size = (size_t)header->entry_count * header->entry_size;
+
+    snprintf(label, sizeof(label), "GPT %s header", which);
+    add_range(ctx, (size_t)lba * ctx->block_size, ctx->block_size, label);
+    snprintf(label, sizeof(label), "GPT %s entries", which);
+    add_range(ctx, (size_t)header->entries_lba * ctx->block_size, entries_size, label);
+
+    if (!entries) {
+        return;
+    }
+
+    size_t read_size = entries_size + (ctx->block_size - entries_size % ctx->block_size) % ctx->block_size;
+    void *table;
+    if (posix_memalign(&table, ctx->block_size < 4096 ? 4096 : ctx->block_size, read_size) != 0) {
+        perror("posix_memalign");
+        return;
+    }
+    if (read_exact(ctx->fd, table, read_size, (size_t)header->entries_lba * ctx->block_size) == 0) {
+        static const unsigned char unused[16] = {0};
+        for (uint32_t i = 0; i < header->entry_count; i++) {
+            const unsigned char *entry = (const unsigned char *)table + (size_t)i * header->entry_size;
+            uint64_t first = le64(entry + 32);
+            uint64_t last = le64(entry + 40);
+            if (memcmp(entry, unused, sizeof(unused)) == 0 || last < first) {
+                continue;
+            }
+            add_partition(ctx, (int)i + 1, (size_t)first * ctx->block_size,
+                          (size_t)(last - first + 1) * ctx->block_size);
+        }
+    }
+    free(table);
+}
+
+// GPT primaria e di backup; le partizioni dalla prima copia valida. Ritorna 0 se ne ha trovata una.
+static int scan_gpt(plan_ctx_t *ctx) {
+    gpt_header_t primary, backup;
+    uint64_t last_lba = ctx->aligned_size / ctx->block_size - 1;
+    int have_primary = read_gpt_header(ctx, 1, &primary) == 0;
+    uint64_t backup_lba = have_primary ? primary.alternate_lba : last_lba;
+    int have_backup = read_gpt_header(ctx, backup_lba, &backup) == 0;
+
+    if (!have_backup && backup_lba != last_lba) {
+        backup_lba = last_lba;
+        have_backup = read_gpt_header(ctx, backup_lba, &backup) == 0;
+    }
+    if (have_primary) {
+        add_gpt(ctx, 1, &primary, "primary", 1);
+    }
+    if (have_backup) {
+        add_gpt(ctx, backup_lba, &backup, "backup", !have_primary);
+    }
+    return have_primary || have_backup ? 0 : -1;
+}
+
+// Le quattro voci primarie; le logiche di una estesa arrivano dal kernel
+static int scan_mbr(plan_ctx_t *ctx) {
+    const unsigned char *block = ctx->buffer;
+
+    if (read_exact(ctx->fd, ctx->buffer, ctx->block_size, 0) != 0 || block[510] != 0x55 || block[511] != 0xAA) {
+        return -1;
+    }
+
+    int found = 0;
+    for (int i = 0; i < 4; i++) {
+        const unsigned char *entry = block + MBR_PARTITION_OFFSET + i * 16;
+        uint32_t start = le32(entry + 8);
+        uint32_t sectors = le32(entry + 12);
+        if (entry[4] == 0 || entry[4] == MBR_GPT_PROTECTIVE || start == 0 || sectors == 0) {
+            continue;
+        }
+        int before = ctx->partition_count;
+        add_partition(ctx, i + 1, (size_t)start * ctx->block_size, (size_t)sectors * ctx->block_size);
+        found += ctx->partition_count > before;
+    }
+    return found > 0 ? 0 : -1;
+}
+
+// Inizio, fine e copie btrfs di un intervallo lungo size a partire da start
+static void add_volume(plan_ctx_t *ctx, size_t start, size_t size, const char *name) {
+    char label[64];
+
+    snprintf(label, sizeof(label), "%s start", name);
+    add_range(ctx, start, size < METADATA_EDGE_SIZE ? size : METADATA_EDGE_SIZE, label);
+    if (size > METADATA_EDGE_SIZE) {
+        snprintf(label, sizeof(label), "%s end", name);
+        add_range(ctx, start + size - METADATA_EDGE_SIZE, METADATA_EDGE_SIZE, label);
+    }
+    for (size_t i = 0; i < sizeof(btrfs_mirrors) / sizeof(btrfs_mirrors[0]); i++) {
+        if (btrfs_mirrors[i] + BTRFS_SUPER_SIZE <= size) {
+            snprintf(label, sizeof(label), "%s btrfs mirror", name);
+            add_range(ctx, start + btrfs_mirrors[i], BTRFS_SUPER_SIZE, label);
+        }
+    }
+}
+
+int metadata_plan(int fd, const char *disk_path, size_t disk_size, size_t block_size, metadata_plan_t *plan) {
+    plan_ctx_t *ctx = calloc(1, sizeof(plan_ctx_t));
+    if (!ctx) {
+        perror("calloc");
+        return -1;
+    }
+
+    memset(plan, 0, sizeof(*plan));
+    ctx->fd = fd;
+    ctx->disk_size = disk_size;
+    ctx->block_size = block_size > 0 ? block_size : 512;
+    ctx->aligned_size = disk_size - disk_size % ctx->block_size;
+    ctx->plan = plan;
+    if (ctx->aligned_size == 0 ||
+        posix_memalign(&ctx->buffer, ctx->block_size < 4096 ? 4096 : ctx->block_size, ctx->block_size) != 0) {
+        fprintf(stderr, "ERROR: Cannot plan the metadata wipe of %s\n", disk_path);
+        free(ctx);
+        return -1;
+    }
+
+    // Un device senza tabella può contenere direttamente un filesystem, un membro md o un PV LVM
+    add_volume(ctx, 0, ctx->aligned_size, "device");
+
+    if (scan_gpt(ctx) == 0) {
+        snprintf(plan->table, sizeof(plan->table), "GPT");
+    } else if (scan_mbr(ctx) == 0) {
+        snprintf(plan->table, sizeof(plan->table), "MBR");
+    } else {
+        snprintf(plan->table, sizeof(plan->table), "none");
+    }
+
+    sysfs_partition_t kernel[METADATA_MAX_PARTITIONS];
+    int kernel_count = sysfs_partitions(disk_path, kernel, METADATA_MAX_PARTITIONS);
+    for (int i = 0; i < kernel_count; i++) {
+        add_partition(ctx, kernel[i].number, kernel[i].start, kernel[i].size);
+    }
+
+    for (int i = 0; i < ctx->partition_count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "partition %d", ctx->partitions[i].number);
+        add_volume(ctx, ctx->partitions[i].start, ctx->partitions[i].size, name);
+    }
+
+    plan->partitions = ctx->partition_count;
+    merge_ranges(plan);
+
+    free(ctx->buffer);
+    free(ctx);
+    return 0;
+}
+
+int metadata_wipe(int fd, io_engine_t engine, const metadata_plan_t *plan, progress_info_t *progress) {
+    unsigned int count = 0;
+
+    for (int i = 0; i < plan->count; i++) {
+        count += (unsigned int)((plan->ranges[i].length + METADATA_EDGE_SIZE - 1) / METADATA_EDGE_SIZE);
+    }
+
+    // Un buffer di zeri condiviso da tutte le richieste, ognuna al massimo METADATA_EDGE_SIZE byte
+    void *zeros = NULL;
+    io_extent_t *extents = calloc(count > 0 ? count : 1, sizeof(io_extent_t));
+    if (!extents || posix_memalign(&zeros, 4096, METADATA_EDGE_SIZE) != 0) {
+        perror("posix_memalign");
+        free(extents);
+        return -1;
+    }
+    memset(zeros, 0, METADATA_EDGE_SIZE);
+
+    unsigned int n = 0;
+    for (int i = 0; i < plan->count; i++) {
+        for (size_t done = 0; done < plan->ranges[i].length; done += METADATA_EDGE_SIZE) {
+            size_t left = plan->ranges[i].length - done;
+            extents[n].offset = plan->ranges[i].offset + done;
+            extents[n].length = left < METADATA_EDGE_SIZE ? left : METADATA_EDGE_SIZE;
+            n++;
+        }
+    }
+
+    int result = io_write_extents(fd, engine, extents, n, zeros, progress);
+
+    free(zeros);
+    free(extents);
+    return result;
+}
+
+void metadata_print(const metadata_plan_t *plan) {
+    char size_str[32];
+
+    format_bytes(plan->bytes, size_str, sizeof(size_str));
+    printf("Cleared %d range(s), %s (partition table: %s, %d partition(s)):\n", plan->count, size_str, plan->table,
+           plan->partitions);
+    for (int i = 0; i < plan->count; i++) {
+        const metadata_range_t *range = &plan->ranges[i];
+        format_bytes(range->length, size_str, sizeof(size_str));
+        printf("  %15zu - %-15zu %10s  %s\n", range->offset, range->offset + range->length, size_str, range->label);
+    }
+}
+
+void metadata_log(const metadata_plan_t *plan, const char *disk_path) {
+    log_message("Quick wipe of %s: %d range(s), %zu bytes cleared, partition table %s, %d partition(s)", disk_path,
+                plan->count, plan->bytes, plan->table, plan->partitions);
+    for (int i = 0; i < plan->count; i++) {
+        const metadata_range_t *range = &plan->ranges[i];
+        log_message("Quick wipe: cleared [%zu, %zu) %s", range->offset, range->offset + range->length, range->label);
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef METADATA_H
+#define METADATA_H
+
+#include <stddef.h>
+#include "io_engine.h"
+#include "progress.h"
+
+// Cancellazione rapida: solo le posizioni note di tabelle delle partizioni e firme, su device e partizioni.
+//   primo MiB  MBR, GPT primaria, md 1.1/1.2, LVM, ZFS L0/L1, superblock dei filesystem
+//   ultimo MiB GPT di backup, md 0.90/1.0, ZFS L2/L3
+// più le copie del superblock btrfs e le tabelle GPT che stanno fuori da queste regioni.
+#define METADATA_EDGE_SIZE (1024 * 1024)          // byte cancellati all'inizio e alla fine
+#define METADATA_MAX_RANGES 512
+#define METADATA_MAX_PARTITIONS 128
+#define METADATA_LABEL_SIZE 128
+
+typedef struct {
+    size_t offset;
+    size_t length;
+    char label[METADATA_LABEL_SIZE]; // cosa si trova nell'intervallo, es. "partition 1 start, btrfs mirror"
+} metadata_range_t;
+
+typedef struct metadata_plan {
+    metadata_range_t ranges[METADATA_MAX_RANGES]; // ordinati per offset, senza sovrapposizioni
+    int count;
+    size_t bytes;          // somma delle lunghezze
+    int partitions;        // partizioni trovate (tabella su disco e kernel)
+    char table[16];        // "GPT", "MBR" o "none"
+} metadata_plan_t;
+
+// Calcola gli intervalli da cancellare leggendo da fd (aperto in lettura) la tabella delle partizioni
+// (GPT primaria o di backup, MBR) e le partizioni note al kernel. Intervalli allineati a block_size.
+// Ritorna 0 o -1.
+int metadata_plan(int fd, const char *disk_path, size_t disk_size, size_t block_size, metadata_plan_t *plan);
+// Scrive zeri su tutti gli intervalli in un unico insieme di richieste.
+// Ritorna 0 se completato, -1 in caso di errore, -2 se interrotto.
+int metadata_wipe(int fd, io_engine_t engine, const metadata_plan_t *plan, progress_info_t *progress);
+void metadata_print(const metadata_plan_t *plan);
+void metadata_log(const metadata_plan_t *plan, const char *disk_path);
+
+#endif // METADATA_H
@@ -0,0 +1,226 @@
+#define _GNU_SOURCE
+
+#include "numa.h"
+#include "sysfs.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+#define BITS_PER_WORD (8 * sizeof(unsigned long))
+#define NUMA_MPOL_PREFERRED 1 // linux/mempolicy.h
+
+#ifdef __linux__
+static void set_bit(unsigned long *mask, int bit) {
+    mask[bit / BITS_PER_WORD] |= 1UL << (bit % BITS_PER_WORD);
+}
+
+static int test_bit(const unsigned long *mask, int bit) {
+    return (mask[bit / BITS_PER_WORD] >> (bit % BITS_PER_WORD)) & 1;
+}
+
+// Lista nel formato di sysfs ("0-7,16-23") in una maschera di max bit; ritorna i bit impostati o -1
+static int parse_list(const char *text, unsigned long *mask, int max) {
+    int count = 0;
+
+    while (*text != '\0' && *text != '\n') {
+        char *end;
+        long first = strtol(text, &end, 10);
+        long last = first;
+        if (end == text || first < 0) {
+            return -1;
+        }
+        if (*end == '-') {
+            text = end + 1;
+            last = strtol(text, &end, 10);
+            if (end == text || last < first) {
+                return -1;
+            }
+        }
+        for (long i = first; i <= last && i < max; i++) {
+            set_bit(mask, (int)i);
+            count++;
+        }
+        text = *end == ',' ? end + 1 : end;
+    }
+
+    return count;
+}
+
+// Maschera di nuovo in formato lista
+static void format_list(const unsigned long *mask, int max, char *buffer, size_t size) {
+    size_t used = 0;
+
+    buffer[0] = '\0';
+    for (int i = 0; i < max; i++) {
+        if (!test_bit(mask, i)) {
+            continue;
+        }
+        int last = i;
+        while (last + 1 < max && test_bit(mask, last + 1)) {
+            last++;
+        }
+
+        int written = last > i ? snprintf(buffer + used, size - used, "%s%d-%d", used > 0 ? "," : "", i, last)
+                               : snprintf(buffer + used, size - used, "%s%d", used > 0 ? "," : "", i);
+        if (written < 0 || (size_t)written >= size - used) {
+            break; // troncata: la lista resta valida fino all'ultimo intervallo completo
+        }
+        used += (size_t)written;
+        i = last;
+    }
+}
+
+static int read_line(const char *path, char *buffer, size_t size) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+    int result = fgets(buffer, (int)size, fp) ? 0 : -1;
+    fclose(fp);
+    return result;
+}
+
+// numa_node del device o del primo antenato che lo conosce (controller PCI dietro SCSI, SATA e NVMe)
+static int device_node(const char *disk_path) {
+    char name[NAME_MAX + 1], path[PATH_MAX + 16], resolved[PATH_MAX];
+
+    if (sysfs_device_name(disk_path, name, sizeof(name)) != 0) {
+        return -1;
+    }
+    snprintf(path, sizeof(path), "/sys/class/block/%s", name);
+    if (!realpath(path, resolved)) {
+        return -1;
+    }
+
+    // Il percorso reale passa per tutti gli antenati: /sys/devices/pci0000:00/0000:00:1f.2/ata1/.../block/sda/sda1
+    for (;;) {
+        char value[32];
+        snprintf(path, sizeof(path), "%s/numa_node", resolved);
+        if (read_line(path, value, sizeof(value)) == 0 && atoi(value) >= 0) {
+            return atoi(value);
+        }
+
+        char *slash = strrchr(resolved, '/');
+        if (!slash || slash == resolved || strcmp(resolved, "/sys/devices") == 0) {
+            return -1;
+        }
+        *slash = '\0';
+    }
+}
+#endif
+
+void numa_plan(const char *disk_path, numa_placement_t *placement) {
+    memset(placement, 0, sizeof(*placement));
+    placement->node = -1;
+    placement->reason = "not supported on this platform";
+
+#ifdef __linux__
+    char line[4096];
+    unsigned long nodes[NUMA_MAX_NODES / BITS_PER_WORD] = {0};
+
+    if (read_line("/sys/devices/system/node/online", line, sizeof(line)) == 0) {
+        placement->node_count = parse_list(line, nodes, NUMA_MAX_NODES);
+    }
+    placement->node = device_node(disk_path);
+
+    if (placement->node_count <= 1) {
+        placement->reason = "single NUMA node";
+        return;
+    }
+    if (placement->node < 0) {
+        placement->reason = "device NUMA node unknown";
+        return;
+    }
+    if (placement->node >= NUMA_MAX_NODES) {
+        placement->reason = "device NUMA node out of range";
+        return;
+    }
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", placement->node);
+    if (read_line(path, line, sizeof(line)) != 0 || parse_list(line, placement->cpus, NUMA_MAX_CPUS) <= 0) {
+        placement->reason = "node has no CPUs";
+        return;
+    }
+
+    // Solo le CPU concesse al processo (taskset, cgroup cpuset)
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (int cpu = 0; cpu < NUMA_MAX_CPUS; cpu++) {
+            if (test_bit(placement->cpus, cpu) && (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed))) {
+                placement->cpus[cpu / BITS_PER_WORD] &= ~(1UL << (cpu % BITS_PER_WORD));
+            }
+        }
+    }
+    for (int cpu = 0; cpu < NUMA_MAX_CPUS; cpu++) {
+        placement->cpu_count += test_bit(placement->cpus, cpu);
+    }
+    if (placement->cpu_count == 0) {
+        placement->reason = "no allowed CPU on the node";
+        return;
+    }
+
+    format_list(placement->cpus, NUMA_MAX_CPUS, placement->cpulist, sizeof(placement->cpulist));
+    placement->pinned = 1;
+    placement->reason = NULL;
+#else
+    (void)disk_path;
+#endif
+}
+
+int numa_apply(const numa_placement_t *placement, const char *disk_path) {
+    if (!placement->pinned) {
+        log_message("NUMA: %s not pinned (%s)", disk_path, placement->reason);
+        return 0;
+    }
+
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < NUMA_MAX_CPUS && cpu < CPU_SETSIZE; cpu++) {
+        if (test_bit(placement->cpus, cpu)) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        log_message("NUMA: cannot pin %s to CPUs %s: %s", disk_path, placement->cpulist, strerror(errno));
+        return -1;
+    }
+
+    // Memoria preferita, non vincolata: con il nodo pieno le pagine vanno altrove invece di fallire
+    unsigned long nodes[NUMA_MAX_NODES / BITS_PER_WORD] = {0};
+    set_bit(nodes, placement->node);
+    if (syscall(SYS_set_mempolicy, NUMA_MPOL_PREFERRED, nodes, (unsigned long)NUMA_MAX_NODES + 1) != 0) {
+        log_message("NUMA: %s pinned to CPUs %s, memory policy not set: %s", disk_path, placement->cpulist,
+                    strerror(errno));
+        return 0;
+    }
+
+    log_message("NUMA: %s on node %d, writers on CPUs %s, buffers from node %d", disk_path, placement->node,
+                placement->cpulist, placement->node);
+    return 0;
+#else
+    return 0;
+#endif
+}
+
+char *numa_describe(const numa_placement_t *placement, char *buffer, size_t size) {
+    if (placement->pinned) {
+        snprintf(buffer, size, "NUMA node %d, writers on CPUs %s, buffers from node %d", placement->node,
+                 placement->cpulist, placement->node);
+    } else if (placement->node >= 0) {
+        snprintf(buffer, size, "NUMA node %d, not pinned (%s)", placement->node, placement->reason);
+    } else {
+        snprintf(buffer, size, "not pinned (%s)", placement->reason);
+    }
+    return buffer;
+}
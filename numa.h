@@ -0,0 +1,31 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <stddef.h>
+
+// Posizionamento NUMA di un device: i thread che lo scrivono girano sulle CPU del nodo del suo
+// controller e ne allocano i buffer dalla memoria locale, così il DMA non attraversa il link tra
+// i socket. Da /sys senza libnuma; solo Linux, altrove il device resta senza posizionamento.
+#define NUMA_MAX_CPUS 1024
+#define NUMA_MAX_NODES 64
+#define NUMA_CPULIST_SIZE 128
+
+typedef struct {
+    int node;              // nodo del controller (numa_node del primo antenato che lo dichiara), -1 se ignoto
+    int node_count;        // nodi online
+    int cpu_count;         // CPU del nodo su cui il processo può girare
+    char cpulist[NUMA_CPULIST_SIZE]; // le stesse nel formato di sysfs, es. "0-7,16-23"
+    int pinned;            // posizionamento da applicare: più nodi, nodo noto e CPU disponibili
+    const char *reason;    // perché non si applica (pinned = 0)
+    unsigned long cpus[NUMA_MAX_CPUS / (8 * sizeof(unsigned long))];
+} numa_placement_t;
+
+// Nodo del device e CPU locali; non fallisce, al più il device resta senza posizionamento
+void numa_plan(const char *disk_path, numa_placement_t *placement);
+// Lega il thread corrente alle CPU del nodo e ne preferisce la memoria; i thread creati dopo
+// (writer, produttori dei pattern, verifica) ereditano entrambe. Ritorna 0 o -1.
+int numa_apply(const numa_placement_t *placement, const char *disk_path);
+// Riga del report, es. "NUMA node 1, writers on CPUs 8-15,24-31, buffers from node 1"
+char *numa_describe(const numa_placement_t *placement, char *buffer, size_t size);
+
+#endif // NUMA_H
@@ -0,0 +1,175 @@
+#define _GNU_SOURCE
+
+#include "offload.h"
+#include "sysfs.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+// Variabile globale per gestire interruzioni
+extern volatile sig_atomic_t interrupted;
+
+int wipe_method_from_name(const char *name, wipe_method_t *method) {
+    if (strcasecmp(name, "overwrite") == 0) {
+        *method = WIPE_METHOD_OVERWRITE;
+        return 0;
+    }
+    if (strcasecmp(name, "zeroout") == 0) {
+        *method = WIPE_METHOD_ZEROOUT;
+        return 0;
+    }
+    if (strcasecmp(name, "discard") == 0) {
+        *method = WIPE_METHOD_DISCARD;
+        return 0;
+    }
+    if (strcasecmp(name, "secdiscard") == 0) {
+        *method = WIPE_METHOD_SECDISCARD;
+        return 0;
+    }
+    if (strcasecmp(name, "quick") == 0) {
+        *method = WIPE_METHOD_QUICK;
+        return 0;
+    }
+    if (strcasecmp(name, "zonereset") == 0) {
+        *method = WIPE_METHOD_ZONERESET;
+        return 0;
+    }
+    return -1;
+}
+
+const char *wipe_method_name(wipe_method_t method) {
+    switch (method) {
+        case WIPE_METHOD_OVERWRITE:
+            return "overwrite";
+        case WIPE_METHOD_ZEROOUT:
+            return "zeroout";
+        case WIPE_METHOD_DISCARD:
+            return "discard";
+        case WIPE_METHOD_SECDISCARD:
+            return "secdiscard";
+        case WIPE_METHOD_QUICK:
+            return "quick";
+        case WIPE_METHOD_ZONERESET:
+            return "zonereset";
+    }
+    return "unknown";
+}
+
+const char *wipe_method_ioctl(wipe_method_t method) {
+    switch (method) {
+        case WIPE_METHOD_OVERWRITE:
+            return "write";
+        case WIPE_METHOD_ZEROOUT:
+            return "BLKZEROOUT";
+        case WIPE_METHOD_DISCARD:
+            return "BLKDISCARD";
+        case WIPE_METHOD_SECDISCARD:
+            return "BLKSECDISCARD";
+        case WIPE_METHOD_QUICK:
+            return "write";
+        case WIPE_METHOD_ZONERESET:
+            return "BLKRESETZONE";
+    }
+    return "unknown";
+}
+
+void offload_detect(const char *disk_path, offload_caps_t *caps) {
+    memset(caps, 0, sizeof(*caps));
+
+    // Attributi assenti (kernel vecchi, macOS) equivalgono a "non supportato"
+    sysfs_queue_u64(disk_path, "discard_max_bytes", &caps->discard_max_bytes);
+    sysfs_queue_u64(disk_path, "discard_granularity", &caps->discard_granularity);
+    sysfs_queue_u64(disk_path, "write_zeroes_max_bytes", &caps->write_zeroes_max_bytes);
+}
+
+int offload_supported(const offload_caps_t *caps, wipe_method_t method) {
+#ifdef __linux__
+    switch (method) {
+        case WIPE_METHOD_OVERWRITE:
+            return 1;
+        case WIPE_METHOD_ZEROOUT:
+            // Senza WRITE ZEROES il kernel emulerebbe BLKZEROOUT scrivendo pagine di zeri:
+            // il motore di scrittura fa lo stesso lavoro con progress e tuning migliori
+            return caps->write_zeroes_max_bytes > 0;
+        case WIPE_METHOD_DISCARD:
+        case WIPE_METHOD_SECDISCARD:
+            // Il secure discard non ha un attributo in sysfs: si prova e si ripiega su EOPNOTSUPP
+            return caps->discard_max_bytes > 0;
+        case WIPE_METHOD_QUICK:
+        case WIPE_METHOD_ZONERESET: // eseguito da wipe_disk() con zoned.h, non da offload_range()
+            return 0;
+    }
+    return 0;
+#else
+    (void)caps;
+    return method == WIPE_METHOD_OVERWRITE;
+#endif
+}
+
+int offload_range(int fd, wipe_method_t method, size_t start, size_t length, size_t alignment,
+                  progress_info_t *progress) {
+#ifdef __linux__
+    unsigned long request;
+
+    switch (method) {
+        case WIPE_METHOD_ZEROOUT:
+            request = BLKZEROOUT;
+            break;
+        case WIPE_METHOD_DISCARD:
+            request = BLKDISCARD;
+            break;
+        case WIPE_METHOD_SECDISCARD:
+            request = BLKSECDISCARD;
+            break;
+        default:
+            return 1;
+    }
+
+    // Chunk multipli del blocco logico, come richiesto dagli ioctl
+    size_t chunk = OFFLOAD_CHUNK_SIZE - OFFLOAD_CHUNK_SIZE % alignment;
+    size_t offset = start;
+    size_t end = start + length;
+
+    while (offset < end) {
+        if (interrupted) {
+            return -2;
+        }
+
+        size_t count = end - offset > chunk ? chunk : end - offset;
+        uint64_t range[2] = {offset, count};
+
+        if (ioctl(fd, request, range) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Comando non supportato dal device: ripiego possibile solo se non si è cancellato nulla
+            if ((errno == EOPNOTSUPP || errno == ENOTTY || errno == EINVAL) && offset == start) {
+                return 1;
+            }
+            perror(wipe_method_ioctl(method));
+            return -1;
+        }
+
+        offset += count;
+        progress_update(progress, count);
+    }
+
+    return 0;
+#else
+    (void)fd;
+    (void)method;
+    (void)start;
+    (void)length;
+    (void)alignment;
+    (void)progress;
+    return 1;
+#endif
+}
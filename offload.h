@@ -0,0 +1,40 @@
+#ifndef OFFLOAD_H
+#define OFFLOAD_H
+
+#include <stddef.h>
+#include "progress.h"
+
+#define OFFLOAD_CHUNK_SIZE (256ULL * 1024 * 1024) // byte per ioctl: progress e interruzione restano reattivi
+
+// Metodo di cancellazione: sovrascrittura con lo schema o comando delegato al kernel/dispositivo
+typedef enum {
+    WIPE_METHOD_OVERWRITE = 0, // passate dello schema scritte con il motore di I/O
+    WIPE_METHOD_ZEROOUT,       // BLKZEROOUT (WRITE ZEROES / WRITE SAME)
+    WIPE_METHOD_DISCARD,       // BLKDISCARD (TRIM / UNMAP)
+    WIPE_METHOD_SECDISCARD,    // BLKSECDISCARD (secure erase dei blocchi)
+    WIPE_METHOD_QUICK,         // solo tabelle delle partizioni e firme (metadata.h), non è un'offload
+    WIPE_METHOD_ZONERESET      // BLKRESETZONE delle zone sequenziali di un device a zone (zoned.h)
+} wipe_method_t;
+
+// Capacità lette da /sys/block/<dev>/queue
+typedef struct {
+    unsigned long long discard_max_bytes;
+    unsigned long long discard_granularity;
+    unsigned long long write_zeroes_max_bytes;
+} offload_caps_t;
+
+int wipe_method_from_name(const char *name, wipe_method_t *method);
+const char *wipe_method_name(wipe_method_t method);
+// Nome dell'ioctl usato dal metodo (per log e piano)
+const char *wipe_method_ioctl(wipe_method_t method);
+
+void offload_detect(const char *disk_path, offload_caps_t *caps);
+int offload_supported(const offload_caps_t *caps, wipe_method_t method);
+
+// Applica il metodo a [start, start + length) a blocchi di OFFLOAD_CHUNK_SIZE.
+// Ritorna 0 se completato, 1 se il device rifiuta il comando prima di aver cancellato
+// qualcosa (ripiegare sulla sovrascrittura), -1 in caso di errore, -2 se interrotto.
+int offload_range(int fd, wipe_method_t method, size_t start, size_t length, size_t alignment,
+                  progress_info_t *progress);
+
+#endif // OFFLOAD_H
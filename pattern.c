@@ -0,0 +1,467 @@
+#define _GNU_SOURCE
+
+#include "pattern.h"
+#include "prng.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#define PASS_ZERO {PATTERN_BYTE, 0x00, 0}
+#define PASS_ONES {PATTERN_BYTE, 0xFF, 0}
+#define PASS_RANDOM {PATTERN_RANDOM, 0x00, 0}
+
+typedef struct {
+    const char *name;
+    const char *description;
+    int pass_count;
+    pattern_pass_t passes[PATTERN_MAX_PASSES];
+} scheme_def_t;
+
+static const scheme_def_t schemes[] = {
+    {"zero", "single pass of zeros (default)", 1, {PASS_ZERO}},
+    {"ones", "single pass of 0xFF", 1, {PASS_ONES}},
+    {"random", "single pass of random data", 1, {PASS_RANDOM}},
+    {"random-zero", "random data, then zeros", 2, {PASS_RANDOM, PASS_ZERO}},
+    {"dod", "DoD 5220.22-M: 0x00, 0xFF, random", 3, {PASS_ZERO, PASS_ONES, PASS_RANDOM}},
+    {"dod-ece", "DoD 5220.22-M ECE 7-pass", 7,
+     {PASS_ZERO, PASS_ONES, PASS_RANDOM, PASS_RANDOM, PASS_ZERO, PASS_ONES, PASS_RANDOM}},
+};
+
+static int parse_pass(const char *token, pattern_pass_t *pass) {
+    if (strcasecmp(token, "zero") == 0 || strcasecmp(token, "zeros") == 0) {
+        *pass = (pattern_pass_t)PASS_ZERO;
+        return 0;
+    }
+    if (strcasecmp(token, "ones") == 0) {
+        *pass = (pattern_pass_t)PASS_ONES;
+        return 0;
+    }
+    if (strcasecmp(token, "random") == 0) {
+        *pass = (pattern_pass_t)PASS_RANDOM;
+        return 0;
+    }
+
+    // Byte fisso in esadecimale (0xAA)
+    char *end;
+    unsigned long value = strtoul(token, &end, 16);
+    if (strncasecmp(token, "0x", 2) == 0 && *end == '\0' && end != token + 2 && value <= 0xFF) {
+        pass->kind = PATTERN_BYTE;
+        pass->byte = (unsigned char)value;
+        pass->seed = 0;
+        return 0;
+    }
+
+    return -1;
+}
+
+int scheme_from_name(const char *name, wipe_scheme_t *scheme) {
+    for (size_t i = 0; i < sizeof(schemes) / sizeof(schemes[0]); i++) {
+        if (strcasecmp(name, schemes[i].name) == 0) {
+            snprintf(scheme->name, sizeof(scheme->name), "%s", schemes[i].name);
+            scheme->pass_count = schemes[i].pass_count;
+            memcpy(scheme->passes, schemes[i].passes, sizeof(scheme->passes));
+            return 0;
+        }
+    }
+
+    // Schema personalizzato: lista di passate separate da virgole
+    char list[256];
+    snprintf(list, sizeof(list), "%s", name);
+    scheme->pass_count = 0;
+
+    char *saveptr = NULL;
+    for (char *token = strtok_r(list, ",", &saveptr); token; token = strtok_r(NULL, ",", &saveptr)) {
+        if (scheme->pass_count >= PATTERN_MAX_PASSES || parse_pass(token, &scheme->passes[scheme->pass_count]) != 0) {
+            return -1;
+        }
+        scheme->pass_count++;
+    }
+
+    if (scheme->pass_count == 0) {
+        return -1;
+    }
+
+    snprintf(scheme->name, sizeof(scheme->name), "%.63s", name);
+    return 0;
+}
+
+void scheme_print_available(void) {
+    for (size_t i = 0; i < sizeof(schemes) / sizeof(schemes[0]); i++) {
+        printf("    %-12s %s\n", schemes[i].name, schemes[i].description);
+    }
+    printf("    or a comma-separated list of passes: zero, ones, random, 0xNN\n");
+}
+
+char *pattern_describe(const pattern_pass_t *pass, char *buffer, size_t buffer_size) {
+    if (pass->kind == PATTERN_RANDOM) {
+        snprintf(buffer, buffer_size, "random");
+    } else {
+        snprintf(buffer, buffer_size, "0x%02X", pass->byte);
+    }
+    return buffer;
+}
+
+void scheme_set_seed(wipe_scheme_t *scheme, uint64_t seed) {
+    for (int i = 0; i < scheme->pass_count; i++) {
+        scheme->passes[i].seed = seed + (uint64_t)i * 0xD1B54A32D192ED03ULL;
+    }
+}
+
+void pattern_fill(const pattern_pass_t *pass, uint64_t offset, void *buffer, size_t length) {
+    if (pass->kind == PATTERN_BYTE) {
+        memset(buffer, pass->byte, length);
+        return;
+    }
+
+    prng_key_t key;
+    prng_key_init(&key, pass->seed);
+    prng_fill(&key, offset, buffer, length);
+}
+
+static pthread_mutex_t shared_lock = PTHREAD_MUTEX_INITIALIZER;
+static void *shared_pages[256];
+
+// Regione allineata a PATTERN_SHARED_SIZE: hugetlb se ci sono huge page riservate, altrimenti
+// pagine anonime con MADV_HUGEPAGE (una huge page trasparente se il kernel la concede)
+static void *shared_map(const char **backing) {
+    void *page;
+
+#ifdef MAP_HUGETLB
+    page = mmap(NULL, PATTERN_SHARED_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (page != MAP_FAILED) {
+        *backing = "hugetlb page";
+        return page;
+    }
+#endif
+
+    // Il doppio della dimensione per poter tagliare testa e coda non allineate
+    char *area = mmap(NULL, 2 * PATTERN_SHARED_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED) {
+        return NULL;
+    }
+    size_t head = (PATTERN_SHARED_SIZE - (uintptr_t)area % PATTERN_SHARED_SIZE) % PATTERN_SHARED_SIZE;
+    if (head > 0) {
+        munmap(area, head);
+    }
+    munmap(area + head + PATTERN_SHARED_SIZE, PATTERN_SHARED_SIZE - head);
+    page = area + head;
+
+    *backing = "base pages";
+#ifdef MADV_HUGEPAGE
+    if (madvise(page, PATTERN_SHARED_SIZE, MADV_HUGEPAGE) == 0) {
+        *backing = "transparent huge page";
+    }
+#endif
+    return page;
+}
+
+const void *pattern_shared(unsigned char byte) {
+    pthread_mutex_lock(&shared_lock);
+
+    if (!shared_pages[byte]) {
+        const char *backing = NULL;
+        void *page = shared_map(&backing);
+        if (!page) {
+            log_message("Shared pattern page 0x%02X not allocated: %s", byte, strerror(errno));
+        } else {
+            // Le pagine anonime mai scritte si leggono come la zero page del kernel: per gli zeri
+            // non si tocca nulla e la regione non occupa memoria
+            if (byte != 0x00) {
+                memset(page, byte, PATTERN_SHARED_SIZE);
+            }
+            // Senza la protezione la regione non è quella promessa ai writer: meglio i buffer propri
+            if (mprotect(page, PATTERN_SHARED_SIZE, PROT_READ) != 0) {
+                log_message("Shared pattern page 0x%02X not read-only (%s), using per-buffer fills", byte,
+                            strerror(errno));
+                munmap(page, PATTERN_SHARED_SIZE);
+            } else {
+                shared_pages[byte] = page;
+                log_message("Shared pattern page 0x%02X: %d KB, %s, read-only", byte, PATTERN_SHARED_SIZE / 1024,
+                            backing);
+            }
+        }
+    }
+
+    const void *page = shared_pages[byte];
+    pthread_mutex_unlock(&shared_lock);
+    return page;
+}
+
+int pattern_shared_iov(const void *page, size_t length, struct iovec *iov, int max) {
+    int count = 0;
+
+    while (length > 0 && count < max) {
+        size_t piece = length < PATTERN_SHARED_SIZE ? length : PATTERN_SHARED_SIZE;
+        iov[count].iov_base = (void *)page;
+        iov[count].iov_len = piece;
+        length -= piece;
+        count++;
+    }
+
+    return count;
+}
+
+struct pattern_pipeline {
+    pattern_pass_t pass;
+    int fd;             // device da leggere (pipeline in lettura), -1 altrimenti
+    size_t end;
+    size_t chunk_size;
+    unsigned int count;
+    void **buffers;
+
+    // Buffer liberi (restituiti in qualsiasi ordine)
+    unsigned int *free_list;
+    unsigned int free_count;
+
+    // FIFO dei chunk pronti, in ordine di offset
+    unsigned int *ready;
+    size_t *ready_offset;
+    size_t *ready_length;
+    unsigned int ready_head;
+    unsigned int ready_count;
+
+    size_t next_offset; // prossimo chunk da generare (o da consegnare, per i pattern fissi)
+    int threaded;       // solo i pattern casuali e le letture hanno un produttore
+    int shared;         // pattern fisso: tutti i buffer sono la pagina condivisa, niente da allocare
+    int producer_done;
+    int error;          // lettura fallita: il consumatore riceve -1 dopo i chunk già pronti
+    int stop;
+    pthread_t producer;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+// Legge [offset, offset + length) dal device, completando le letture parziali
+static int read_chunk(int fd, size_t offset, char *buffer, size_t length) {
+    size_t done = 0;
+
+    while (done < length) {
+        ssize_t bytes = pread(fd, buffer + done, length - done, (off_t)(offset + done));
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("read");
+            return -1;
+        }
+        if (bytes == 0) {
+            fprintf(stderr, "read: unexpected end of device at offset %zu\n", offset + done);
+            return -1;
+        }
+        done += (size_t)bytes;
+    }
+
+    return 0;
+}
+
+static void *pipeline_producer(void *arg) {
+    pattern_pipeline_t *pipeline = arg;
+
+    pthread_mutex_lock(&pipeline->lock);
+    while (!pipeline->stop && pipeline->next_offset < pipeline->end) {
+        if (pipeline->free_count == 0) {
+            pthread_cond_wait(&pipeline->cond, &pipeline->lock);
+            continue;
+        }
+
+        unsigned int index = pipeline->free_list[--pipeline->free_count];
+        size_t offset = pipeline->next_offset;
+        size_t length = pipeline->end - offset > pipeline->chunk_size ? pipeline->chunk_size : pipeline->end - offset;
+        pipeline->next_offset += length;
+
+        // La generazione (o la lettura) avviene fuori dal lock, in parallelo con il consumatore
+        pthread_mutex_unlock(&pipeline->lock);
+        int failed = 0;
+        if (pipeline->fd >= 0) {
+            failed = read_chunk(pipeline->fd, offset, pipeline->buffers[index], length);
+        } else {
+            pattern_fill(&pipeline->pass, offset, pipeline->buffers[index], length);
+        }
+        pthread_mutex_lock(&pipeline->lock);
+
+        if (failed) {
+            pipeline->error = 1;
+            break;
+        }
+
+        unsigned int tail = (pipeline->ready_head + pipeline->ready_count) % pipeline->count;
+        pipeline->ready[tail] = index;
+        pipeline->ready_offset[tail] = offset;
+        pipeline->ready_length[tail] = length;
+        pipeline->ready_count++;
+        pthread_cond_broadcast(&pipeline->cond);
+    }
+
+    pipeline->producer_done = 1;
+    pthread_cond_broadcast(&pipeline->cond);
+    pthread_mutex_unlock(&pipeline->lock);
+    return NULL;
+}
+
+static pattern_pipeline_t *pipeline_new(const pattern_pass_t *pass, int fd, size_t start, size_t length,
+                                        size_t chunk_size, size_t alignment, unsigned int buffer_count) {
+    pattern_pipeline_t *pipeline = calloc(1, sizeof(*pipeline));
+    if (!pipeline) {
+        perror("calloc");
+        return NULL;
+    }
+
+    if (pass) {
+        pipeline->pass = *pass;
+    }
+    pipeline->fd = fd;
+    pipeline->end = start + length;
+    pipeline->chunk_size = chunk_size;
+    pipeline->count = buffer_count;
+    pipeline->next_offset = start;
+    pipeline->threaded = fd >= 0 || (pass && pass->kind == PATTERN_RANDOM);
+    pthread_mutex_init(&pipeline->lock, NULL);
+    pthread_cond_init(&pipeline->cond, NULL);
+
+    pipeline->buffers = calloc(buffer_count, sizeof(void *));
+    pipeline->free_list = calloc(buffer_count, sizeof(unsigned int));
+    pipeline->ready = calloc(buffer_count, sizeof(unsigned int));
+    pipeline->ready_offset = calloc(buffer_count, sizeof(size_t));
+    pipeline->ready_length = calloc(buffer_count, sizeof(size_t));
+    if (!pipeline->buffers || !pipeline->free_list || !pipeline->ready || !pipeline->ready_offset ||
+        !pipeline->ready_length) {
+        perror("calloc");
+        pipeline_destroy(pipeline);
+        return NULL;
+    }
+
+    // I pattern fissi scrivono dalla pagina condivisa se è allineata quanto richiesto (O_DIRECT)
+    const void *page = !pipeline->threaded && pass ? pattern_shared(pass->byte) : NULL;
+    pipeline->shared = page && (uintptr_t)page % alignment == 0;
+
+    for (unsigned int i = 0; i < buffer_count; i++) {
+        if (pipeline->shared) {
+            pipeline->buffers[i] = (void *)page;
+        } else if (posix_memalign(&pipeline->buffers[i], alignment, chunk_size) != 0) {
+            perror("posix_memalign");
+            pipeline_destroy(pipeline);
+            return NULL;
+        }
+
+        // I pattern fissi si preparano una volta sola
+        if (!pipeline->threaded && pass && !pipeline->shared) {
+            pattern_fill(pass, 0, pipeline->buffers[i], chunk_size);
+        }
+        pipeline->free_list[pipeline->free_count++] = i;
+    }
+
+    if (pipeline->threaded) {
+        if (pthread_create(&pipeline->producer, NULL, pipeline_producer, pipeline) != 0) {
+            perror("pthread_create");
+            pipeline->threaded = 0;
+            pipeline_destroy(pipeline);
+            return NULL;
+        }
+    }
+
+    return pipeline;
+}
+
+pattern_pipeline_t *pipeline_create(const pattern_pass_t *pass, size_t start, size_t length, size_t chunk_size,
+                                    size_t alignment, unsigned int buffer_count) {
+    return pipeline_new(pass, -1, start, length, chunk_size, alignment, buffer_count);
+}
+
+pattern_pipeline_t *pipeline_create_reader(int fd, size_t start, size_t length, size_t chunk_size,
+                                           size_t alignment, unsigned int buffer_count) {
+    return pipeline_new(NULL, fd, start, length, chunk_size, alignment, buffer_count);
+}
+
+void *pipeline_buffer(const pattern_pipeline_t *pipeline, unsigned int index) {
+    return pipeline->buffers[index];
+}
+
+unsigned int pipeline_buffer_count(const pattern_pipeline_t *pipeline) {
+    return pipeline->count;
+}
+
+int pipeline_shared(const pattern_pipeline_t *pipeline) {
+    return pipeline->shared;
+}
+
+int pipeline_acquire(pattern_pipeline_t *pipeline, unsigned int *index, size_t *offset, size_t *length) {
+    int result = 0;
+
+    pthread_mutex_lock(&pipeline->lock);
+
+    if (!pipeline->threaded) {
+        if (pipeline->next_offset >= pipeline->end) {
+            result = 1;
+        } else if (pipeline->free_count == 0) {
+            result = -1;
+        } else {
+            *index = pipeline->free_list[--pipeline->free_count];
+            *offset = pipeline->next_offset;
+            *length = pipeline->end - *offset > pipeline->chunk_size ? pipeline->chunk_size : pipeline->end - *offset;
+            pipeline->next_offset += *length;
+        }
+        pthread_mutex_unlock(&pipeline->lock);
+        return result;
+    }
+
+    // Attendere che il produttore abbia pronto il chunk successivo
+    while (pipeline->ready_count == 0 && !pipeline->producer_done) {
+        pthread_cond_wait(&pipeline->cond, &pipeline->lock);
+    }
+
+    if (pipeline->ready_count == 0) {
+        result = pipeline->error ? -1 : 1;
+    } else {
+        unsigned int head = pipeline->ready_head;
+        *index = pipeline->ready[head];
+        *offset = pipeline->ready_offset[head];
+        *length = pipeline->ready_length[head];
+        pipeline->ready_head = (head + 1) % pipeline->count;
+        pipeline->ready_count--;
+    }
+
+    pthread_mutex_unlock(&pipeline->lock);
+    return result;
+}
+
+void pipeline_release(pattern_pipeline_t *pipeline, unsigned int index) {
+    pthread_mutex_lock(&pipeline->lock);
+    pipeline->free_list[pipeline->free_count++] = index;
+    pthread_cond_broadcast(&pipeline->cond);
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+void pipeline_destroy(pattern_pipeline_t *pipeline) {
+    if (!pipeline) {
+        return;
+    }
+
+    if (pipeline->threaded) {
+        pthread_mutex_lock(&pipeline->lock);
+        pipeline->stop = 1;
+        pthread_cond_broadcast(&pipeline->cond);
+        pthread_mutex_unlock(&pipeline->lock);
+        pthread_join(pipeline->producer, NULL);
+    }
+
+    if (pipeline->buffers && !pipeline->shared) {
+        for (unsigned int i = 0; i < pipeline->count; i++) {
+            free(pipeline->buffers[i]);
+        }
+    }
+
+    free(pipeline->buffers);
+    free(pipeline->free_list);
+    free(pipeline->ready);
+    free(pipeline->ready_offset);
+    free(pipeline->ready_length);
+    pthread_mutex_destroy(&pipeline->lock);
+    pthread_cond_destroy(&pipeline->cond);
+    free(pipeline);
+}
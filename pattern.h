@@ -0,0 +1,73 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#define PATTERN_MAX_PASSES 16
+
+// Contenuto di una singola passata
+typedef enum {
+    PATTERN_BYTE = 0, // byte fisso ripetuto (0x00, 0xFF, 0x55, ...)
+    PATTERN_RANDOM    // dati pseudo-casuali
+} pattern_kind_t;
+
+typedef struct {
+    pattern_kind_t kind;
+    unsigned char byte;
+    uint64_t seed; // chiave del generatore counter-based per le passate casuali
+} pattern_pass_t;
+
+// Schema di sovrascrittura: sequenza ordinata di passate
+typedef struct {
+    char name[64];
+    int pass_count;
+    pattern_pass_t passes[PATTERN_MAX_PASSES];
+} wipe_scheme_t;
+
+// Accetta il nome di uno schema predefinito (zero, dod, ...) oppure una lista
+// di passate separate da virgole: zero, ones, random o un byte (0xAA)
+int scheme_from_name(const char *name, wipe_scheme_t *scheme);
+void scheme_print_available(void);
+// Deriva un seed distinto per ogni passata dal seed dello schema
+void scheme_set_seed(wipe_scheme_t *scheme, uint64_t seed);
+char *pattern_describe(const pattern_pass_t *pass, char *buffer, size_t buffer_size);
+
+// Contenuto della passata per i byte [offset, offset + length) del device:
+// qualsiasi regione si può rigenerare a partire dal solo seed
+void pattern_fill(const pattern_pass_t *pass, uint64_t offset, void *buffer, size_t length);
+
+// Pagina condivisa dei pattern fissi: una regione di sola lettura per valore di byte, allocata alla
+// prima richiesta su una huge page quando possibile e usata da tutti i writer del processo. Una
+// richiesta di qualsiasi lunghezza la ripete in più iovec, così la memoria non cresce con chunk e device.
+#define PATTERN_SHARED_SIZE (2 * 1024 * 1024)
+
+// Regione di PATTERN_SHARED_SIZE byte pari a byte, NULL se non si può allocare
+const void *pattern_shared(unsigned char byte);
+// Riempie al più max iovec che ripetono page per length byte; ritorna quante ne ha usate
+int pattern_shared_iov(const void *page, size_t length, struct iovec *iov, int max);
+
+// Pipeline produttore/consumatore: un thread prepara i buffer dei chunk successivi
+// mentre il chiamante scrive quelli già pronti. I chunk vengono consegnati in ordine
+// di offset, i buffer possono essere restituiti in qualsiasi ordine.
+typedef struct pattern_pipeline pattern_pipeline_t;
+
+// Con pass NULL la pipeline fornisce solo buffer e offset, senza contenuto (letture io_uring)
+pattern_pipeline_t *pipeline_create(const pattern_pass_t *pass, size_t start, size_t length, size_t chunk_size,
+                                    size_t alignment, unsigned int buffer_count);
+// Variante in lettura: il produttore legge i chunk dal device mentre il chiamante li verifica
+pattern_pipeline_t *pipeline_create_reader(int fd, size_t start, size_t length, size_t chunk_size,
+                                           size_t alignment, unsigned int buffer_count);
+void *pipeline_buffer(const pattern_pipeline_t *pipeline, unsigned int index);
+unsigned int pipeline_buffer_count(const pattern_pipeline_t *pipeline);
+// Vero se tutti i buffer sono la pagina condivisa del pattern (pattern_shared): un chunk più lungo
+// di PATTERN_SHARED_SIZE va scritto con pattern_shared_iov, non come buffer contiguo
+int pipeline_shared(const pattern_pipeline_t *pipeline);
+// Ritorna 0 con un chunk pronto, 1 se l'intervallo è esaurito,
+// -1 se non ci sono buffer liberi o la lettura del device è fallita
+int pipeline_acquire(pattern_pipeline_t *pipeline, unsigned int *index, size_t *offset, size_t *length);
+void pipeline_release(pattern_pipeline_t *pipeline, unsigned int index);
+void pipeline_destroy(pattern_pipeline_t *pipeline);
+
+#endif // PATTERN_H
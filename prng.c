@@ -0,0 +1,449 @@
+#define _GNU_SOURCE
+
+#include "prng.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define PRNG_X86 1
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PRNG_NEON 1
+#endif
+
+#define CHACHA_ROUNDS 8
+#define BLOCK_SIZE 64
+
+typedef void (*prng_kernel_fn)(const uint32_t *state, uint64_t block, size_t count, unsigned char *out);
+
+static uint32_t rotl32(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+#define QUARTER_ROUND(a, b, c, d) \
+    do { \
+        a += b; d ^= a; d = rotl32(d, 16); \
+        c += d; b ^= c; b = rotl32(b, 12); \
+        a += b; d ^= a; d = rotl32(d, 8); \
+        c += d; b ^= c; b = rotl32(b, 7); \
+    } while (0)
+
+static void store32_le(unsigned char *out, uint32_t value) {
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+    out[2] = (unsigned char)(value >> 16);
+    out[3] = (unsigned char)(value >> 24);
+}
+
+// Stato iniziale: costanti, chiave, contatore a 64 bit (parole 12-13), nonce a zero
+static void init_state(uint32_t *state, const prng_key_t *key) {
+    state[0] = 0x61707865;
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    memcpy(&state[4], key->words, sizeof(key->words));
+    state[12] = 0;
+    state[13] = 0;
+    state[14] = 0;
+    state[15] = 0;
+}
+
+static void scalar_kernel(const uint32_t *state, uint64_t block, size_t count, unsigned char *out) {
+    for (size_t n = 0; n < count; n++, block++, out += BLOCK_SIZE) {
+        uint32_t x[16], input[16];
+
+        memcpy(input, state, sizeof(input));
+        input[12] = (uint32_t)block;
+        input[13] = (uint32_t)(block >> 32);
+        memcpy(x, input, sizeof(x));
+
+        for (int round = 0; round < CHACHA_ROUNDS; round += 2) {
+            QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+            QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+            QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+            QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+            QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+            QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+            QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+            QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+        }
+
+        for (int i = 0; i < 16; i++) {
+            store32_le(out + 4 * i, x[i] + input[i]);
+        }
+    }
+}
+
+#ifdef PRNG_X86
+
+// SSE2: 4 blocchi in parallelo, una parola di stato per vettore (layout verticale)
+#define SSE_ROTL(x, n) _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - (n)))
+#define SSE_QR(a, b, c, d) \
+    do { \
+        a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = SSE_ROTL(d, 16); \
+        c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = SSE_ROTL(b, 12); \
+        a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = SSE_ROTL(d, 8); \
+        c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = SSE_ROTL(b, 7); \
+    } while (0)
+
+static void sse2_kernel(const uint32_t *state, uint64_t block, size_t count, unsigned char *out) {
+    while (count >= 4) {
+        __m128i x[16], input[16];
+
+        for (int i = 0; i < 16; i++) {
+            input[i] = _mm_set1_epi32((int)state[i]);
+        }
+        input[12] = _mm_setr_epi32((int)(uint32_t)block, (int)(uint32_t)(block + 1),
+                                   (int)(uint32_t)(block + 2), (int)(uint32_t)(block + 3));
+        input[13] = _mm_setr_epi32((int)(uint32_t)(block >> 32), (int)(uint32_t)((block + 1) >> 32),
+                                   (int)(uint32_t)((block + 2) >> 32), (int)(uint32_t)((block + 3) >> 32));
+        memcpy(x, input, sizeof(x));
+
+        for (int round = 0; round < CHACHA_ROUNDS; round += 2) {
+            SSE_QR(x[0], x[4], x[8], x[12]);
+            SSE_QR(x[1], x[5], x[9], x[13]);
+            SSE_QR(x[2], x[6], x[10], x[14]);
+            SSE_QR(x[3], x[7], x[11], x[15]);
+            SSE_QR(x[0], x[5], x[10], x[15]);
+            SSE_QR(x[1], x[6], x[11], x[12]);
+            SSE_QR(x[2], x[7], x[8], x[13]);
+            SSE_QR(x[3], x[4], x[9], x[14]);
+        }
+
+        for (int i = 0; i < 16; i++) {
+            x[i] = _mm_add_epi32(x[i], input[i]);
+        }
+
+        // Trasposizione 4x4 per ogni gruppo di 4 parole: da verticale a blocchi consecutivi
+        for (int g = 0; g < 4; g++) {
+            __m128i t0 = _mm_unpacklo_epi32(x[4 * g], x[4 * g + 1]);
+            __m128i t1 = _mm_unpacklo_epi32(x[4 * g + 2], x[4 * g + 3]);
+            __m128i t2 = _mm_unpackhi_epi32(x[4 * g], x[4 * g + 1]);
+            __m128i t3 = _mm_unpackhi_epi32(x[4 * g + 2], x[4 * g + 3]);
+
+            _mm_storeu_si128((__m128i *)(out + 0 * BLOCK_SIZE + 16 * g), _mm_unpacklo_epi64(t0, t1));
+            _mm_storeu_si128((__m128i *)(out + 1 * BLOCK_SIZE + 16 * g), _mm_unpackhi_epi64(t0, t1));
+            _mm_storeu_si128((__m128i *)(out + 2 * BLOCK_SIZE + 16 * g), _mm_unpacklo_epi64(t2, t3));
+            _mm_storeu_si128((__m128i *)(out + 3 * BLOCK_SIZE + 16 * g), _mm_unpackhi_epi64(t2, t3));
+        }
+
+        block += 4;
+        count -= 4;
+        out += 4 * BLOCK_SIZE;
+    }
+
+    scalar_kernel(state, block, count, out);
+}
+
+// AVX2: 8 blocchi in parallelo; lo shuffle a byte rende economiche le rotazioni di 16 e 8
+#define AVX_ROTL(x, n) _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - (n)))
+#define AVX_QR(a, b, c, d) \
+    do { \
+        a = _mm256_add_epi32(a, b); d = _mm256_xor_si256(d, a); d = _mm256_shuffle_epi8(d, rot16); \
+        c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c); b = AVX_ROTL(b, 12); \
+        a = _mm256_add_epi32(a, b); d = _mm256_xor_si256(d, a); d = _mm256_shuffle_epi8(d, rot8); \
+        c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c); b = AVX_ROTL(b, 7); \
+    } while (0)
+
+__attribute__((target("avx2")))
+static void avx2_kernel(const uint32_t *state, uint64_t block, size_t count, unsigned char *out) {
+    const __m256i rot16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                           2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m256i rot8 = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+                                          3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+
+    while (count >= 8) {
+        __m256i x[16], input[16];
+        uint32_t lo[8], hi[8];
+
+        for (int i = 0; i < 8; i++) {
+            lo[i] = (uint32_t)(block + (uint64_t)i);
+            hi[i] = (uint32_t)((block + (uint64_t)i) >> 32);
+        }
+        for (int i = 0; i < 16; i++) {
+            input[i] = _mm256_set1_epi32((int)state[i]);
+        }
+        input[12] = _mm256_loadu_si256((const __m256i *)lo);
+        input[13] = _mm256_loadu_si256((const __m256i *)hi);
+        memcpy(x, input, sizeof(x));
+
+        for (int round = 0; round < CHACHA_ROUNDS; round += 2) {
+            AVX_QR(x[0], x[4], x[8], x[12]);
+            AVX_QR(x[1], x[5], x[9], x[13]);
+            AVX_QR(x[2], x[6], x[10], x[14]);
+            AVX_QR(x[3], x[7], x[11], x[15]);
+            AVX_QR(x[0], x[5], x[10], x[15]);
+            AVX_QR(x[1], x[6], x[11], x[12]);
+            AVX_QR(x[2], x[7], x[8], x[13]);
+            AVX_QR(x[3], x[4], x[9], x[14]);
+        }
+
+        // Trasposizione 4x4 dentro ogni metà da 128 bit: r[g][j] contiene le parole 4g..4g+3
+        // del blocco j (metà bassa) e del blocco j + 4 (metà alta)
+        __m256i r[4][4];
+        for (int g = 0; g < 4; g++) {
+            __m256i a = _mm256_add_epi32(x[4 * g], input[4 * g]);
+            __m256i b = _mm256_add_epi32(x[4 * g + 1], input[4 * g + 1]);
+            __m256i c = _mm256_add_epi32(x[4 * g + 2], input[4 * g + 2]);
+            __m256i d = _mm256_add_epi32(x[4 * g + 3], input[4 * g + 3]);
+            __m256i t0 = _mm256_unpacklo_epi32(a, b);
+            __m256i t1 = _mm256_unpacklo_epi32(c, d);
+            __m256i t2 = _mm256_unpackhi_epi32(a, b);
+            __m256i t3 = _mm256_unpackhi_epi32(c, d);
+
+            r[g][0] = _mm256_unpacklo_epi64(t0, t1);
+            r[g][1] = _mm256_unpackhi_epi64(t0, t1);
+            r[g][2] = _mm256_unpacklo_epi64(t2, t3);
+            r[g][3] = _mm256_unpackhi_epi64(t2, t3);
+        }
+
+        // Ricombinare le metà: 32 byte contigui per ogni store
+        for (int j = 0; j < 4; j++) {
+            unsigned char *low = out + j * BLOCK_SIZE;
+            unsigned char *high = out + (j + 4) * BLOCK_SIZE;
+
+            _mm256_storeu_si256((__m256i *)low, _mm256_permute2x128_si256(r[0][j], r[1][j], 0x20));
+            _mm256_storeu_si256((__m256i *)(low + 32), _mm256_permute2x128_si256(r[2][j], r[3][j], 0x20));
+            _mm256_storeu_si256((__m256i *)high, _mm256_permute2x128_si256(r[0][j], r[1][j], 0x31));
+            _mm256_storeu_si256((__m256i *)(high + 32), _mm256_permute2x128_si256(r[2][j], r[3][j], 0x31));
+        }
+
+        block += 8;
+        count -= 8;
+        out += 8 * BLOCK_SIZE;
+    }
+
+    sse2_kernel(state, block, count, out);
+}
+
+#endif // PRNG_X86
+
+#ifdef PRNG_NEON
+
+#define NEON_ROTL(x, n) vsriq_n_u32(vshlq_n_u32(x, n), x, 32 - (n))
+#define NEON_QR(a, b, c, d) \
+    do { \
+        a = vaddq_u32(a, b); d = veorq_u32(d, a); d = NEON_ROTL(d, 16); \
+        c = vaddq_u32(c, d); b = veorq_u32(b, c); b = NEON_ROTL(b, 12); \
+        a = vaddq_u32(a, b); d = veorq_u32(d, a); d = NEON_ROTL(d, 8); \
+        c = vaddq_u32(c, d); b = veorq_u32(b, c); b = NEON_ROTL(b, 7); \
+    } while (0)
+
+static void neon_kernel(const uint32_t *state, uint64_t block, size_t count, unsigned char *out) {
+    while (count >= 4) {
+        uint32x4_t x[16], input[16];
+        uint32_t lo[4], hi[4];
+
+        for (int i = 0; i < 4; i++) {
+            lo[i] = (uint32_t)(block + (uint64_t)i);
+            hi[i] = (uint32_t)((block + (uint64_t)i) >> 32);
+        }
+        for (int i = 0; i < 16; i++) {
+            input[i] = vdupq_n_u32(state[i]);
+        }
+        input[12] = vld1q_u32(lo);
+        input[13] = vld1q_u32(hi);
+        memcpy(x, input, sizeof(x));
+
+        for (int round = 0; round < CHACHA_ROUNDS; round += 2) {
+            NEON_QR(x[0], x[4], x[8], x[12]);
+            NEON_QR(x[1], x[5], x[9], x[13]);
+            NEON_QR(x[2], x[6], x[10], x[14]);
+            NEON_QR(x[3], x[7], x[11], x[15]);
+            NEON_QR(x[0], x[5], x[10], x[15]);
+            NEON_QR(x[1], x[6], x[11], x[12]);
+            NEON_QR(x[2], x[7], x[8], x[13]);
+            NEON_QR(x[3], x[4], x[9], x[14]);
+        }
+
+        // vst4q interleava 4 vettori: le parole 4g..4g+3 dei 4 blocchi escono contigue
+        uint32_t transposed[64];
+        for (int g = 0; g < 4; g++) {
+            uint32x4x4_t group = {{
+                vaddq_u32(x[4 * g], input[4 * g]),
+                vaddq_u32(x[4 * g + 1], input[4 * g + 1]),
+                vaddq_u32(x[4 * g + 2], input[4 * g + 2]),
+                vaddq_u32(x[4 * g + 3], input[4 * g + 3]),
+            }};
+            vst4q_u32(&transposed[16 * g], group);
+        }
+        for (int j = 0; j < 4; j++) {
+            for (int g = 0; g < 4; g++) {
+                memcpy(out + j * BLOCK_SIZE + 16 * g, &transposed[16 * g + 4 * j], 16);
+            }
+        }
+
+        block += 4;
+        count -= 4;
+        out += 4 * BLOCK_SIZE;
+    }
+
+    scalar_kernel(state, block, count, out);
+}
+
+#endif // PRNG_NEON
+
+static prng_kernel_t active_kernel = PRNG_KERNEL_AUTO;
+static prng_kernel_fn active_fn = scalar_kernel;
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+
+static prng_kernel_fn kernel_function(prng_kernel_t kernel) {
+    switch (kernel) {
+#ifdef PRNG_X86
+        case PRNG_KERNEL_SSE2:
+            return sse2_kernel;
+        case PRNG_KERNEL_AVX2:
+            return avx2_kernel;
+#endif
+#ifdef PRNG_NEON
+        case PRNG_KERNEL_NEON:
+            return neon_kernel;
+#endif
+        default:
+            return scalar_kernel;
+    }
+}
+
+int prng_kernel_supported(prng_kernel_t kernel) {
+    switch (kernel) {
+        case PRNG_KERNEL_AUTO:
+        case PRNG_KERNEL_SCALAR:
+            return 1;
+#ifdef PRNG_X86
+        case PRNG_KERNEL_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case PRNG_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+#ifdef PRNG_NEON
+        case PRNG_KERNEL_NEON:
+            return 1;
+#endif
+        default:
+            return 0;
+    }
+}
+
+static void detect_kernel(void) {
+    const prng_kernel_t preference[] = {PRNG_KERNEL_AVX2, PRNG_KERNEL_NEON, PRNG_KERNEL_SSE2};
+
+    for (size_t i = 0; i < sizeof(preference) / sizeof(preference[0]); i++) {
+        if (prng_kernel_supported(preference[i])) {
+            active_kernel = preference[i];
+            active_fn = kernel_function(preference[i]);
+            return;
+        }
+    }
+
+    active_kernel = PRNG_KERNEL_SCALAR;
+    active_fn = scalar_kernel;
+}
+
+int prng_select_kernel(prng_kernel_t kernel) {
+    pthread_once(&kernel_once, detect_kernel);
+
+    if (!prng_kernel_supported(kernel)) {
+        return -1;
+    }
+    if (kernel == PRNG_KERNEL_AUTO) {
+        detect_kernel();
+    } else {
+        active_kernel = kernel;
+        active_fn = kernel_function(kernel);
+    }
+    return 0;
+}
+
+prng_kernel_t prng_active_kernel(void) {
+    pthread_once(&kernel_once, detect_kernel);
+    return active_kernel;
+}
+
+const char *prng_kernel_name(prng_kernel_t kernel) {
+    switch (kernel) {
+        case PRNG_KERNEL_AUTO:
+            return "auto";
+        case PRNG_KERNEL_SCALAR:
+            return "scalar";
+        case PRNG_KERNEL_SSE2:
+            return "sse2";
+        case PRNG_KERNEL_AVX2:
+            return "avx2";
+        case PRNG_KERNEL_NEON:
+            return "neon";
+    }
+    return "unknown";
+}
+
+void prng_key_init(prng_key_t *key, uint64_t seed) {
+    // splitmix64 espande il seed a 256 bit di chiave
+    uint64_t x = seed;
+    for (int i = 0; i < 4; i++) {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z ^= z >> 31;
+        key->words[2 * i] = (uint32_t)z;
+        key->words[2 * i + 1] = (uint32_t)(z >> 32);
+    }
+}
+
+void prng_fill(const prng_key_t *key, uint64_t offset, void *buffer, size_t length) {
+    unsigned char *out = buffer;
+    uint32_t state[16];
+
+    pthread_once(&kernel_once, detect_kernel);
+    init_state(state, key);
+
+    uint64_t block = offset / BLOCK_SIZE;
+    size_t skip = (size_t)(offset % BLOCK_SIZE);
+
+    // Blocco iniziale parziale se l'offset non è multiplo di 64
+    if (skip > 0 && length > 0) {
+        unsigned char temp[BLOCK_SIZE];
+        size_t take = BLOCK_SIZE - skip < length ? BLOCK_SIZE - skip : length;
+
+        scalar_kernel(state, block, 1, temp);
+        memcpy(out, temp + skip, take);
+        out += take;
+        length -= take;
+        block++;
+    }
+
+    size_t blocks = length / BLOCK_SIZE;
+    if (blocks > 0) {
+        active_fn(state, block, blocks, out);
+        out += blocks * BLOCK_SIZE;
+        length -= blocks * BLOCK_SIZE;
+        block += blocks;
+    }
+
+    if (length > 0) {
+        unsigned char temp[BLOCK_SIZE];
+        scalar_kernel(state, block, 1, temp);
+        memcpy(out, temp, length);
+    }
+}
+
+uint64_t prng_random_seed(void) {
+    uint64_t seed = 0;
+    int fd = open("/dev/urandom", O_RDONLY);
+
+    if (fd >= 0) {
+        if (read(fd, &seed, sizeof(seed)) != (ssize_t)sizeof(seed)) {
+            seed = 0;
+        }
+        close(fd);
+    }
+
+    if (seed == 0) {
+        seed = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+    }
+
+    return seed;
+}
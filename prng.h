@@ -0,0 +1,37 @@
+#ifndef PRNG_H
+#define PRNG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Generatore counter-based (ChaCha8 in modalità contatore): il contenuto di ogni
+// blocco da 64 byte dipende solo dalla chiave e dal suo offset, quindi qualsiasi
+// regione del device si può rigenerare (o generare in parallelo) senza stato.
+
+typedef struct {
+    uint32_t words[8];
+} prng_key_t;
+
+typedef enum {
+    PRNG_KERNEL_AUTO = 0, // migliore kernel supportato dalla CPU
+    PRNG_KERNEL_SCALAR,
+    PRNG_KERNEL_SSE2,
+    PRNG_KERNEL_AVX2,
+    PRNG_KERNEL_NEON
+} prng_kernel_t;
+
+void prng_key_init(prng_key_t *key, uint64_t seed);
+// Riempie buffer con i byte [offset, offset + length) dello stream definito da key.
+// L'output è identico per qualsiasi kernel e qualsiasi suddivisione in chunk.
+void prng_fill(const prng_key_t *key, uint64_t offset, void *buffer, size_t length);
+
+int prng_kernel_supported(prng_kernel_t kernel);
+// Forza un kernel (benchmark); ritorna -1 se non supportato
+int prng_select_kernel(prng_kernel_t kernel);
+prng_kernel_t prng_active_kernel(void);
+const char *prng_kernel_name(prng_kernel_t kernel);
+
+// Seed casuale da /dev/urandom (con ripiego su tempo e pid)
+uint64_t prng_random_seed(void);
+
+#endif // PRNG_H
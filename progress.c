@@ -1,32 +1,140 @@
+#define _GNU_SOURCE
+
 #include "progress.h"
 #include "utils.h"
+#include <math.h>
 #include <stdio.h>
 #include <string.h>
 
+static uint64_t monotonic_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Il controllo della scadenza a ogni I/O usa il clock coarse (vDSO, senza leggere il TSC):
+// ha la risoluzione del tick, più che sufficiente per campioni ogni mezzo secondo
+#ifdef CLOCK_MONOTONIC_COARSE
+#define PROGRESS_CHECK_CLOCK CLOCK_MONOTONIC_COARSE
+#else
+#define PROGRESS_CHECK_CLOCK CLOCK_MONOTONIC
+#endif
+
 void progress_init(progress_info_t *info, size_t total_bytes) {
     info->total_bytes = total_bytes;
     info->written_bytes = 0;
+    info->resumed_bytes = 0;
     info->start_time = time(NULL);
-    info->last_update = info->start_time;
+    info->start_ns = monotonic_ns(CLOCK_MONOTONIC);
+    info->next_sample_ns = monotonic_ns(PROGRESS_CHECK_CLOCK) + PROGRESS_REFRESH_NS;
+    info->sample_ns = info->start_ns;
+    info->sample_bytes = 0;
+    info->instant_mbps = 0.0;
     info->speed_mbps = 0.0;
+    info->quiet = 0;
+    info->pass = 1;
+    info->pass_count = 1;
+    info->pass_pattern[0] = '\0';
+    info->label[0] = '\0';
+    info->stats = NULL;
+    info->metadata = NULL;
+    info->digest = NULL;
+    info->thread_count = 0;
+    memset(info->threads, 0, sizeof(info->threads));
 }
 
-void progress_update(progress_info_t *info, size_t bytes_written) {
-    info->written_bytes += bytes_written;
+void progress_set_pass(progress_info_t *info, int pass, int pass_count, const char *pattern) {
+    info->pass = pass;
+    info->pass_count = pass_count;
+    snprintf(info->pass_pattern, sizeof(info->pass_pattern), "%s", pattern);
+}
 
-    time_t current_time = time(NULL);
+void progress_set_label(progress_info_t *info, const char *label) {
+    snprintf(info->label, sizeof(info->label), "%s", label);
+}
 
-    // Aggiornare il display solo ogni secondo per evitare troppi refresh
-    if (current_time > info->last_update) {
-        time_t elapsed = current_time - info->start_time;
+void progress_restart(progress_info_t *info, size_t total_bytes, const char *label) {
+    uint64_t now = monotonic_ns(CLOCK_MONOTONIC);
 
-        if (elapsed > 0) {
-            // Calcolare velocità in MB/s
-            info->speed_mbps = (double)info->written_bytes / (double)elapsed / (1024.0 * 1024.0);
-        }
+    // Prima i byte, poi il totale: il display non vede mai più byte scritti del nuovo totale
+    __atomic_store_n(&info->written_bytes, 0, __ATOMIC_RELAXED);
+    progress_set_total(info, total_bytes);
+    info->resumed_bytes = 0;
+    info->start_time = time(NULL);
+    info->start_ns = now;
+    info->next_sample_ns = monotonic_ns(PROGRESS_CHECK_CLOCK) + PROGRESS_REFRESH_NS;
+    info->sample_ns = now;
+    info->sample_bytes = 0;
+    info->instant_mbps = 0.0;
+    info->speed_mbps = 0.0;
+    info->stats = NULL;
+    info->metadata = NULL;
+    info->digest = NULL;
+    progress_set_label(info, label);
+}
+
+void progress_set_total(progress_info_t *info, size_t total_bytes) {
+    __atomic_store_n(&info->total_bytes, total_bytes, __ATOMIC_RELAXED);
+}
+
+void progress_set_resumed(progress_info_t *info, size_t bytes) {
+    info->written_bytes = bytes;
+    info->resumed_bytes = bytes;
+    info->sample_bytes = bytes;
+}
+
+double progress_elapsed(const progress_info_t *info) {
+    return (double)(monotonic_ns(CLOCK_MONOTONIC) - info->start_ns) / 1e9;
+}
 
-        info->last_update = current_time;
-        progress_display(info);
+double progress_eta(const progress_info_t *info) {
+    size_t written = __atomic_load_n(&info->written_bytes, __ATOMIC_RELAXED);
+    size_t total = __atomic_load_n(&info->total_bytes, __ATOMIC_RELAXED);
+    if (info->speed_mbps <= 0 || written >= total) {
+        return -1.0;
+    }
+    return (double)(total - written) / (info->speed_mbps * 1024.0 * 1024.0);
+}
+
+// Chiamata solo dal writer che ha vinto la scadenza: nessun altro scrive i campi del campione
+static void progress_sample(progress_info_t *info, size_t written) {
+    uint64_t now = monotonic_ns(CLOCK_MONOTONIC);
+    double interval = (double)(now - info->sample_ns) / 1e9;
+
+    if (interval <= 0) {
+        return;
+    }
+
+    info->instant_mbps = (double)(written - info->sample_bytes) / interval / (1024.0 * 1024.0);
+
+    // EWMA pesata sul tempo: campioni irregolari contano per la durata che coprono.
+    // Il primo campione inizializza la media, così l'ETA è disponibile da subito
+    if (info->sample_bytes == info->resumed_bytes) {
+        info->speed_mbps = info->instant_mbps;
+    } else {
+        double alpha = 1.0 - exp(-interval / PROGRESS_EWMA_SECONDS);
+        info->speed_mbps += alpha * (info->instant_mbps - info->speed_mbps);
+    }
+
+    info->sample_ns = now;
+    info->sample_bytes = written;
+}
+
+void progress_update(progress_info_t *info, size_t bytes_written) {
+    size_t written = __atomic_add_fetch(&info->written_bytes, bytes_written, __ATOMIC_RELAXED);
+    uint64_t now = monotonic_ns(PROGRESS_CHECK_CLOCK);
+    uint64_t deadline = __atomic_load_n(&info->next_sample_ns, __ATOMIC_RELAXED);
+
+    // Campionare e ridisegnare al più ogni PROGRESS_REFRESH_NS;
+    // con più writer solo il thread che vince il CAS lo fa
+    if (now >= deadline &&
+        __atomic_compare_exchange_n(&info->next_sample_ns, &deadline, now + PROGRESS_REFRESH_NS, 0,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        progress_sample(info, written);
+
+        if (!info->quiet) {
+            progress_display(info);
+        }
     }
 }
 
@@ -59,22 +167,83 @@ void progress_display(const progress_info_t *info) {
     format_bytes(info->total_bytes, total_str, sizeof(total_str));
 
     // Calcolare tempo trascorso
-    time_t elapsed = time(NULL) - info->start_time;
     char elapsed_str[64];
-    format_time(elapsed, elapsed_str, sizeof(elapsed_str));
+    format_time((time_t)progress_elapsed(info), elapsed_str, sizeof(elapsed_str));
 
-    // Calcolare ETA
+    // ETA dalla velocità recente: segue il calo verso le tracce interne o a cache SLC esaurita
     char eta_str[64] = "calculating...";
-    if (info->speed_mbps > 0 && info->written_bytes > 0) {
-        size_t remaining_bytes = info->total_bytes - info->written_bytes;
-        time_t eta_seconds = (time_t)((double)remaining_bytes / (info->speed_mbps * 1024.0 * 1024.0));
-        format_time(eta_seconds, eta_str, sizeof(eta_str));
+    double eta = progress_eta(info);
+    if (eta >= 0) {
+        format_time((time_t)eta, eta_str, sizeof(eta_str));
     }
 
     // Stampare progress bar (sovrascrivendo la linea precedente)
     printf("\r[%s] %.1f%% | %s / %s", bar, percentage, written_str, total_str);
-    printf("\nSpeed: %.2f MB/s | Elapsed: %s | ETA: %s    \033[A",
-           info->speed_mbps, elapsed_str, eta_str);
+    printf("\n");
+    if (info->label[0] != '\0') {
+        printf("%s | ", info->label);
+    }
+    if (info->pass_count > 1) {
+        printf("Pass %d/%d (%s) | ", info->pass, info->pass_count, info->pass_pattern);
+    }
+    printf("Speed: %.2f MB/s (now %.2f) | Elapsed: %s | ETA: %s    \033[A",
+           info->speed_mbps, info->instant_mbps, elapsed_str, eta_str);
+    fflush(stdout);
+}
+
+static void display_batch_line(const char *label, size_t written, size_t total, double speed, double eta) {
+    double percentage = total > 0 ? (double)written / (double)total * 100.0 : 0.0;
+
+    const int bar_width = 20;
+    int filled = (int)(percentage / 100.0 * bar_width);
+
+    char bar[bar_width + 1];
+    for (int i = 0; i < bar_width; i++) {
+        bar[i] = (i < filled) ? '=' : (i == filled ? '>' : ' ');
+    }
+    bar[bar_width] = '\0';
+
+    char written_str[64], total_str[64];
+    format_bytes(written, written_str, sizeof(written_str));
+    format_bytes(total, total_str, sizeof(total_str));
+
+    char eta_str[64] = "-";
+    if (eta >= 0) {
+        format_time((time_t)eta, eta_str, sizeof(eta_str));
+    }
+
+    printf("%-16s [%s] %5.1f%% | %s / %s | %.2f MB/s | ETA: %s\033[K\n",
+           label, bar, percentage, written_str, total_str, speed, eta_str);
+}
+
+void progress_display_batch(const progress_info_t *const *infos, const char *const *labels, int count, int redraw) {
+    size_t total_written = 0, total_bytes = 0;
+    double total_speed = 0.0, total_eta = -1.0;
+
+    // Tornare all'inizio del blocco disegnato in precedenza
+    if (redraw) {
+        printf("\033[%dA", count + 1);
+    }
+
+    for (int i = 0; i < count; i++) {
+        size_t written = __atomic_load_n(&infos[i]->written_bytes, __ATOMIC_RELAXED);
+        size_t total = __atomic_load_n(&infos[i]->total_bytes, __ATOMIC_RELAXED);
+
+        // Un device terminato non contribuisce più alla velocità aggregata
+        double speed = written < total ? infos[i]->speed_mbps : 0.0;
+        double eta = progress_eta(infos[i]);
+        display_batch_line(labels[i], written, total, speed, eta);
+
+        total_written += written;
+        total_bytes += total;
+        total_speed += speed;
+        // I device procedono in parallelo: il batch termina con il più lento
+        if (eta > total_eta) {
+            total_eta = eta;
+        }
+    }
+
+    display_batch_line("TOTAL", total_written, total_bytes, total_speed, total_eta);
     fflush(stdout);
 }
 
@@ -82,16 +251,16 @@ void progress_finish(const progress_info_t *info) {
     // Muovere il cursore alla linea successiva per non sovrascrivere
     printf("\n\n");
 
-    time_t elapsed = time(NULL) - info->start_time;
+    double elapsed = progress_elapsed(info);
     double avg_speed = 0.0;
 
     if (elapsed > 0) {
-        avg_speed = (double)info->written_bytes / (double)elapsed / (1024.0 * 1024.0);
+        avg_speed = (double)(info->written_bytes - info->resumed_bytes) / elapsed / (1024.0 * 1024.0);
     }
 
     char total_str[64], elapsed_str[64];
     format_bytes(info->total_bytes, total_str, sizeof(total_str));
-    format_time(elapsed, elapsed_str, sizeof(elapsed_str));
+    format_time((time_t)elapsed, elapsed_str, sizeof(elapsed_str));
 
     // Ottenere timestamp di inizio e fine
     char start_time[64], end_time[64];
@@ -107,9 +276,37 @@ void progress_finish(const progress_info_t *info) {
     printf("Operation completed successfully!\n\n");
     printf("Statistics:\n");
     printf("  Total data written: %s\n", total_str);
+    if (info->pass_count > 1) {
+        printf("  Passes: %d\n", info->pass_count);
+    }
+    if (info->resumed_bytes > 0) {
+        char resumed_str[64];
+        format_bytes(info->resumed_bytes, resumed_str, sizeof(resumed_str));
+        printf("  Resumed from checkpoint: %s already erased\n", resumed_str);
+    }
     printf("  Total time: %s\n", elapsed_str);
     printf("  Average speed: %.2f MB/s\n", avg_speed);
+    char rss_str[64];
+    printf("  Peak memory (RSS): %s\n", format_bytes(peak_rss(), rss_str, sizeof(rss_str)));
     printf("  Start: %s\n", start_time);
     printf("  End: %s\n", end_time);
+
+    // Dettaglio per thread nel wipe a stripe
+    if (info->thread_count > 1) {
+        printf("\nPer-thread throughput:\n");
+        for (int i = 0; i < info->thread_count; i++) {
+            const progress_thread_stat_t *stat = &info->threads[i];
+            char offset_str[64], bytes_str[64];
+            double speed = stat->seconds > 0 ? (double)stat->bytes / stat->seconds / (1024.0 * 1024.0) : 0.0;
+
+            format_bytes(stat->offset, offset_str, sizeof(offset_str));
+            format_bytes(stat->bytes, bytes_str, sizeof(bytes_str));
+            printf("  Thread %2d: from %s, %s in %.2fs (%.2f MB/s)\n",
+                   i + 1, offset_str, bytes_str, stat->seconds, speed);
+        }
+    }
+    if (info->stats) {
+        io_stats_print(info->stats);
+    }
     printf("\nThe disk is now ready to be formatted.\n");
 }
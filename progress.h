@@ -2,19 +2,66 @@
 #define PROGRESS_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <time.h>
+#include "io_stats.h"
+
+#define PROGRESS_MAX_THREADS 64
+#define PROGRESS_REFRESH_NS 500000000ULL  // intervallo minimo tra due campioni di velocità (e ridisegni)
+#define PROGRESS_EWMA_SECONDS 10.0        // costante di tempo della velocità mediata, base dell'ETA
+
+// Statistiche di un singolo worker (wipe a stripe)
+typedef struct {
+    size_t offset;
+    size_t bytes;
+    double seconds;
+} progress_thread_stat_t;
 
 typedef struct {
     size_t total_bytes;
-    size_t written_bytes;
-    time_t start_time;
-    time_t last_update;
-    double speed_mbps;
+    size_t written_bytes; // aggiornato in modo atomico, anche da più thread
+    size_t resumed_bytes; // già cancellati in una sessione precedente, esclusi dalla velocità
+    time_t start_time;    // ora di inizio per le statistiche finali
+    uint64_t start_ns;    // CLOCK_MONOTONIC: durate e velocità non risentono dei cambi d'ora
+    uint64_t next_sample_ns; // scadenza del prossimo campione, contesa dai writer con un CAS
+    uint64_t sample_ns;   // ultimo campione: istante e byte scritti a quell'istante
+    size_t sample_bytes;
+    double instant_mbps;  // velocità dell'ultimo intervallo di campionamento
+    double speed_mbps;    // media mobile esponenziale (EWMA), usata per l'ETA
+    int quiet;            // niente display da progress_update (vista multi-device)
+    int pass;             // passata corrente (1-based) negli schemi multi-pass
+    int pass_count;
+    char pass_pattern[16];
+    char label[16];       // fase mostrata nel display (es. "Verify"), vuota per il wipe
+    io_stats_t *stats;    // latenze, velocità per fascia e stalli dei motori, NULL se non misurati
+    struct metadata_plan *metadata; // intervalli cancellati dal metodo quick, NULL se non richiesti
+    struct digest *digest; // digest del contenuto riletto dalla verifica completa, NULL se non richiesto
+    int thread_count;
+    progress_thread_stat_t threads[PROGRESS_MAX_THREADS];
 } progress_info_t;
 
 void progress_init(progress_info_t *info, size_t total_bytes);
+void progress_set_pass(progress_info_t *info, int pass, int pass_count, const char *pattern);
+void progress_set_label(progress_info_t *info, const char *label);
+// Nuova fase sullo stesso progress (es. la verifica dopo il wipe) mentre il display multi-device lo legge:
+// azzera contatori e campioni prima di cambiare il totale, stacca stats, metadata e digest della fase
+// precedente e imposta label; quiet, passata e statistiche per thread restano quelli del wipe
+void progress_restart(progress_info_t *info, size_t total_bytes, const char *label);
+// Totale della fase corrente, leggibile dal display in qualsiasi momento
+void progress_set_total(progress_info_t *info, size_t total_bytes);
+// Wipe ripreso da un checkpoint: la barra parte dai byte già cancellati
+void progress_set_resumed(progress_info_t *info, size_t bytes);
+// Chiamabile a ogni I/O da più thread: un'addizione atomica e una lettura del clock coarse;
+// solo il writer che vince la scadenza campiona la velocità e ridisegna
 void progress_update(progress_info_t *info, size_t bytes_written);
+// Secondi trascorsi dall'inizio (CLOCK_MONOTONIC)
+double progress_elapsed(const progress_info_t *info);
+// Secondi stimati al termine dalla velocità recente, -1 se non ancora stimabile
+double progress_eta(const progress_info_t *info);
 void progress_display(const progress_info_t *info);
 void progress_finish(const progress_info_t *info);
 
+// Una riga per device più una riga aggregata; redraw riposiziona il cursore sulle righe precedenti
+void progress_display_batch(const progress_info_t *const *infos, const char *const *labels, int count, int redraw);
+
 #endif // PROGRESS_H
@@ -0,0 +1,183 @@
+#define _GNU_SOURCE
+
+#include "rcw.h"
+#include "io_stats.h"
+#include "latency.h"
+#include "verify.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    const io_range_t *range;
+    void *pattern;          // contenuto della passata per il chunk corrente (fisso per i pattern costanti)
+    int shared;             // pattern costante: pattern è la pagina condivisa, da ripetere (pattern_shared)
+    size_t read_bytes;
+    size_t written_bytes;
+    uint64_t writes;
+    uint64_t write_ns;
+    int stopped;            // scrittura interrotta: il -1 restituito alla lettura vale -2
+} rcw_ctx_t;
+
+// Scrive [pos, pos + length) del chunk dal pattern già preparato
+static int rcw_write(rcw_ctx_t *ctx, size_t offset, size_t pos, size_t length) {
+    const io_range_t *range = ctx->range;
+    const char *buffer = ctx->shared ? ctx->pattern : (const char *)ctx->pattern + pos;
+
+    if (range->throttle) {
+        io_throttle_sleep(range, throttle_reserve(range->throttle, length));
+        if (io_should_stop(range)) {
+            return -2;
+        }
+    }
+
+    uint64_t submitted = latency_now_ns();
+    int result = ctx->shared ? io_pwrite_shared(range->fd, buffer, length, offset + pos)
+                             : io_pwrite_all(range->fd, buffer, length, offset + pos);
+    uint64_t completed = latency_now_ns();
+
+    if (result != 0) {
+        if (range->config->skip_bad && io_media_error(errno)) {
+            result = io_write_recover(range, buffer, offset + pos, length, ctx->shared);
+        } else {
+            perror("write");
+        }
+    } else if (range->throttle) {
+        throttle_complete(range->throttle, length, completed - submitted);
+    }
+
+    // Solo i run arrivati sul device (anche tramite il ripristino) contano come riscritti
+    if (result == 0) {
+        ctx->written_bytes += length;
+        ctx->writes++;
+        ctx->write_ns += completed - submitted;
+    }
+    return result;
+}
+
+// Confronta il chunk letto con la passata e riscrive i run diversi, fondendo quelli vicini
+static int rcw_chunk(void *arg, size_t offset, const void *buffer, size_t length) {
+    rcw_ctx_t *ctx = arg;
+    const pattern_pass_t *pass = ctx->range->pass;
+    const void *expected = NULL;
+    size_t run;
+
+    if (pass->kind == PATTERN_RANDOM) {
+        pattern_fill(pass, offset, ctx->pattern, length);
+        expected = ctx->pattern;
+    }
+
+    ctx->read_bytes += length;
+
+    size_t pos = verify_find_mismatch(pass, buffer, expected, length, 0, &run);
+    while (pos < length) {
+        size_t end = pos + run;
+        size_t next_run;
+        size_t next = verify_find_mismatch(pass, buffer, expected, length, end, &next_run);
+
+        // Riscrivere pochi blocchi già corretti costa meno di una richiesta in più
+        while (next < length && next - end <= RCW_MERGE_GAP) {
+            end = next + next_run;
+            next = verify_find_mismatch(pass, buffer, expected, length, end, &next_run);
+        }
+
+        int result = rcw_write(ctx, offset, pos, end - pos);
+        if (result != 0) {
+            // -2 non è un errore, ma il ciclo di lettura si ferma solo con -1
+            ctx->stopped = result == -2;
+            return -1;
+        }
+
+        pos = next;
+        run = next_run;
+    }
+
+    return 0;
+}
+
+static int sync_rcw_range(const io_range_t *read_range, rcw_ctx_t *ctx) {
+    pattern_pipeline_t *pipeline = pipeline_create_reader(read_range->fd, read_range->start, read_range->length,
+                                                          read_range->chunk_size, read_range->alignment,
+                                                          1 + IO_PIPELINE_LOOKAHEAD);
+    if (!pipeline) {
+        return -1;
+    }
+
+    int result = 0;
+
+    while (result == 0) {
+        if (io_should_stop(read_range)) {
+            result = -2;
+            break;
+        }
+
+        unsigned int index;
+        size_t offset, length;
+        int acquired = pipeline_acquire(pipeline, &index, &offset, &length);
+        if (acquired != 0) {
+            result = acquired > 0 ? 0 : -1;
+            break;
+        }
+
+        result = rcw_chunk(ctx, offset, pipeline_buffer(pipeline, index), length);
+        if (result == 0) {
+            progress_update(read_range->progress, length);
+            if (read_range->written_mark) {
+                __atomic_store_n(read_range->written_mark, offset + length, __ATOMIC_RELEASE);
+            }
+        }
+        pipeline_release(pipeline, index);
+    }
+
+    pipeline_destroy(pipeline);
+    return result;
+}
+
+int rcw_write_range(const io_range_t *range, io_engine_t engine) {
+    rcw_ctx_t ctx = {range, NULL, 0, 0, 0, 0, 0, 0};
+    size_t alignment = range->alignment < 4096 ? 4096 : range->alignment;
+
+    // I pattern costanti non dipendono dall'offset: si riscrivono dalla pagina condivisa
+    if (range->pass->kind != PATTERN_RANDOM) {
+        const void *page = pattern_shared(range->pass->byte);
+        if (page && (uintptr_t)page % alignment == 0) {
+            ctx.pattern = (void *)page;
+            ctx.shared = 1;
+        }
+    }
+
+    if (!ctx.shared) {
+        if (posix_memalign(&ctx.pattern, alignment, range->chunk_size) != 0) {
+            perror("posix_memalign");
+            return -1;
+        }
+        if (range->pass->kind != PATTERN_RANDOM) {
+            pattern_fill(range->pass, range->start, ctx.pattern, range->chunk_size);
+        }
+    }
+
+    // Le letture non passano per il limite: il throttle riguarda solo le scritture
+    io_range_t read_range = *range;
+    read_range.fd = range->read_fd;
+    read_range.throttle = NULL;
+
+    int result;
+    if (engine == IO_ENGINE_URING) {
+        result = uring_read_range(&read_range, rcw_chunk, &ctx);
+    } else {
+        result = sync_rcw_range(&read_range, &ctx);
+    }
+
+    if (result == -1 && ctx.stopped) {
+        result = -2;
+    }
+
+    if (range->progress->stats) {
+        io_stats_compare(range->progress->stats, ctx.read_bytes, ctx.written_bytes, ctx.writes, ctx.write_ns);
+    }
+
+    if (!ctx.shared) {
+        free(ctx.pattern);
+    }
+    return result;
+}
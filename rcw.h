@@ -0,0 +1,17 @@
+#ifndef RCW_H
+#define RCW_H
+
+#include "io_engine.h"
+
+// Read-compare-write: l'intervallo viene letto (queue_depth letture in volo con io_uring, pipeline di
+// lettura con il motore sync), confrontato con la passata a blocchi di VERIFY_BLOCK_SIZE e riscritto
+// solo dove differisce. Conviene su device già in gran parte cancellati e dove scrivere costa più che
+// leggere (SMR, flash con poca vita residua, dischi remoti).
+#define RCW_MERGE_GAP (64 * 1024) // blocchi diversi separati da meno di così diventano un'unica scrittura
+
+// Scrive range->pass nell'intervallo leggendo da range->read_fd e scrivendo su range->fd.
+// Il limite range->throttle vale solo per le scritture; i conteggi vanno in range->progress->stats.
+// Ritorna 0 se completato, -1 in caso di errore (anche di lettura), -2 se interrotto.
+int rcw_write_range(const io_range_t *range, io_engine_t engine);
+
+#endif // RCW_H
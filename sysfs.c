@@ -0,0 +1,164 @@
+#define _GNU_SOURCE
+
+#include "sysfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <dirent.h>
+
+int sysfs_device_name(const char *disk_path, char *name, size_t name_size) {
+#ifdef __linux__
+    char resolved[PATH_MAX];
+
+    if (!realpath(disk_path, resolved)) {
+        snprintf(resolved, sizeof(resolved), "%s", disk_path);
+    }
+
+    const char *base = strrchr(resolved, '/');
+    snprintf(name, name_size, "%s", base ? base + 1 : resolved);
+    return 0;
+#else
+    (void)disk_path;
+    (void)name;
+    (void)name_size;
+    return -1;
+#endif
+}
+
+static int read_u64_file(const char *path, unsigned long long *value) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+
+    int result = fscanf(fp, "%llu", value) == 1 ? 0 : -1;
+    fclose(fp);
+    return result;
+}
+
+int sysfs_read_u64(const char *disk_path, const char *attr, unsigned long long *value) {
+    char name[NAME_MAX + 1];
+    char path[PATH_MAX];
+
+    if (sysfs_device_name(disk_path, name, sizeof(name)) != 0) {
+        return -1;
+    }
+
+    snprintf(path, sizeof(path), "/sys/class/block/%s/%s", name, attr);
+    return read_u64_file(path, value);
+}
+
+int sysfs_read_string(const char *disk_path, const char *attr, char *value, size_t value_size) {
+    char name[NAME_MAX + 1];
+    char path[PATH_MAX];
+
+    if (sysfs_device_name(disk_path, name, sizeof(name)) != 0) {
+        return -1;
+    }
+
+    snprintf(path, sizeof(path), "/sys/class/block/%s/%s", name, attr);
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+
+    int result = -1;
+    if (fgets(value, (int)value_size, fp)) {
+        size_t len = strlen(value);
+        while (len > 0 && isspace((unsigned char)value[len - 1])) {
+            value[--len] = '\0';
+        }
+        result = len > 0 ? 0 : -1;
+    }
+
+    fclose(fp);
+    return result;
+}
+
+int sysfs_queue_u64(const char *disk_path, const char *attr, unsigned long long *value) {
+    char name[NAME_MAX + 1];
+    char path[PATH_MAX];
+
+    if (sysfs_device_name(disk_path, name, sizeof(name)) != 0) {
+        return -1;
+    }
+
+    snprintf(path, sizeof(path), "/sys/class/block/%s/queue/%s", name, attr);
+    if (read_u64_file(path, value) == 0) {
+        return 0;
+    }
+
+    // Le partizioni non hanno una coda propria: la directory padre è il disco
+    snprintf(path, sizeof(path), "/sys/class/block/%s/../queue/%s", name, attr);
+    return read_u64_file(path, value);
+}
+
+int sysfs_queue_limits(const char *disk_path, queue_limits_t *limits) {
+    memset(limits, 0, sizeof(*limits));
+
+    // Gli attributi mancanti (kernel vecchi, device virtuali) restano a 0
+    sysfs_queue_u64(disk_path, "logical_block_size", &limits->logical_block_size);
+    sysfs_queue_u64(disk_path, "physical_block_size", &limits->physical_block_size);
+    sysfs_queue_u64(disk_path, "optimal_io_size", &limits->optimal_io_size);
+    sysfs_queue_u64(disk_path, "max_sectors_kb", &limits->max_sectors_kb);
+    sysfs_queue_u64(disk_path, "max_hw_sectors_kb", &limits->max_hw_sectors_kb);
+    sysfs_queue_u64(disk_path, "rotational", &limits->rotational);
+    sysfs_queue_u64(disk_path, "nr_requests", &limits->nr_requests);
+
+    limits->valid = limits->logical_block_size > 0 && limits->physical_block_size > 0;
+    return limits->valid ? 0 : -1;
+}
+
+int sysfs_partitions(const char *disk_path, sysfs_partition_t *partitions, int max) {
+    int count = 0;
+
+#ifdef __linux__
+    char name[NAME_MAX + 1];
+    char dir_path[PATH_MAX];
+
+    if (sysfs_device_name(disk_path, name, sizeof(name)) != 0) {
+        return 0;
+    }
+
+    snprintf(dir_path, sizeof(dir_path), "/sys/class/block/%s", name);
+    DIR *dir = opendir(dir_path);
+    if (!dir) {
+        return 0;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && count < max) {
+        if (strncmp(entry->d_name, name, strlen(name)) != 0) {
+            continue;
+        }
+
+        char path[PATH_MAX + NAME_MAX + 16];
+        unsigned long long start, size = 0, number = 0;
+        snprintf(path, sizeof(path), "%s/%s/start", dir_path, entry->d_name);
+        if (read_u64_file(path, &start) != 0) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s/size", dir_path, entry->d_name);
+        read_u64_file(path, &size);
+        snprintf(path, sizeof(path), "%s/%s/partition", dir_path, entry->d_name);
+        read_u64_file(path, &number);
+
+        // sysfs esprime start e size in settori da 512 byte indipendentemente dal blocco logico
+        partitions[count].number = (int)number;
+        partitions[count].start = (size_t)start * 512;
+        partitions[count].size = (size_t)size * 512;
+        count++;
+    }
+
+    closedir(dir);
+#else
+    (void)disk_path;
+    (void)partitions;
+    (void)max;
+#endif
+
+    return count;
+}
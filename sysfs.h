@@ -0,0 +1,42 @@
+#ifndef SYSFS_H
+#define SYSFS_H
+
+#include <stddef.h>
+
+// Attributi dei block device da /sys/class/block (solo Linux, -1 altrove)
+
+// Nome del device nel kernel (sda, nvme0n1p2), risolvendo eventuali symlink (/dev/disk/by-id/...)
+int sysfs_device_name(const char *disk_path, char *name, size_t name_size);
+// Legge /sys/class/block/<dev>/<attr> come intero
+int sysfs_read_u64(const char *disk_path, const char *attr, unsigned long long *value);
+// Legge la prima riga di /sys/class/block/<dev>/<attr> senza spazi finali; ritorna -1 se assente o vuota
+int sysfs_read_string(const char *disk_path, const char *attr, char *value, size_t value_size);
+// Legge queue/<attr> del device; per una partizione usa la coda del disco che la contiene
+int sysfs_queue_u64(const char *disk_path, const char *attr, unsigned long long *value);
+
+// Limiti della coda di richieste (0 se l'attributo non è disponibile)
+typedef struct {
+    unsigned long long logical_block_size;
+    unsigned long long physical_block_size;
+    unsigned long long optimal_io_size;  // 0 anche quando il device non dichiara una dimensione ottimale
+    unsigned long long max_sectors_kb;   // richiesta più grande inviata dal kernel, le altre vengono divise
+    unsigned long long max_hw_sectors_kb;
+    unsigned long long rotational;
+    unsigned long long nr_requests;
+    int valid;                           // letti almeno i blocchi logico e fisico
+} queue_limits_t;
+
+// Legge i limiti da queue/ (della coda del disco per una partizione)
+int sysfs_queue_limits(const char *disk_path, queue_limits_t *limits);
+
+// Partizione nota al kernel, in byte dall'inizio del disco
+typedef struct {
+    int number; // numero della partizione nel disco (attributo partition), 0 se assente
+    size_t start;
+    size_t size;
+} sysfs_partition_t;
+
+// Partizioni del disco (/sys/class/block/<dev>/<dev>*/start e size); ritorna quante ne ha trovate
+int sysfs_partitions(const char *disk_path, sysfs_partition_t *partitions, int max);
+
+#endif // SYSFS_H
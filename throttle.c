@@ -0,0 +1,334 @@
+#define _GNU_SOURCE
+
+#include "throttle.h"
+#include "latency.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_BE 2
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_WHO_PROCESS 1 // con pid 0: il thread chiamante
+#elif __APPLE__
+#include <sys/resource.h>
+
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_BE 2
+#define IOPRIO_CLASS_IDLE 3
+#endif
+
+// Scadenze di finestra e di polling come nel progress: clock coarse, nessuna lettura del TSC
+#ifdef CLOCK_MONOTONIC_COARSE
+#define THROTTLE_CHECK_CLOCK CLOCK_MONOTONIC_COARSE
+#else
+#define THROTTLE_CHECK_CLOCK CLOCK_MONOTONIC
+#endif
+
+static uint64_t coarse_now_ns(void) {
+    struct timespec now;
+    clock_gettime(THROTTLE_CHECK_CLOCK, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+void throttle_config_default(throttle_config_t *config) {
+    config->rate_bps = 0;
+    config->iops = 0;
+    config->latency_target_ns = 0;
+    config->control_file = NULL;
+    config->ioprio = THROTTLE_IOPRIO_NONE;
+}
+
+int throttle_enabled(const throttle_config_t *config) {
+    return config->rate_bps > 0 || config->iops > 0 || config->latency_target_ns > 0 || config->control_file;
+}
+
+// Il più stretto tra limite fisso e limite adattivo (0 = nessuno dei due)
+static void update_rate(throttle_t *throttle) {
+    uint64_t fixed = __atomic_load_n(&throttle->config.rate_bps, __ATOMIC_RELAXED);
+    uint64_t adaptive = __atomic_load_n(&throttle->adaptive_bps, __ATOMIC_RELAXED);
+    uint64_t rate = fixed;
+
+    if (adaptive > 0 && (rate == 0 || adaptive < rate)) {
+        rate = adaptive;
+    }
+    __atomic_store_n(&throttle->rate_bps, rate, __ATOMIC_RELAXED);
+}
+
+// Stesse chiavi del job file: rate (byte/s con K/M/G), iops, latency_target (ms); 0 toglie il limite
+static void load_control_file(throttle_t *throttle) {
+    FILE *fp = fopen(throttle->config.control_file, "r");
+    if (!fp) {
+        log_message("Throttle: cannot read %s, keeping the current limits", throttle->config.control_file);
+        return;
+    }
+
+    size_t rate = throttle->config.rate_bps;
+    unsigned int iops = (unsigned int)throttle->config.iops;
+    unsigned int target_ms = (unsigned int)(throttle->config.latency_target_ns / 1000000);
+    int valid = 1;
+    char line[256];
+
+    while (valid && fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "#\n")] = '\0';
+
+        char *value = strchr(line, '=');
+        if (!value) {
+            continue;
+        }
+        *value++ = '\0';
+
+        char key[64];
+        if (sscanf(line, " %63s", key) != 1) {
+            continue;
+        }
+        while (isspace((unsigned char)*value)) {
+            value++;
+        }
+        value[strcspn(value, " \t\r")] = '\0';
+
+        if (strcmp(key, "rate") == 0) {
+            valid = parse_size(value, 0, THROTTLE_MAX_BPS, &rate) == 0;
+        } else if (strcmp(key, "iops") == 0) {
+            valid = parse_uint(value, 0, 10000000, &iops) == 0;
+        } else if (strcmp(key, "latency_target") == 0) {
+            valid = parse_uint(value, 0, 60000, &target_ms) == 0;
+        }
+    }
+    fclose(fp);
+
+    if (!valid) {
+        log_message("Throttle: invalid %s, keeping the current limits", throttle->config.control_file);
+        return;
+    }
+
+    __atomic_store_n(&throttle->config.rate_bps, (uint64_t)rate, __ATOMIC_RELAXED);
+    __atomic_store_n(&throttle->config.iops, (uint64_t)iops, __ATOMIC_RELAXED);
+    __atomic_store_n(&throttle->config.latency_target_ns, (uint64_t)target_ms * 1000000, __ATOMIC_RELAXED);
+    if (target_ms == 0) {
+        __atomic_store_n(&throttle->adaptive_bps, 0, __ATOMIC_RELAXED);
+    }
+    update_rate(throttle);
+    log_message("Throttle: limits from %s: rate %zu bytes/s, %u IOPS, latency target %u ms",
+                throttle->config.control_file, rate, iops, target_ms);
+}
+
+// Istante di modifica in nanosecondi: con i soli secondi due modifiche ravvicinate andrebbero perse
+static uint64_t mtime_ns(const struct stat *st) {
+#ifdef __APPLE__
+    return (uint64_t)st->st_mtimespec.tv_sec * 1000000000ULL + (uint64_t)st->st_mtimespec.tv_nsec;
+#else
+    return (uint64_t)st->st_mtim.tv_sec * 1000000000ULL + (uint64_t)st->st_mtim.tv_nsec;
+#endif
+}
+
+// Una stat() al secondo, fatta dal writer che supera per primo la scadenza
+static void poll_control_file(throttle_t *throttle) {
+    uint64_t now = coarse_now_ns();
+    uint64_t deadline = __atomic_load_n(&throttle->next_poll_ns, __ATOMIC_RELAXED);
+
+    if (now < deadline || !__atomic_compare_exchange_n(&throttle->next_poll_ns, &deadline,
+                                                       now + THROTTLE_POLL_NS, 0, __ATOMIC_RELAXED,
+                                                       __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    struct stat st;
+    if (stat(throttle->config.control_file, &st) == 0 && mtime_ns(&st) != throttle->control_mtime) {
+        throttle->control_mtime = mtime_ns(&st);
+        load_control_file(throttle);
+    }
+}
+
+void throttle_init(throttle_t *throttle, const throttle_config_t *config) {
+    memset(throttle, 0, sizeof(*throttle));
+    throttle->config = *config;
+    throttle->tat_ns = latency_now_ns();
+    throttle->window_start_ns = coarse_now_ns();
+    throttle->window_end_ns = throttle->window_start_ns + THROTTLE_WINDOW_NS;
+
+    if (config->control_file) {
+        struct stat st;
+        if (stat(config->control_file, &st) == 0) {
+            throttle->control_mtime = mtime_ns(&st);
+            load_control_file(throttle);
+        }
+        throttle->next_poll_ns = throttle->window_start_ns + THROTTLE_POLL_NS;
+    }
+    update_rate(throttle);
+}
+
+uint64_t throttle_reserve(throttle_t *throttle, size_t length) {
+    if (throttle->config.control_file) {
+        poll_control_file(throttle);
+    }
+
+    uint64_t rate = __atomic_load_n(&throttle->rate_bps, __ATOMIC_RELAXED);
+    uint64_t iops = __atomic_load_n(&throttle->config.iops, __ATOMIC_RELAXED);
+    if (rate == 0 && iops == 0) {
+        return 0;
+    }
+
+    // Costo della richiesta in nanosecondi di "tempo di banda": conta il limite più stretto
+    uint64_t cost = rate > 0 ? (uint64_t)((double)length * 1e9 / (double)rate) : 0;
+    if (iops > 0 && 1000000000ULL / iops > cost) {
+        cost = 1000000000ULL / iops;
+    }
+
+    uint64_t now = latency_now_ns();
+    uint64_t tat = __atomic_load_n(&throttle->tat_ns, __ATOMIC_RELAXED);
+    uint64_t next;
+    do {
+        next = (tat > now ? tat : now) + cost;
+    } while (!__atomic_compare_exchange_n(&throttle->tat_ns, &tat, next, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    // Oltre il credito si attende fino a metà credito: una sleep copre molte richieste
+    if (next - now <= THROTTLE_BURST_NS) {
+        return 0;
+    }
+    return next - now - THROTTLE_BURST_NS / 2;
+}
+
+void throttle_complete(throttle_t *throttle, size_t length, uint64_t latency_ns) {
+    uint64_t target = __atomic_load_n(&throttle->config.latency_target_ns, __ATOMIC_RELAXED);
+    if (target == 0) {
+        return;
+    }
+
+    __atomic_add_fetch(&throttle->window_bytes, length, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&throttle->window_requests, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&throttle->window_latency_ns, latency_ns, __ATOMIC_RELAXED);
+
+    uint64_t now = coarse_now_ns();
+    uint64_t deadline = __atomic_load_n(&throttle->window_end_ns, __ATOMIC_RELAXED);
+    if (now < deadline || !__atomic_compare_exchange_n(&throttle->window_end_ns, &deadline,
+                                                       now + THROTTLE_WINDOW_NS, 0, __ATOMIC_RELAXED,
+                                                       __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    // Solo il writer che ha chiuso la finestra aggiorna il limite adattivo
+    uint64_t bytes = __atomic_exchange_n(&throttle->window_bytes, 0, __ATOMIC_RELAXED);
+    uint64_t requests = __atomic_exchange_n(&throttle->window_requests, 0, __ATOMIC_RELAXED);
+    uint64_t latency = __atomic_exchange_n(&throttle->window_latency_ns, 0, __ATOMIC_RELAXED);
+    uint64_t elapsed = now - throttle->window_start_ns;
+    throttle->window_start_ns = now;
+    if (requests == 0 || elapsed == 0) {
+        return;
+    }
+
+    uint64_t mean = latency / requests;
+    uint64_t observed = (uint64_t)((double)bytes * 1e9 / (double)elapsed);
+    uint64_t adaptive = throttle->adaptive_bps;
+    uint64_t updated = adaptive;
+
+    // AIMD: taglio del 25% sopra il target, +10% sotto i tre quarti del target
+    if (mean > target) {
+        uint64_t base = adaptive > 0 && adaptive < observed ? adaptive : observed;
+        updated = base - base / 4;
+        if (updated < THROTTLE_MIN_BPS) {
+            updated = THROTTLE_MIN_BPS;
+        }
+    } else if (adaptive > 0 && mean < target - target / 4) {
+        updated = adaptive + adaptive / 10;
+        // Se il device non arriva nemmeno alla metà del limite, il limite non serve più
+        if (updated > 2 * observed) {
+            updated = 0;
+        }
+    }
+
+    if (updated != adaptive) {
+        __atomic_store_n(&throttle->adaptive_bps, updated, __ATOMIC_RELAXED);
+        update_rate(throttle);
+        if (updated == 0) {
+            log_message("Throttle: mean latency %.2f ms under target, adaptive limit released", mean / 1e6);
+        } else if (updated < adaptive || adaptive == 0) {
+            log_message("Throttle: mean latency %.2f ms over target %.2f ms, limit %.1f MB/s", mean / 1e6,
+                        target / 1e6, updated / (1024.0 * 1024.0));
+        }
+    }
+}
+
+char *throttle_describe(const throttle_config_t *config, char *buffer, size_t buffer_size) {
+    size_t len = 0;
+
+    buffer[0] = '\0';
+    if (config->rate_bps > 0) {
+        len += (size_t)snprintf(buffer + len, buffer_size - len, "%.1f MB/s, ",
+                                config->rate_bps / (1024.0 * 1024.0));
+    }
+    if (config->iops > 0 && len < buffer_size) {
+        len += (size_t)snprintf(buffer + len, buffer_size - len, "%llu IOPS, ",
+                                (unsigned long long)config->iops);
+    }
+    if (config->latency_target_ns > 0 && len < buffer_size) {
+        len += (size_t)snprintf(buffer + len, buffer_size - len, "latency target %llu ms, ",
+                                (unsigned long long)(config->latency_target_ns / 1000000));
+    }
+    if (config->control_file && len < buffer_size) {
+        len += (size_t)snprintf(buffer + len, buffer_size - len, "control file %s, ", config->control_file);
+    }
+    if (config->ioprio != THROTTLE_IOPRIO_NONE && len < buffer_size) {
+        int io_class = config->ioprio >> IOPRIO_CLASS_SHIFT;
+        if (io_class == IOPRIO_CLASS_IDLE) {
+            len += (size_t)snprintf(buffer + len, buffer_size - len, "idle I/O priority, ");
+        } else {
+            len += (size_t)snprintf(buffer + len, buffer_size - len, "best-effort I/O priority %d, ",
+                                    config->ioprio & ((1 << IOPRIO_CLASS_SHIFT) - 1));
+        }
+    }
+
+    // Togliere l'ultimo ", "
+    if (len >= 2 && len < buffer_size) {
+        buffer[len - 2] = '\0';
+    }
+    return buffer;
+}
+
+int throttle_parse_priority(const char *text, int *ioprio) {
+    if (strcasecmp(text, "idle") == 0) {
+        *ioprio = IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT;
+        return 0;
+    }
+    if (strcasecmp(text, "be") == 0) {
+        *ioprio = (IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT) | 4; // livello di default del kernel
+        return 0;
+    }
+    if (strncasecmp(text, "be:", 3) == 0 && text[3] >= '0' && text[3] <= '7' && text[4] == '\0') {
+        *ioprio = (IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT) | (text[3] - '0');
+        return 0;
+    }
+    return -1;
+}
+
+int throttle_apply_priority(int ioprio) {
+    if (ioprio == THROTTLE_IOPRIO_NONE) {
+        return 0;
+    }
+#ifdef __linux__
+    // Per thread: vale per le write() sincrone; io_uring riceve la stessa priorità in ogni SQE
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, ioprio) < 0) {
+        perror("ioprio_set");
+        return -1;
+    }
+    return 0;
+#elif __APPLE__
+    // Nessuna classe idle: le richieste del thread vengono rallentate (throttled) dal sistema
+    int policy = (ioprio >> IOPRIO_CLASS_SHIFT) == IOPRIO_CLASS_IDLE ? IOPOL_THROTTLE : IOPOL_DEFAULT;
+    if (setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_THREAD, policy) < 0) {
+        perror("setiopolicy_np");
+        return -1;
+    }
+    return 0;
+#else
+    return -1;
+#endif
+}
@@ -0,0 +1,57 @@
+#ifndef THROTTLE_H
+#define THROTTLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Limite di banda e IOPS per i wipe su host condivisi. Token bucket in forma GCRA: un solo
+// istante teorico (tat) avanzato con una CAS per richiesta, nessuna syscall finché il credito basta.
+#define THROTTLE_BURST_NS (50ULL * 1000 * 1000)     // credito massimo: 50 ms alla velocità limite
+#define THROTTLE_WINDOW_NS (250ULL * 1000 * 1000)   // finestra del controllo adattivo sulla latenza
+#define THROTTLE_POLL_NS (1000ULL * 1000 * 1000)    // controllo delle modifiche al file di controllo
+#define THROTTLE_MIN_BPS (1024ULL * 1024)           // il controllo adattivo non scende sotto 1 MB/s
+#define THROTTLE_MAX_BPS (1ULL << 40)               // limite massimo accettato (1 TB/s)
+
+#define THROTTLE_IOPRIO_NONE -1 // priorità ereditata
+
+typedef struct {
+    uint64_t rate_bps;          // byte al secondo, 0 = nessun limite
+    uint64_t iops;              // richieste al secondo, 0 = nessun limite
+    uint64_t latency_target_ns; // riduce la banda quando la latenza media supera il target, 0 = disattivo
+    const char *control_file;   // rate/iops/latency_target riletti durante il wipe (NULL = nessuno)
+    int ioprio;                 // valore per ioprio_set() (classe e livello), THROTTLE_IOPRIO_NONE
+} throttle_config_t;
+
+typedef struct {
+    throttle_config_t config;   // limiti correnti: il file di controllo può cambiarli
+    uint64_t rate_bps;          // limite effettivo: minimo tra config e controllo adattivo (0 = nessuno)
+    uint64_t tat_ns;            // istante in cui il credito prenotato si esaurisce
+    uint64_t adaptive_bps;      // limite del controllo adattivo, 0 = non attivo
+    uint64_t window_end_ns;     // fine della finestra corrente (clock coarse)
+    uint64_t window_start_ns;
+    uint64_t window_bytes;
+    uint64_t window_requests;
+    uint64_t window_latency_ns;
+    uint64_t next_poll_ns;      // prossimo controllo del file (clock coarse)
+    uint64_t control_mtime;     // mtime del file di controllo in nanosecondi
+} throttle_t;
+
+void throttle_config_default(throttle_config_t *config);
+// Vero se il wipe va limitato (banda, IOPS, latenza o file di controllo)
+int throttle_enabled(const throttle_config_t *config);
+void throttle_init(throttle_t *throttle, const throttle_config_t *config);
+// Prenota length byte; ritorna i nanosecondi da attendere prima di sottomettere (0 quasi sempre).
+// Un'attesa riporta il credito a metà, così le successive richieste partono senza dormire.
+uint64_t throttle_reserve(throttle_t *throttle, size_t length);
+// Richiesta completata, per il controllo adattivo (ignorata senza latency_target)
+void throttle_complete(throttle_t *throttle, size_t length, uint64_t latency_ns);
+// Descrizione dei limiti per il riepilogo, es. "200.0 MB/s, 5000 IOPS, latency target 20 ms, idle"
+char *throttle_describe(const throttle_config_t *config, char *buffer, size_t buffer_size);
+
+// "idle", "be" o "be:N" (N 0-7, 0 la più alta) come valore per ioprio_set()
+int throttle_parse_priority(const char *text, int *ioprio);
+// Applica la priorità al thread chiamante; -1 se non supportata
+int throttle_apply_priority(int ioprio);
+
+#endif // THROTTLE_H
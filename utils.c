@@ -8,6 +8,7 @@
 #include <time.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <sys/resource.h>
 
 char* format_bytes(size_t bytes, char *buffer, size_t buffer_size) {
     const char *units[] = {"B", "KB", "MB", "GB", "TB", "PB"};
@@ -91,3 +92,75 @@ void log_message(const char *format, ...) {
 int is_root(void) {
     return (geteuid() == 0);
 }
+
+size_t peak_rss(void) {
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss; // macOS: byte
+#else
+    return (size_t)usage.ru_maxrss * 1024; // Linux: KB
+#endif
+}
+
+int parse_size(const char *text, size_t min, size_t max, size_t *value) {
+    char *end;
+    unsigned long long parsed = strtoull(text, &end, 10);
+
+    if (*end == 'K' || *end == 'k') {
+        parsed *= 1024;
+        end++;
+    } else if (*end == 'M' || *end == 'm') {
+        parsed *= 1024 * 1024;
+        end++;
+    } else if (*end == 'G' || *end == 'g') {
+        parsed *= 1024ULL * 1024 * 1024;
+        end++;
+    }
+
+    if (*text == '\0' || *end != '\0' || parsed < min || parsed > max) {
+        return -1;
+    }
+
+    *value = (size_t)parsed;
+    return 0;
+}
+
+int parse_uint(const char *text, unsigned int min, unsigned int max, unsigned int *value) {
+    char *end;
+    unsigned long parsed = strtoul(text, &end, 10);
+
+    if (*text == '\0' || *end != '\0' || parsed < min || parsed > max) {
+        return -1;
+    }
+
+    *value = (unsigned int)parsed;
+    return 0;
+}
+
+void json_write_string(FILE *out, const char *text) {
+    fputc('"', out);
+    for (; *text != '\0'; text++) {
+        unsigned char c = (unsigned char)*text;
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+void json_write_time(FILE *out, time_t when) {
+    char buffer[32];
+    struct tm tm;
+
+    gmtime_r(&when, &tm);
+    strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    fprintf(out, "\"%s\"", buffer);
+}
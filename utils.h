@@ -2,12 +2,25 @@
 #define UTILS_H
 
 #include <stddef.h>
+#include <stdio.h>
 #include <time.h>
 
+#define VERSION "1.0"
+
 char* format_bytes(size_t bytes, char *buffer, size_t buffer_size);
 char* format_time(time_t seconds, char *buffer, size_t buffer_size);
 int confirm_action(const char *message);
 void log_message(const char *format, ...);
 int is_root(void);
+// Dimensione in byte con suffisso opzionale K, M o G; -1 se non valida o fuori da [min, max]
+int parse_size(const char *text, size_t min, size_t max, size_t *value);
+// Intero decimale senza segno; -1 se non valido o fuori da [min, max]
+int parse_uint(const char *text, unsigned int min, unsigned int max, unsigned int *value);
+// Picco della memoria residente del processo in byte (getrusage), 0 se non disponibile
+size_t peak_rss(void);
+// Stringa JSON tra virgolette con i caratteri di controllo escapati
+void json_write_string(FILE *out, const char *text);
+// Istante in ISO 8601 UTC tra virgolette
+void json_write_time(FILE *out, time_t when);
 
 #endif // UTILS_H
@@ -0,0 +1,896 @@
+#define _GNU_SOURCE
+
+#include "verify.h"
+#include "digest.h"
+#include "disk_ops.h"
+#include "prng.h"
+#include "sysfs.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <math.h>
+#include <limits.h>
+#include <signal.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define VERIFY_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define VERIFY_NEON 1
+#endif
+
+#define VERIFY_FIXED_REGION (1024 * 1024) // regioni lette sempre in modalità sample
+#define VERIFY_MAX_PARTITIONS 128
+
+// Variabile globale per gestire interruzioni
+extern volatile sig_atomic_t interrupted;
+
+int verify_mode_from_name(const char *name, verify_mode_t *mode) {
+    if (strcasecmp(name, "none") == 0) {
+        *mode = VERIFY_NONE;
+        return 0;
+    }
+    if (strcasecmp(name, "full") == 0) {
+        *mode = VERIFY_FULL;
+        return 0;
+    }
+    if (strcasecmp(name, "sample") == 0) {
+        *mode = VERIFY_SAMPLE;
+        return 0;
+    }
+    return -1;
+}
+
+const char *verify_mode_name(verify_mode_t mode) {
+    switch (mode) {
+        case VERIFY_NONE:
+            return "none";
+        case VERIFY_FULL:
+            return "full";
+        case VERIFY_SAMPLE:
+            return "sample";
+    }
+    return "unknown";
+}
+
+void verify_config_default(verify_config_t *verify) {
+    verify->mode = VERIFY_NONE;
+    verify->samples = VERIFY_DEFAULT_SAMPLES;
+    verify->percent = 0.0;
+}
+
+int verify_parse_samples(const char *text, verify_config_t *verify) {
+    char *end;
+
+    // Percentuale dei blocchi del device (0.5%) oppure numero di campioni
+    if (strchr(text, '%')) {
+        double percent = strtod(text, &end);
+        if (end == text || strcmp(end, "%") != 0 || percent <= 0.0 || percent > 100.0) {
+            return -1;
+        }
+        verify->percent = percent;
+        return 0;
+    }
+
+    unsigned long long samples = strtoull(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || samples == 0) {
+        return -1;
+    }
+    verify->samples = (size_t)samples;
+    verify->percent = 0.0;
+    return 0;
+}
+
+void verify_result_init(verify_result_t *result) {
+    memset(result, 0, sizeof(*result));
+}
+
+// Kernel di confronto: vero se il blocco contiene solo byte, o se coincide con expected.
+// Si accumula l'OR delle differenze e si controlla una sola volta alla fine del blocco.
+typedef int (*is_byte_fn)(const unsigned char *data, size_t length, unsigned char byte);
+typedef int (*equal_fn)(const unsigned char *data, const unsigned char *expected, size_t length);
+
+static int scalar_is_byte(const unsigned char *data, size_t length, unsigned char byte) {
+    uint64_t pattern = 0x0101010101010101ULL * byte;
+    uint64_t diff = 0;
+    size_t i = 0;
+
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        diff |= word ^ pattern;
+    }
+    for (; i < length; i++) {
+        diff |= (uint64_t)(data[i] ^ byte);
+    }
+    return diff == 0;
+}
+
+static int scalar_equal(const unsigned char *data, const unsigned char *expected, size_t length) {
+    uint64_t diff = 0;
+    size_t i = 0;
+
+    for (; i + 8 <= length; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, data + i, 8);
+        memcpy(&b, expected + i, 8);
+        diff |= a ^ b;
+    }
+    for (; i < length; i++) {
+        diff |= (uint64_t)(data[i] ^ expected[i]);
+    }
+    return diff == 0;
+}
+
+#ifdef VERIFY_X86
+
+static int sse2_is_byte(const unsigned char *data, size_t length, unsigned char byte) {
+    const __m128i pattern = _mm_set1_epi8((char)byte);
+    __m128i diff = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 64 <= length; i += 64) {
+        diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128((const __m128i *)(data + i)), pattern));
+        diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128((const __m128i *)(data + i + 16)), pattern));
+        diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128((const __m128i *)(data + i + 32)), pattern));
+        diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128((const __m128i *)(data + i + 48)), pattern));
+    }
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xFFFF) {
+        return 0;
+    }
+    return scalar_is_byte(data + i, length - i, byte);
+}
+
+static int sse2_equal(const unsigned char *data, const unsigned char *expected, size_t length) {
+    __m128i diff = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 64 <= length; i += 64) {
+        for (int j = 0; j < 64; j += 16) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(data + i + j));
+            __m128i b = _mm_loadu_si128((const __m128i *)(expected + i + j));
+            diff = _mm_or_si128(diff, _mm_xor_si128(a, b));
+        }
+    }
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xFFFF) {
+        return 0;
+    }
+    return scalar_equal(data + i, expected + i, length - i);
+}
+
+__attribute__((target("avx2")))
+static int avx2_is_byte(const unsigned char *data, size_t length, unsigned char byte) {
+    const __m256i pattern = _mm256_set1_epi8((char)byte);
+    __m256i diff = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 128 <= length; i += 128) {
+        diff = _mm256_or_si256(diff, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(data + i)), pattern));
+        diff = _mm256_or_si256(diff, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(data + i + 32)), pattern));
+        diff = _mm256_or_si256(diff, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(data + i + 64)), pattern));
+        diff = _mm256_or_si256(diff, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(data + i + 96)), pattern));
+    }
+
+    if (!_mm256_testz_si256(diff, diff)) {
+        return 0;
+    }
+    return scalar_is_byte(data + i, length - i, byte);
+}
+
+__attribute__((target("avx2")))
+static int avx2_equal(const unsigned char *data, const unsigned char *expected, size_t length) {
+    __m256i diff = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 128 <= length; i += 128) {
+        for (int j = 0; j < 128; j += 32) {
+            __m256i a = _mm256_loadu_si256((const __m256i *)(data + i + j));
+            __m256i b = _mm256_loadu_si256((const __m256i *)(expected + i + j));
+            diff = _mm256_or_si256(diff, _mm256_xor_si256(a, b));
+        }
+    }
+
+    if (!_mm256_testz_si256(diff, diff)) {
+        return 0;
+    }
+    return scalar_equal(data + i, expected + i, length - i);
+}
+
+#endif // VERIFY_X86
+
+#ifdef VERIFY_NEON
+
+static int neon_is_byte(const unsigned char *data, size_t length, unsigned char byte) {
+    const uint8x16_t pattern = vdupq_n_u8(byte);
+    uint8x16_t diff = vdupq_n_u8(0);
+    size_t i = 0;
+
+    for (; i + 64 <= length; i += 64) {
+        diff = vorrq_u8(diff, veorq_u8(vld1q_u8(data + i), pattern));
+        diff = vorrq_u8(diff, veorq_u8(vld1q_u8(data + i + 16), pattern));
+        diff = vorrq_u8(diff, veorq_u8(vld1q_u8(data + i + 32), pattern));
+        diff = vorrq_u8(diff, veorq_u8(vld1q_u8(data + i + 48), pattern));
+    }
+
+    if (vmaxvq_u8(diff) != 0) {
+        return 0;
+    }
+    return scalar_is_byte(data + i, length - i, byte);
+}
+
+static int neon_equal(const unsigned char *data, const unsigned char *expected, size_t length) {
+    uint8x16_t diff = vdupq_n_u8(0);
+    size_t i = 0;
+
+    for (; i + 64 <= length; i += 64) {
+        for (int j = 0; j < 64; j += 16) {
+            diff = vorrq_u8(diff, veorq_u8(vld1q_u8(data + i + j), vld1q_u8(expected + i + j)));
+        }
+    }
+
+    if (vmaxvq_u8(diff) != 0) {
+        return 0;
+    }
+    return scalar_equal(data + i, expected + i, length - i);
+}
+
+#endif // VERIFY_NEON
+
+static is_byte_fn active_is_byte = scalar_is_byte;
+static equal_fn active_equal = scalar_equal;
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+
+static void detect_kernel(void) {
+#ifdef VERIFY_X86
+    if (__builtin_cpu_supports("avx2")) {
+        active_is_byte = avx2_is_byte;
+        active_equal = avx2_equal;
+    } else if (__builtin_cpu_supports("sse2")) {
+        active_is_byte = sse2_is_byte;
+        active_equal = sse2_equal;
+    }
+#elif defined(VERIFY_NEON)
+    active_is_byte = neon_is_byte;
+    active_equal = neon_equal;
+#endif
+}
+
+// Registra un range di differenze, unendolo a uno adiacente se possibile
+static void record_range(verify_result_t *result, size_t offset, size_t length) {
+    for (int i = 0; i < result->stored; i++) {
+        verify_range_t *range = &result->ranges[i];
+        if (range->offset + range->length == offset) {
+            range->length += length;
+            return;
+        }
+        if (offset + length == range->offset) {
+            range->offset = offset;
+            range->length += length;
+            return;
+        }
+    }
+
+    if (result->stored < VERIFY_MAX_RANGES) {
+        result->ranges[result->stored].offset = offset;
+        result->ranges[result->stored].length = length;
+        result->stored++;
+    }
+    result->range_count++;
+}
+
+size_t verify_find_mismatch(const pattern_pass_t *pass, const void *buffer, const void *expected, size_t length,
+                            size_t from, size_t *run_length) {
+    const unsigned char *data = buffer;
+    size_t start = length;
+
+    pthread_once(&kernel_once, detect_kernel);
+
+    for (size_t pos = from; pos < length; pos += VERIFY_BLOCK_SIZE) {
+        size_t block = length - pos > VERIFY_BLOCK_SIZE ? VERIFY_BLOCK_SIZE : length - pos;
+        int match = expected ? active_equal(data + pos, (const unsigned char *)expected + pos, block)
+                             : active_is_byte(data + pos, block, pass->byte);
+
+        if (!match && start == length) {
+            start = pos;
+        } else if (match && start < length) {
+            *run_length = pos - start;
+            return start;
+        }
+    }
+
+    *run_length = length - start;
+    return start;
+}
+
+size_t verify_buffer(const pattern_pass_t *pass, size_t offset, const void *buffer, size_t length, void *scratch,
+                     verify_result_t *result) {
+    const void *expected = NULL;
+    size_t mismatched = 0;
+    size_t run;
+
+    // I pattern casuali si rigenerano dal seed per l'intero chunk in un colpo solo
+    if (pass->kind == PATTERN_RANDOM) {
+        pattern_fill(pass, offset, scratch, length);
+        expected = scratch;
+    }
+
+    for (size_t pos = verify_find_mismatch(pass, buffer, expected, length, 0, &run); pos < length;
+         pos = verify_find_mismatch(pass, buffer, expected, length, pos + run, &run)) {
+        record_range(result, offset + pos, run);
+        mismatched += run;
+    }
+
+    result->bytes_read += length;
+    result->mismatched_bytes += mismatched;
+    return mismatched;
+}
+
+typedef struct {
+    const pattern_pass_t *pass;
+    verify_result_t *result;
+    void *scratch; // pattern atteso, un chunk
+    digest_t *digest; // alimentato con gli stessi chunk del confronto, NULL se non richiesto
+} verify_ctx_t;
+
+// Con io_uring i chunk arrivano in ordine di completamento: il confronto di uno
+// avviene mentre le altre letture sono ancora in volo
+static int verify_chunk(void *arg, size_t offset, const void *buffer, size_t length) {
+    verify_ctx_t *ctx = arg;
+    verify_buffer(ctx->pass, offset, buffer, length, ctx->scratch, ctx->result);
+    if (ctx->digest && digest_update(ctx->digest, offset, buffer, length) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static int sync_verify_range(const io_range_t *range, verify_ctx_t *ctx) {
+    // Il produttore legge i chunk successivi mentre il thread corrente confronta quello pronto
+    pattern_pipeline_t *pipeline = pipeline_create_reader(range->fd, range->start, range->length, range->chunk_size,
+                                                          range->alignment, 1 + IO_PIPELINE_LOOKAHEAD);
+    if (!pipeline) {
+        return -1;
+    }
+
+    int result = 0;
+
+    while (result == 0) {
+        if (io_should_stop(range)) {
+            result = -2;
+            break;
+        }
+
+        unsigned int index;
+        size_t offset, length;
+        int acquired = pipeline_acquire(pipeline, &index, &offset, &length);
+        if (acquired != 0) {
+            result = acquired > 0 ? 0 : -1;
+            break;
+        }
+
+        if (verify_chunk(ctx, offset, pipeline_buffer(pipeline, index), length) != 0) {
+            pipeline_release(pipeline, index);
+            result = -1;
+            break;
+        }
+        progress_update(range->progress, length);
+        pipeline_release(pipeline, index);
+    }
+
+    pipeline_destroy(pipeline);
+    return result;
+}
+
+// Legge [offset, offset + length) completando le letture parziali
+static int read_full(int fd, size_t offset, void *buffer, size_t length) {
+    size_t done = 0;
+
+    while (done < length) {
+        ssize_t bytes = pread(fd, (char *)buffer + done, length - done, (off_t)(offset + done));
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("pread");
+            return -1;
+        }
+        if (bytes == 0) {
+            fprintf(stderr, "read: unexpected end of device at offset %zu\n", offset + done);
+            return -1;
+        }
+        done += (size_t)bytes;
+    }
+
+    return 0;
+}
+
+// Coda finale non multipla del blocco logico, letta senza O_DIRECT
+static int verify_unaligned_tail(int fd, size_t offset, size_t length, verify_ctx_t *ctx,
+                                 progress_info_t *progress) {
+    char buffer[4096];
+    int flags = fcntl(fd, F_GETFL);
+
+#ifdef __linux__
+    if (flags >= 0 && (flags & O_DIRECT)) {
+        fcntl(fd, F_SETFL, flags & ~O_DIRECT);
+    }
+#endif
+
+    int result = 0;
+    while (length > 0) {
+        size_t to_read = length > sizeof(buffer) ? sizeof(buffer) : length;
+        if (read_full(fd, offset, buffer, to_read) != 0) {
+            result = -1;
+            break;
+        }
+        if (verify_chunk(ctx, offset, buffer, to_read) != 0) {
+            result = -1;
+            break;
+        }
+        offset += to_read;
+        length -= to_read;
+        progress_update(progress, to_read);
+    }
+
+    if (flags >= 0) {
+        fcntl(fd, F_SETFL, flags);
+    }
+
+    return result;
+}
+
+static int compare_ranges(const void *a, const void *b) {
+    const verify_range_t *left = a;
+    const verify_range_t *right = b;
+    return (left->offset > right->offset) - (left->offset < right->offset);
+}
+
+// Ordina i range per offset e unisce quelli adiacenti arrivati da chunk completati fuori ordine
+static void normalize_ranges(verify_result_t *result) {
+    if (result->stored == 0) {
+        return;
+    }
+
+    qsort(result->ranges, (size_t)result->stored, sizeof(verify_range_t), compare_ranges);
+
+    int merged = 0;
+    for (int i = 1; i < result->stored; i++) {
+        verify_range_t *last = &result->ranges[merged];
+        if (last->offset + last->length == result->ranges[i].offset) {
+            last->length += result->ranges[i].length;
+            result->range_count--;
+        } else {
+            result->ranges[++merged] = result->ranges[i];
+        }
+    }
+    result->stored = merged + 1;
+}
+
+// Device aperto per la verifica con i vincoli di allineamento della rilettura
+typedef struct {
+    int fd;
+    size_t disk_size;
+    size_t aligned_size; // parte letta con O_DIRECT, il resto è la coda non allineata
+    size_t alignment;
+    io_engine_t engine;
+} verify_target_t;
+
+static int verify_full(const verify_target_t *target, const pattern_pass_t *pass, const io_config_t *config,
+                       progress_info_t *progress, verify_result_t *result) {
+    const size_t BUFFER_SIZE = 1024 * 1024; // 1MB, multiplo di DIGEST_LEAF_SIZE
+
+    verify_ctx_t ctx = {
+        .pass = pass,
+        .result = result,
+        .scratch = NULL,
+        .digest = progress->digest,
+    };
+    if (posix_memalign(&ctx.scratch, target->alignment, BUFFER_SIZE) != 0) {
+        perror("posix_memalign");
+        return -1;
+    }
+
+    io_range_t range = {
+        .fd = target->fd,
+        .start = 0,
+        .length = target->aligned_size,
+        .chunk_size = BUFFER_SIZE,
+        .alignment = target->alignment,
+        .pass = pass,
+        .config = config,
+        .progress = progress,
+        .cancel = NULL,
+    };
+
+    int status;
+    if (target->engine == IO_ENGINE_URING) {
+        status = uring_read_range(&range, verify_chunk, &ctx);
+    } else {
+        status = sync_verify_range(&range, &ctx);
+    }
+
+    if (status == 0 && target->aligned_size < target->disk_size) {
+        status = verify_unaligned_tail(target->fd, target->aligned_size, target->disk_size - target->aligned_size,
+                                       &ctx, progress);
+    }
+
+    free(ctx.scratch);
+    return status;
+}
+
+static int compare_offsets(const void *a, const void *b) {
+    size_t left = *(const size_t *)a;
+    size_t right = *(const size_t *)b;
+    return (left > right) - (left < right);
+}
+
+// Aggiunge a offsets i blocchi da campionare che coprono [start, start + length)
+static size_t add_region(size_t *offsets, size_t count, size_t start, size_t length, size_t end) {
+    size_t first = start - start % VERIFY_SAMPLE_SIZE;
+    for (size_t offset = first; offset < start + length && offset < end; offset += VERIFY_SAMPLE_SIZE) {
+        offsets[count++] = offset;
+    }
+    return count;
+}
+
+// Primo blocco dello strato i di count su units blocchi, senza overflow di units * i
+static size_t stratum_start(size_t units, size_t count, size_t i) {
+    return i * (units / count) + i * (units % count) / count;
+}
+
+typedef struct {
+    pthread_t thread;
+    const verify_target_t *target;
+    const pattern_pass_t *pass;
+    const size_t *offsets;
+    size_t count;
+    size_t first;  // il worker legge offsets[first], offsets[first + stride], ...
+    size_t stride;
+    progress_info_t *progress;
+    verify_result_t result;
+    int status;
+} sample_worker_t;
+
+static void *sample_worker(void *arg) {
+    sample_worker_t *worker = arg;
+    sigset_t mask;
+    void *buffer = NULL;
+    void *scratch = NULL;
+
+    // I segnali restano al thread principale, i worker osservano interrupted
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    if (posix_memalign(&buffer, worker->target->alignment, VERIFY_SAMPLE_SIZE) != 0 ||
+        posix_memalign(&scratch, worker->target->alignment, VERIFY_SAMPLE_SIZE) != 0) {
+        perror("posix_memalign");
+        free(buffer);
+        worker->status = -1;
+        return NULL;
+    }
+
+    worker->status = 0;
+    for (size_t i = worker->first; i < worker->count && worker->status == 0; i += worker->stride) {
+        if (interrupted) {
+            worker->status = -2;
+            break;
+        }
+
+        size_t offset = worker->offsets[i];
+        size_t end = worker->target->aligned_size;
+        size_t length = end - offset > VERIFY_SAMPLE_SIZE ? VERIFY_SAMPLE_SIZE : end - offset;
+
+        if (read_full(worker->target->fd, offset, buffer, length) != 0) {
+            worker->status = -1;
+            break;
+        }
+
+        verify_buffer(worker->pass, offset, buffer, length, scratch, &worker->result);
+        progress_update(worker->progress, length);
+    }
+
+    free(buffer);
+    free(scratch);
+    return NULL;
+}
+
+// Somma il risultato di un worker a quello complessivo
+static void merge_result(verify_result_t *result, const verify_result_t *partial) {
+    result->bytes_read += partial->bytes_read;
+    result->mismatched_bytes += partial->mismatched_bytes;
+    for (int i = 0; i < partial->stored; i++) {
+        record_range(result, partial->ranges[i].offset, partial->ranges[i].length);
+    }
+    // Range oltre il limite del worker: contati ma non conservati
+    result->range_count += partial->range_count - (size_t)partial->stored;
+}
+
+static int verify_sample(const verify_target_t *target, const char *disk_path, const pattern_pass_t *pass,
+                         const io_config_t *config, const verify_config_t *verify, progress_info_t *progress,
+                         verify_result_t *result) {
+    size_t units = (target->aligned_size + VERIFY_SAMPLE_SIZE - 1) / VERIFY_SAMPLE_SIZE;
+    size_t samples = verify->samples;
+
+    if (verify->percent > 0) {
+        samples = (size_t)((double)units * verify->percent / 100.0);
+    }
+    if (samples == 0) {
+        samples = 1;
+    }
+    if (samples > units) {
+        samples = units;
+    }
+
+    // I superblock dei filesystem stanno all'inizio delle partizioni note al kernel
+    sysfs_partition_t partitions[VERIFY_MAX_PARTITIONS];
+    int partition_count = sysfs_partitions(disk_path, partitions, VERIFY_MAX_PARTITIONS);
+
+    // Regioni fisse (MBR e GPT primaria nel primo MiB, GPT di backup nell'ultimo,
+    // inizio di ogni partizione) più un campione casuale per ciascuno strato del device
+    size_t fixed_units = VERIFY_FIXED_REGION / VERIFY_SAMPLE_SIZE + 1;
+    size_t capacity = samples + fixed_units * (2 + (size_t)partition_count);
+    size_t *offsets = calloc(capacity, sizeof(size_t));
+    uint64_t *random = calloc(samples, sizeof(uint64_t));
+    if (!offsets || !random) {
+        perror("calloc");
+        free(offsets);
+        free(random);
+        return -1;
+    }
+
+    size_t count = 0;
+    count = add_region(offsets, count, 0, VERIFY_FIXED_REGION, target->aligned_size);
+    if (target->aligned_size > VERIFY_FIXED_REGION) {
+        count = add_region(offsets, count, target->aligned_size - VERIFY_FIXED_REGION, VERIFY_FIXED_REGION,
+                           target->aligned_size);
+    }
+    for (int i = 0; i < partition_count; i++) {
+        count = add_region(offsets, count, partitions[i].start, VERIFY_FIXED_REGION, target->aligned_size);
+    }
+
+    // Regioni fisse sovrapposte (device piccoli, partizioni vicine o all'inizio) contano una volta sola
+    qsort(offsets, count, sizeof(size_t), compare_offsets);
+    size_t fixed = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (fixed == 0 || offsets[i] != offsets[fixed - 1]) {
+            offsets[fixed++] = offsets[i];
+        }
+    }
+    count = fixed;
+
+    // Campionamento stratificato: i campioni coprono uniformemente tutto l'intervallo LBA.
+    // Lo stesso generatore del wipe, con un seed nuovo registrato nel log.
+    uint64_t seed = prng_random_seed();
+    prng_key_t key;
+    prng_key_init(&key, seed);
+    prng_fill(&key, 0, random, samples * sizeof(uint64_t));
+
+    // Gli strati sono disgiunti, quindi i campioni casuali sono distinti tra loro; uno che cade in un
+    // blocco fisso non è una lettura in più e non entra nel limite di confidenza
+    for (size_t i = 0; i < samples; i++) {
+        size_t first = stratum_start(units, samples, i);
+        size_t next = stratum_start(units, samples, i + 1);
+        size_t offset = (first + (size_t)(random[i] % (next - first))) * VERIFY_SAMPLE_SIZE;
+        if (!bsearch(&offset, offsets, fixed, sizeof(size_t), compare_offsets)) {
+            offsets[count++] = offset;
+        }
+    }
+    free(random);
+    samples = count - fixed;
+
+    // Ordinati: i worker avanzano insieme lungo il device
+    qsort(offsets, count, sizeof(size_t), compare_offsets);
+
+    size_t planned = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t left = target->aligned_size - offsets[i];
+        planned += left > VERIFY_SAMPLE_SIZE ? VERIFY_SAMPLE_SIZE : left;
+    }
+    planned += target->disk_size - target->aligned_size;
+    progress_set_total(progress, planned);
+
+    result->samples = samples;
+    result->fixed_samples = fixed;
+    log_message("Verify: sampling %zu random + %zu fixed blocks of %d bytes (%d partition(s), sample seed 0x%016llx)",
+                samples, fixed, VERIFY_SAMPLE_SIZE, partition_count, (unsigned long long)seed);
+
+    // Letture casuali concorrenti: tanti worker quante le richieste in volo configurate
+    unsigned int worker_count = config->queue_depth;
+    if (worker_count == 0 || worker_count > IO_MAX_QUEUE_DEPTH) {
+        worker_count = IO_DEFAULT_QUEUE_DEPTH;
+    }
+    if (worker_count > count) {
+        worker_count = (unsigned int)count;
+    }
+
+    sample_worker_t *workers = calloc(worker_count, sizeof(sample_worker_t));
+    if (!workers) {
+        perror("calloc");
+        free(offsets);
+        return -1;
+    }
+
+    int status = 0;
+    unsigned int started = 0;
+    for (unsigned int i = 0; i < worker_count; i++) {
+        sample_worker_t *worker = &workers[i];
+        worker->target = target;
+        worker->pass = pass;
+        worker->offsets = offsets;
+        worker->count = count;
+        worker->first = i;
+        worker->stride = worker_count;
+        worker->progress = progress;
+
+        if (pthread_create(&worker->thread, NULL, sample_worker, worker) != 0) {
+            perror("pthread_create");
+            status = -1;
+            break;
+        }
+        started++;
+    }
+
+    for (unsigned int i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+        merge_result(result, &workers[i].result);
+
+        if (workers[i].status == -1) {
+            status = -1;
+        } else if (workers[i].status == -2 && status == 0) {
+            status = -2;
+        }
+    }
+
+    free(workers);
+    free(offsets);
+
+    if (status == 0 && target->aligned_size < target->disk_size) {
+        verify_ctx_t ctx = {
+            .pass = pass,
+            .result = result,
+            .scratch = NULL,
+        };
+        if (posix_memalign(&ctx.scratch, target->alignment, VERIFY_SAMPLE_SIZE) != 0) {
+            perror("posix_memalign");
+            return -1;
+        }
+        status = verify_unaligned_tail(target->fd, target->aligned_size, target->disk_size - target->aligned_size,
+                                       &ctx, progress);
+        free(ctx.scratch);
+    }
+
+    return status;
+}
+
+int verify_device(const char *disk_path, size_t disk_size, const pattern_pass_t *pass, const io_config_t *config,
+                  const verify_config_t *verify, progress_info_t *progress, verify_result_t *result) {
+    verify_target_t target;
+    struct timespec begin, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    verify_result_init(result);
+
+    // La rilettura deve arrivare al supporto: con la page cache si rileggerebbero
+    // i dati appena scritti dalla RAM
+    int direct_io = 1;
+    target.fd = open_disk_read(disk_path, 1);
+    if (target.fd < 0) {
+        direct_io = 0;
+        target.fd = open_disk_read(disk_path, 0);
+        if (target.fd < 0) {
+            return -1;
+        }
+        log_message("Verify: direct I/O not available on %s, dropping cached pages instead", disk_path);
+#ifdef __linux__
+        posix_fadvise(target.fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+    }
+
+    target.disk_size = disk_size;
+    target.aligned_size = disk_size;
+    target.alignment = 4096;
+    ssize_t block_size = get_block_size(target.fd);
+    if (block_size <= 0) {
+        block_size = 512;
+    }
+    if ((size_t)block_size > target.alignment) {
+        target.alignment = (size_t)block_size;
+    }
+    if (direct_io) {
+        target.aligned_size = disk_size - disk_size % (size_t)block_size;
+    }
+
+    target.engine = config->engine;
+    if (target.engine == IO_ENGINE_URING && !io_uring_available()) {
+        target.engine = IO_ENGINE_SYNC;
+    }
+
+    char pattern_str[16];
+    log_message("Verify (%s): %s of %zu bytes, expected %s, engine %s", verify_mode_name(verify->mode), disk_path,
+                disk_size, pattern_describe(pass, pattern_str, sizeof(pattern_str)), io_engine_name(target.engine));
+
+    int status;
+    if (verify->mode == VERIFY_SAMPLE) {
+        status = verify_sample(&target, disk_path, pass, config, verify, progress, result);
+    } else {
+        progress_set_total(progress, disk_size);
+        status = verify_full(&target, pass, config, progress, result);
+    }
+
+    close(target.fd);
+    normalize_ranges(result);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    result->seconds = (double)(end.tv_sec - begin.tv_sec) + (double)(end.tv_nsec - begin.tv_nsec) / 1e9;
+
+    if (status != 0) {
+        return status;
+    }
+    return result->mismatched_bytes > 0 ? 1 : 0;
+}
+
+void verify_report(const verify_result_t *result) {
+    char read_str[64], mismatched_str[64], time_str[64];
+    double speed = result->seconds > 0 ? (double)result->bytes_read / result->seconds / (1024.0 * 1024.0) : 0.0;
+
+    format_bytes(result->bytes_read, read_str, sizeof(read_str));
+    format_bytes(result->mismatched_bytes, mismatched_str, sizeof(mismatched_str));
+    format_time((time_t)result->seconds, time_str, sizeof(time_str));
+
+    printf("Verification %s\n\n", result->mismatched_bytes == 0 ? "PASSED" : "FAILED");
+    printf("Verify statistics:\n");
+    printf("  Data verified: %s\n", read_str);
+    if (result->samples > 0 || result->fixed_samples > 0) {
+        printf("  Samples: %zu random + %zu fixed blocks of %d KB\n", result->samples, result->fixed_samples,
+               VERIFY_SAMPLE_SIZE / 1024);
+        // Con n campioni casuali tutti corretti, la frazione di blocchi diversi è inferiore
+        // a 1 - (1 - c)^(1/n) con confidenza c; i blocchi fissi non sono casuali e non contano
+        if (result->mismatched_bytes == 0 && result->samples > 0) {
+            double n = (double)result->samples;
+            printf("  Confidence: 95%% that less than %.4f%% of the device differs, 99%% that less than %.4f%%\n",
+                   (1.0 - pow(0.05, 1.0 / n)) * 100.0, (1.0 - pow(0.01, 1.0 / n)) * 100.0);
+        }
+    }
+    printf("  Mismatching data: %s in %zu range(s)\n", mismatched_str, result->range_count);
+    for (int i = 0; i < result->stored; i++) {
+        const verify_range_t *range = &result->ranges[i];
+        char length_str[64];
+        format_bytes(range->length, length_str, sizeof(length_str));
+        printf("    0x%012zx - 0x%012zx (%s)\n", range->offset, range->offset + range->length, length_str);
+    }
+    if (result->range_count > (size_t)result->stored) {
+        printf("    ... %zu more range(s) not shown\n", result->range_count - (size_t)result->stored);
+    }
+    printf("  Verify time: %s\n", time_str);
+    printf("  Verify speed: %.2f MB/s\n", speed);
+}
+
+void verify_log(const verify_result_t *result, const char *disk_path) {
+    double speed = result->seconds > 0 ? (double)result->bytes_read / result->seconds / (1024.0 * 1024.0) : 0.0;
+
+    if (result->samples > 0) {
+        log_message("Verify samples: %s - %zu random + %zu fixed blocks, 95%% confidence bound %.4f%%", disk_path,
+                    result->samples, result->fixed_samples, (1.0 - pow(0.05, 1.0 / (double)result->samples)) * 100.0);
+    } else if (result->fixed_samples > 0) {
+        log_message("Verify samples: %s - %zu fixed blocks, no random block outside them", disk_path,
+                    result->fixed_samples);
+    }
+    log_message("Verify %s: %s - %zu bytes read, %zu bytes mismatching in %zu range(s), %.1fs (%.2f MB/s)",
+                result->mismatched_bytes == 0 ? "passed" : "FAILED", disk_path, result->bytes_read,
+                result->mismatched_bytes, result->range_count, result->seconds, speed);
+    for (int i = 0; i < result->stored; i++) {
+        log_message("Verify mismatch: %s offset %zu length %zu", disk_path, result->ranges[i].offset,
+                    result->ranges[i].length);
+    }
+}
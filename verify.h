@@ -0,0 +1,73 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <stddef.h>
+#include "io_engine.h"
+#include "pattern.h"
+#include "progress.h"
+
+#define VERIFY_BLOCK_SIZE 4096 // granularità del confronto e dei range riportati
+#define VERIFY_MAX_RANGES 64   // range di differenze conservati per il report
+#define VERIFY_SAMPLE_SIZE (64 * 1024) // dimensione di ogni blocco campionato
+#define VERIFY_DEFAULT_SAMPLES 4096
+
+// Verifica del contenuto dopo l'ultima passata
+typedef enum {
+    VERIFY_NONE = 0,
+    VERIFY_FULL,     // rilettura completa del device
+    VERIFY_SAMPLE    // blocchi casuali più regioni fisse (inizio, fine, tabelle delle partizioni)
+} verify_mode_t;
+
+typedef struct {
+    verify_mode_t mode;
+    size_t samples; // blocchi casuali in modalità sample
+    double percent; // se > 0, campioni come percentuale dei blocchi del device (sostituisce samples)
+} verify_config_t;
+
+typedef struct {
+    size_t offset;
+    size_t length;
+} verify_range_t;
+
+typedef struct {
+    size_t bytes_read;
+    size_t mismatched_bytes;
+    size_t range_count;                       // range di differenze trovati (anche oltre VERIFY_MAX_RANGES)
+    verify_range_t ranges[VERIFY_MAX_RANGES]; // i primi range, ordinati per offset al termine
+    int stored;                               // range presenti in ranges
+    size_t samples;                           // blocchi casuali letti fuori dalle regioni fisse (0 nella completa)
+    size_t fixed_samples;                     // blocchi distinti delle regioni fisse
+    double seconds;
+} verify_result_t;
+
+int verify_mode_from_name(const char *name, verify_mode_t *mode);
+const char *verify_mode_name(verify_mode_t mode);
+void verify_config_default(verify_config_t *verify);
+// Accetta un numero di campioni (4096) o una percentuale dei blocchi (0.5%)
+int verify_parse_samples(const char *text, verify_config_t *verify);
+void verify_result_init(verify_result_t *result);
+
+// Confronta buffer con il contenuto atteso della passata per i byte [offset, offset + length)
+// a blocchi di VERIFY_BLOCK_SIZE. scratch (almeno length byte) serve a rigenerare i pattern
+// casuali. I blocchi diversi vengono registrati in result; ritorna i byte non corrispondenti.
+// result non è protetto da lock: un solo thread per result.
+size_t verify_buffer(const pattern_pass_t *pass, size_t offset, const void *buffer, size_t length, void *scratch,
+                     verify_result_t *result);
+
+// Primo run di blocchi di VERIFY_BLOCK_SIZE diversi dal contenuto atteso in buffer[from, length):
+// expected è il pattern rigenerato (NULL per un byte costante). Ritorna l'inizio del run relativo
+// a buffer e ne scrive la lunghezza in run_length; ritorna length se il resto corrisponde.
+size_t verify_find_mismatch(const pattern_pass_t *pass, const void *buffer, const void *expected, size_t length,
+                            size_t from, size_t *run_length);
+
+// Rilegge il device (senza page cache) per intero o a campioni e lo confronta con la passata pass.
+// progress->total_bytes viene impostato ai byte che verranno letti.
+// Ritorna 0 se il contenuto corrisponde, 1 se ci sono differenze, -1 su errore, -2 se interrotto.
+int verify_device(const char *disk_path, size_t disk_size, const pattern_pass_t *pass, const io_config_t *config,
+                  const verify_config_t *verify, progress_info_t *progress, verify_result_t *result);
+
+// Riepilogo a schermo e nel log (con tutti i range conservati)
+void verify_report(const verify_result_t *result);
+void verify_log(const verify_result_t *result, const char *disk_path);
+
+#endif // VERIFY_H
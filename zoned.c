@@ -0,0 +1,203 @@
+#define _GNU_SOURCE
+
+#include "zoned.h"
+#include "sysfs.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+
+#ifdef __linux__
+#include <linux/blkzoned.h>
+#endif
+
+// Variabile globale per gestire interruzioni
+extern volatile sig_atomic_t interrupted;
+
+zoned_model_t zoned_model(const char *disk_path) {
+    char model[32];
+
+    if (sysfs_read_string(disk_path, "queue/zoned", model, sizeof(model)) != 0) {
+        return ZONED_NONE;
+    }
+    if (strcmp(model, "host-managed") == 0) {
+        return ZONED_HOST_MANAGED;
+    }
+    if (strcmp(model, "host-aware") == 0) {
+        return ZONED_HOST_AWARE;
+    }
+    return ZONED_NONE;
+}
+
+const char *zoned_model_name(zoned_model_t model) {
+    switch (model) {
+        case ZONED_NONE:
+            return "none";
+        case ZONED_HOST_AWARE:
+            return "host-aware";
+        case ZONED_HOST_MANAGED:
+            return "host-managed";
+    }
+    return "unknown";
+}
+
+int zoned_report(int fd, const char *disk_path, zone_map_t *map) {
+    memset(map, 0, sizeof(*map));
+    map->model = zoned_model(disk_path);
+
+#ifdef __linux__
+    unsigned long long value;
+    if (sysfs_queue_u64(disk_path, "max_open_zones", &value) == 0) {
+        map->max_open = (unsigned int)value;
+    }
+    if (sysfs_queue_u64(disk_path, "max_active_zones", &value) == 0) {
+        map->max_active = (unsigned int)value;
+    }
+    if (sysfs_queue_u64(disk_path, "zone_write_granularity", &value) == 0) {
+        map->write_granularity = (size_t)value;
+    }
+
+    unsigned int nr_zones = 0;
+    if (ioctl(fd, BLKGETNRZONES, &nr_zones) < 0 || nr_zones == 0) {
+        perror("ioctl(BLKGETNRZONES)");
+        return -1;
+    }
+
+    struct blk_zone_report *report = malloc(sizeof(*report) + ZONED_REPORT_BATCH * sizeof(struct blk_zone));
+    map->zones = calloc(nr_zones, sizeof(zone_t));
+    if (!report || !map->zones) {
+        perror("malloc");
+        free(report);
+        zoned_free(map);
+        return -1;
+    }
+
+    // Le zone arrivano in ordine di settore: ogni richiesta riparte dalla fine dell'ultima ricevuta
+    uint64_t sector = 0;
+    while (map->count < nr_zones) {
+        memset(report, 0, sizeof(*report));
+        report->sector = sector;
+        report->nr_zones = ZONED_REPORT_BATCH;
+
+        if (ioctl(fd, BLKREPORTZONE, report) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("ioctl(BLKREPORTZONE)");
+            free(report);
+            zoned_free(map);
+            return -1;
+        }
+        if (report->nr_zones == 0) {
+            break;
+        }
+
+        for (unsigned int i = 0; i < report->nr_zones && map->count < nr_zones; i++) {
+            const struct blk_zone *blk = &report->zones[i];
+            zone_t *zone = &map->zones[map->count++];
+
+            // Settori da 512 byte, qualunque sia il blocco logico
+            zone->start = (size_t)blk->start * 512;
+            zone->length = (size_t)blk->len * 512;
+            zone->capacity = (report->flags & BLK_ZONE_REP_CAPACITY) ? (size_t)blk->capacity * 512 : zone->length;
+            zone->sequential = blk->type != BLK_ZONE_TYPE_CONVENTIONAL;
+            zone->usable = blk->cond != BLK_ZONE_COND_OFFLINE && blk->cond != BLK_ZONE_COND_READONLY;
+
+            map->conventional += !zone->sequential;
+            map->unusable += !zone->usable;
+            if (map->zone_size < zone->length) {
+                map->zone_size = zone->length;
+            }
+            sector = blk->start + blk->len;
+        }
+    }
+
+    free(report);
+    return 0;
+#else
+    (void)fd;
+    fprintf(stderr, "ERROR: Zoned devices are only supported on Linux\n");
+    return -1;
+#endif
+}
+
+void zoned_free(zone_map_t *map) {
+    free(map->zones);
+    map->zones = NULL;
+    map->count = 0;
+}
+
+int zoned_reset(int fd, const zone_map_t *map, progress_info_t *progress) {
+#ifdef __linux__
+    unsigned int i = 0;
+
+    while (i < map->count) {
+        if (interrupted) {
+            return -2;
+        }
+
+        // Gruppo di zone sequenziali contigue: il kernel le azzera con una sola chiamata
+        // (RESET ALL se il gruppo copre l'intero device)
+        const zone_t *first = &map->zones[i];
+        if (!first->sequential || !first->usable) {
+            i++;
+            continue;
+        }
+
+        unsigned int end = i + 1;
+        while (end < map->count && end - i < ZONED_RESET_BATCH && map->zones[end].sequential &&
+               map->zones[end].usable) {
+            end++;
+        }
+
+        const zone_t *last = &map->zones[end - 1];
+        struct blk_zone_range range = {
+            .sector = first->start / 512,
+            .nr_sectors = (last->start + last->length - first->start) / 512,
+        };
+
+        if (ioctl(fd, BLKRESETZONE, &range) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "ERROR: BLKRESETZONE of %u zone(s) at offset %zu failed: %s\n", end - i, first->start,
+                    strerror(errno));
+            return -1;
+        }
+
+        if (progress) {
+            progress_update(progress, last->start + last->length - first->start);
+        }
+        i = end;
+    }
+
+    return 0;
+#else
+    (void)fd;
+    (void)map;
+    (void)progress;
+    return -1;
+#endif
+}
+
+void zoned_print(const zone_map_t *map, const char *indent) {
+    char zone_str[32];
+
+    format_bytes(map->zone_size, zone_str, sizeof(zone_str));
+    printf("%sZoned device (%s): %u zones of %s, %u conventional", indent, zoned_model_name(map->model), map->count,
+           zone_str, map->conventional);
+    if (map->unusable > 0) {
+        printf(", %u offline or read-only", map->unusable);
+    }
+    printf("\n");
+}
+
+void zoned_log(const zone_map_t *map, const char *disk_path) {
+    log_message("Zoned device %s (%s): %u zones of %zu bytes, %u conventional, %u unusable, "
+                "max open %u, max active %u", disk_path, zoned_model_name(map->model), map->count, map->zone_size,
+                map->conventional, map->unusable, map->max_open, map->max_active);
+}
@@ -0,0 +1,56 @@
+#ifndef ZONED_H
+#define ZONED_H
+
+#include <stddef.h>
+#include "progress.h"
+
+// Device a zone (SMR host-managed/host-aware, namespace NVMe ZNS): nelle zone sequenziali
+// si scrive solo al write pointer, quindi niente scritture casuali né richieste fuori ordine.
+// Il reset riporta il write pointer all'inizio della zona, la sovrascrittura avviene zona per zona.
+#define ZONED_REPORT_BATCH 4096   // zone lette per ogni BLKREPORTZONE
+#define ZONED_RESET_BATCH 1024    // zone contigue azzerate con un solo BLKRESETZONE
+#define ZONED_DEFAULT_WORKERS 4   // zone scritte in parallelo se --threads non lo indica (IO_TUNE_THREADS)
+
+typedef enum {
+    ZONED_NONE = 0,     // device convenzionale
+    ZONED_HOST_AWARE,   // accetta scritture casuali, ma preferisce quelle sequenziali
+    ZONED_HOST_MANAGED  // scritture solo sequenziali al write pointer (anche ZNS)
+} zoned_model_t;
+
+typedef struct {
+    size_t start;
+    size_t length;      // dimensione della zona
+    size_t capacity;    // byte scrivibili (ZNS: può essere minore di length)
+    int sequential;     // 0 per le zone convenzionali, scrivibili in qualsiasi ordine
+    int usable;         // 0 per zone offline o in sola lettura
+} zone_t;
+
+typedef struct {
+    zoned_model_t model;
+    zone_t *zones;
+    unsigned int count;
+    unsigned int conventional;
+    unsigned int unusable;
+    size_t zone_size;
+    unsigned int max_open;   // zone aperte contemporaneamente (0 = nessun limite)
+    unsigned int max_active; // zone aperte o chiuse ma non piene (0 = nessun limite)
+    size_t write_granularity; // scrittura minima nelle zone sequenziali (0 se non dichiarata)
+} zone_map_t;
+
+// Modello da /sys/block/<dev>/queue/zoned (ZONED_NONE se assente o fuori da Linux)
+zoned_model_t zoned_model(const char *disk_path);
+const char *zoned_model_name(zoned_model_t model);
+
+// Legge le zone con BLKREPORTZONE e i limiti da queue/. Ritorna 0 o -1 con messaggio.
+int zoned_report(int fd, const char *disk_path, zone_map_t *map);
+void zoned_free(zone_map_t *map);
+
+// Azzera tutte le zone sequenziali utilizzabili, a gruppi contigui di ZONED_RESET_BATCH.
+// Con progress non NULL i byte delle zone azzerate contano come elaborati.
+// Ritorna 0 se completato, -1 in caso di errore, -2 se interrotto.
+int zoned_reset(int fd, const zone_map_t *map, progress_info_t *progress);
+
+void zoned_print(const zone_map_t *map, const char *indent);
+void zoned_log(const zone_map_t *map, const char *disk_path);
+
+#endif // ZONED_H